@@ -0,0 +1,805 @@
+/*!
+ *
+ *  \file    alloc.c
+ *  \brief   Benchmarks memory allocators under threads
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this program works:
+ *           Each process runs three allocation scenarios with 1, 2, 4, ... up to N threads, and
+ *           each thread performs about M allocations and frees:
+ *           \arg Size-class mix: each thread keeps \b LIVE_OBJECTS objects whose sizes are between
+ *                \b SMALLEST_OBJECT and \b LARGEST_OBJECT bytes, mostly small, and replaces a random
+ *                one with a new object of a random size.
+ *           \arg Producer/consumer: each thread allocates objects and passes them through a queue
+ *                to the next thread, which frees them, so every object is freed by a different
+ *                thread than the one that allocated it.
+ *           \arg Fragmentation: each thread allocates many objects of \b SMALL_OBJECT bytes, frees
+ *                every other one, and then allocates objects of \b LARGE_OBJECT bytes, which do not
+ *                fit in the holes.
+ *
+ *           Every scenario is run with three allocators:
+ *           \arg malloc: glibc \b malloc and \b free
+ *           \arg arena: each thread carves objects from its own chunks of \b CHUNK_SIZE bytes by
+ *                moving a pointer forward. Freeing does nothing; the chunks are unmapped at the end.
+ *           \arg pool: each thread keeps a free list for each size class, from 16 bytes to 8 KB
+ *                in powers of two, and carves new objects from its own chunks when a list is
+ *                empty. An object goes back onto a free list of the thread that frees it, so
+ *                objects freed by a consumer are not reused by their producer.
+ *
+ *           Each thread writes to every object it allocates and checks the object before freeing
+ *           it. The program displays the allocations and frees per second of all threads and
+ *           processes, and the growth of the resident set size (RSS) of each process from the
+ *           start of a run until all threads finish, while objects that are still live have not
+ *           been freed.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <malloc.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <mpi.h>
+#include <pthread.h>
+
+/*! Master process. Usually process 0. */
+#define MASTER                     0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS                "unknown"
+#endif
+/*! Size of a cache line. Data written by different threads is kept on different lines. */
+#define CACHE_LINE_SIZE            64
+
+/*! glibc malloc and free */
+#define MALLOC_ALLOCATOR           0
+/*! Bump allocator with a chunk per thread */
+#define ARENA_ALLOCATOR            1
+/*! Free lists of fixed-size objects per thread */
+#define POOL_ALLOCATOR             2
+/*! Number of allocators */
+#define NUMBER_OF_ALLOCATORS       3
+
+/*! Each thread replaces random objects of random sizes */
+#define SIZE_CLASS_MIX             0
+/*! Objects are freed by the thread after the one that allocated them */
+#define PRODUCER_CONSUMER          1
+/*! Small objects are freed in a checkerboard and replaced by larger ones */
+#define FRAGMENTATION              2
+/*! Number of scenarios */
+#define NUMBER_OF_SCENARIOS        3
+
+/*! Number of objects that each thread keeps in the size-class mix */
+#define LIVE_OBJECTS            1024
+/*! Smallest and largest objects in the size-class mix and the producer/consumer scenario */
+#define SMALLEST_OBJECT           16
+#define LARGEST_OBJECT          4096
+/*! Sizes of objects in the fragmentation scenario */
+#define SMALL_OBJECT              64
+#define LARGE_OBJECT             256
+/*! Number of objects that a producer/consumer queue holds. Must be a power of two. */
+#define QUEUE_LENGTH            1024
+
+/*! Size of the chunks that the arena and pool allocators carve objects from */
+#define CHUNK_SIZE                 (1UL << 20)
+/*! Number of size classes in the pool allocator, from 16 bytes to 8 KB */
+#define POOL_CLASSES              10
+/*! Smallest size class in the pool allocator */
+#define POOL_SMALLEST_CLASS       16
+/*! Bytes before each pool object that hold its size class. Keeps objects aligned to 16 bytes. */
+#define POOL_HEADER               16
+
+/*! Results of each run: allocations and frees per second, RSS growth in bytes, corrupted objects */
+#define RESULTS                    3
+
+/*! Names of the allocators, in the order of their numbers */
+static const char* const ALLOCATOR_NAMES[] = { "malloc", "arena", "pool" };
+
+/*!
+ *  \brief Chunks and free lists of one thread for the arena and pool allocators
+ */
+typedef struct thread_heap {
+    /* Chunk that objects are carved from */
+    char* chunk;
+    /* Bytes used in chunk */
+    size_t used;
+    /* Size of chunk */
+    size_t size;
+    /* All chunks of this thread, linked through their first word */
+    char* chunks;
+    /* First free object of each size class in the pool allocator, linked through their first word */
+    void* free_lists[POOL_CLASSES];
+} __attribute__((aligned(CACHE_LINE_SIZE))) thread_heap;
+
+/*!
+ *  \brief Queue of objects from one producer thread to one consumer thread
+ */
+typedef struct object_queue {
+    /* Next object to take, advanced by the consumer */
+    _Atomic long head;
+    /* Next free slot, advanced by the producer on its own cache line */
+    _Atomic long tail __attribute__((aligned(CACHE_LINE_SIZE)));
+    void* slots[QUEUE_LENGTH] __attribute__((aligned(CACHE_LINE_SIZE)));
+} __attribute__((aligned(CACHE_LINE_SIZE))) object_queue;
+
+/*!
+ *  \brief Arguments for and output from a thread
+ */
+typedef struct alloc_test_a {
+    int scenario;
+    int allocator;
+    /* Number of this thread, from 0 */
+    int thread;
+    int threads;
+    long operations;
+    thread_heap* heap;
+    /* Queues of all threads. A thread takes objects from its own queue. */
+    object_queue* queues;
+    /* Used by all threads and the main thread to start and stop together */
+    pthread_barrier_t* barrier;
+    /* Output: times when the thread started and finished, allocations and frees performed, and
+       objects that were corrupted */
+    double start;
+    double end;
+    long performed;
+    long errors;
+} __attribute__((aligned(CACHE_LINE_SIZE))) alloc_test_a;
+
+/***************************************************************************************************/
+
+/*!
+ *
+ *  \par Description:
+ *  Runs one scenario with one allocator and a number of threads, and measures the allocations and
+ *  frees per second, from the time the first thread starts until the last thread finishes, and the
+ *  growth of the RSS of this process.
+ *
+ *  \param scenario \b SIZE_CLASS_MIX, \b PRODUCER_CONSUMER or \b FRAGMENTATION
+ *  \param allocator \b MALLOC_ALLOCATOR, \b ARENA_ALLOCATOR or \b POOL_ALLOCATOR
+ *  \param threads Number of threads
+ *  \param operations Number of allocations and frees to perform on each thread
+ *  \param results Allocations and frees per second, RSS growth in bytes, and corrupted objects
+ *
+ *  \return 0 if successful or -1 if memory allocation failed
+ *
+ */
+int run_alloc_test(int scenario, int allocator, int threads, long operations, double* results);
+
+/*!
+ *
+ *  \par Description:
+ *  Runs a scenario on one thread. Waits with the other threads and the main thread before
+ *  starting, after finishing so that the RSS can be measured, and again before freeing the
+ *  objects that are still live.
+ *
+ *  \param alloc_test_args Struct that contains the scenario, allocator and heap of the thread
+ *
+ *  \return NULL
+ *
+ */
+void* alloc_test(void* alloc_test_args);
+
+/*!
+ *
+ *  \par Description:
+ *  Allocates an object with an allocator.
+ *
+ *  \param heap Heap of the calling thread
+ *  \param allocator \b MALLOC_ALLOCATOR, \b ARENA_ALLOCATOR or \b POOL_ALLOCATOR
+ *  \param size Size of the object in bytes. At most 8 KB - \b POOL_HEADER for the pool allocator.
+ *
+ *  \return Pointer to the object, aligned to 16 bytes, or NULL if it could not be allocated
+ *
+ */
+void* allocate(thread_heap* heap, int allocator, size_t size);
+
+/*!
+ *
+ *  \par Description:
+ *  Frees an object with the allocator that allocated it. May be called from any thread.
+ *
+ *  \param heap Heap of the calling thread
+ *  \param allocator Allocator that allocated the object
+ *  \param object Pointer returned by \b allocate
+ *
+ */
+void release(thread_heap* heap, int allocator, void* object);
+
+/*!
+ *
+ *  \par Description:
+ *  Carves bytes from the chunk of a thread, and maps a new chunk if they do not fit.
+ *
+ *  \param heap Heap of the calling thread
+ *  \param size Number of bytes. Must be a multiple of 16.
+ *
+ *  \return Pointer to the bytes, or NULL if a chunk could not be mapped
+ *
+ */
+void* carve(thread_heap* heap, size_t size);
+
+/*!
+ *
+ *  \par Description:
+ *  Unmaps all chunks of a thread and empties its free lists.
+ *
+ *  \param heap Heap of a thread that has finished
+ *
+ */
+void free_chunks(thread_heap* heap);
+
+/*!
+ *
+ *  \par Description:
+ *  Allocates an object, writes its size to its first word and writes to its last byte.
+ *
+ *  \return Pointer to the object, or NULL if it could not be allocated
+ *
+ */
+void* new_object(thread_heap* heap, int allocator, size_t size);
+
+/*!
+ *
+ *  \par Description:
+ *  Checks that an object still holds what \b new_object wrote, and frees it.
+ *
+ *  \param output Arguments of the calling thread, whose counts are updated
+ *  \param object Pointer returned by \b new_object
+ *
+ */
+void delete_object(alloc_test_a* output, void* object);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns a random object size between \b SMALLEST_OBJECT and \b LARGEST_OBJECT bytes. Half of
+ *  the objects are at most 64 bytes, and each larger power of two is half as likely as the one
+ *  before it.
+ *
+ *  \param state State of the random number generator of the calling thread
+ *
+ *  \return Size in bytes
+ *
+ */
+size_t random_size(uint64_t* state);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the next number from a xorshift generator.
+ *
+ *  \param state State of the generator, which is advanced. Must not be 0.
+ *
+ *  \return Random 64-bit number
+ *
+ */
+uint64_t next_random(uint64_t* state);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the resident set size of this process from /proc/self/statm.
+ *
+ *  \return Resident set size in bytes, or 0 if it could not be read
+ *
+ */
+long resident_set_size(void);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the time from a monotonic clock.
+ *
+ *  \return Time in seconds
+ *
+ */
+double seconds(void);
+
+/*!
+ *  \param argv[1] Largest number of threads
+ *  \param argv[2] Number of allocations and frees to perform on each thread in each run
+ */
+int main(int argc, char** argv) {
+
+    /* Results of all runs of this process, and their sums over all processes */
+    double* results = NULL;
+    double* all_results = NULL;
+    /* Results of one run */
+    double* run;
+    /* Corrupted objects on all processes */
+    double errors = 0.0;
+
+    /* Used for error handling */
+    int error_code;
+    /* Current scenario, allocator and number of threads */
+    int scenario, allocator, threads, thread_index;
+    /* Number of numbers of threads, i.e. 1, 2, 4, ... up to NUMBER_OF_PTHREADS */
+    int NUMBER_OF_THREAD_COUNTS = 0;
+    /* Largest number of threads */
+    int NUMBER_OF_PTHREADS;
+    /* Total number of processes used in this program */
+    int NUMBER_OF_PROCESSES;
+    /* Current process */
+    int PROCESS_ID;
+
+    /* Number of allocations and frees on each thread */
+    long OPERATIONS;
+
+    /* Used to time program execution */
+    double program_start;
+
+    /***************************************************************************************************/
+
+    if (argc != 3) {
+       printf("Usage: ./alloc ");
+       printf("[largest number of threads] [number of allocations and frees per thread]\n");
+       printf("Please try again.\n");
+       exit(1);
+    }
+
+    if ((NUMBER_OF_PTHREADS = atoi(argv[1])) <= 0) {
+       printf("Error: Invalid argument for number of threads. Please try again.\n");
+       exit(1);
+    }
+
+    if ((OPERATIONS = atol(argv[2])) < 4) {
+       printf("Error: Number of allocations and frees must be at least 4. Please try again.\n");
+       exit(1);
+    }
+
+    for (threads = 1; threads < NUMBER_OF_PTHREADS; threads *= 2) {
+        NUMBER_OF_THREAD_COUNTS++;
+    }
+    NUMBER_OF_THREAD_COUNTS++;
+
+    /***************************************************************************************************/
+
+    error_code = MPI_Init(&argc, &argv);
+    error_code = MPI_Comm_size(MPI_COMM_WORLD, &NUMBER_OF_PROCESSES);
+    error_code = MPI_Comm_rank(MPI_COMM_WORLD, &PROCESS_ID);
+
+    if (error_code != 0) {
+       printf("Error encountered while initializing MPI and obtaining task information.\n");
+       MPI_Finalize();
+       exit(1);
+    }
+
+    results = (double*) calloc(NUMBER_OF_SCENARIOS * NUMBER_OF_THREAD_COUNTS * NUMBER_OF_ALLOCATORS * RESULTS,
+                               sizeof(double));
+    all_results = (double*) calloc(NUMBER_OF_SCENARIOS * NUMBER_OF_THREAD_COUNTS * NUMBER_OF_ALLOCATORS * RESULTS,
+                                   sizeof(double));
+
+    if (results == NULL || all_results == NULL) {
+       printf("Memory allocation failed for results array! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Finalize();
+       exit(1);
+    }
+
+    /****************************************************************************************************
+    ** Run every scenario with every allocator and number of threads                                   **
+    ****************************************************************************************************/
+    program_start = seconds();
+
+    if (PROCESS_ID == MASTER) {
+       printf("\nRunning allocation scenarios with up to %d threads on each of the %d processes... ",
+              NUMBER_OF_PTHREADS, NUMBER_OF_PROCESSES);
+       fflush(stdout);
+    }
+
+    for (scenario = 0; scenario < NUMBER_OF_SCENARIOS; scenario++) {
+        for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+            for (allocator = 0; allocator < NUMBER_OF_ALLOCATORS; allocator++) {
+                run = &results[((scenario * NUMBER_OF_THREAD_COUNTS + thread_index) * NUMBER_OF_ALLOCATORS + allocator) * RESULTS];
+                if (run_alloc_test(scenario, allocator, (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS,
+                                   OPERATIONS, run) != 0) {
+                   printf("Memory allocation failed in %s scenario! ", ALLOCATOR_NAMES[allocator]);
+                   printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+                   MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+            }
+        }
+    }
+
+    MPI_Reduce(results, all_results, NUMBER_OF_SCENARIOS * NUMBER_OF_THREAD_COUNTS * NUMBER_OF_ALLOCATORS * RESULTS,
+               MPI_DOUBLE, MPI_SUM, MASTER, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Print results                                                                                   **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       const char* descriptions[NUMBER_OF_SCENARIOS] = {
+           "Size-class mix: each thread replaces random objects of 16 B to 4 KB",
+           "Producer/consumer: each object is freed by the next thread",
+           "Fragmentation: 64 B objects freed in a checkerboard, then 256 B objects"
+       };
+
+       printf("Success!\n\n");
+       printf("======================================================================\n");
+       printf("== Allocation test results                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Each thread performs about %ld allocations and frees in each run.\n", OPERATIONS);
+       printf("Mops/s counts the allocations and frees of all threads and processes.\n");
+       printf("RSS growth is the mean over all %d processes.\n\n", NUMBER_OF_PROCESSES);
+       for (scenario = 0; scenario < NUMBER_OF_SCENARIOS; scenario++) {
+           printf("%s\n\n", descriptions[scenario]);
+           printf("Threads  -------------- Mops/s ---------------   ---------- RSS growth (MB) ----------\n");
+           printf("       ");
+           for (allocator = 0; allocator < NUMBER_OF_ALLOCATORS; allocator++) {
+               printf("  %11s", ALLOCATOR_NAMES[allocator]);
+           }
+           printf(" ");
+           for (allocator = 0; allocator < NUMBER_OF_ALLOCATORS; allocator++) {
+               printf("  %11s", ALLOCATOR_NAMES[allocator]);
+           }
+           printf("\n");
+           for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+               run = &all_results[(scenario * NUMBER_OF_THREAD_COUNTS + thread_index) * NUMBER_OF_ALLOCATORS * RESULTS];
+               printf("%7d", (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS);
+               for (allocator = 0; allocator < NUMBER_OF_ALLOCATORS; allocator++) {
+                   printf("  %11.2f", run[allocator * RESULTS] / 1.0e6);
+               }
+               printf(" ");
+               for (allocator = 0; allocator < NUMBER_OF_ALLOCATORS; allocator++) {
+                   printf("  %11.1f", run[allocator * RESULTS + 1] / NUMBER_OF_PROCESSES / (1 << 20));
+                   errors += run[allocator * RESULTS + 2];
+               }
+               printf("\n");
+           }
+           printf("\n");
+       }
+
+       printf("======================================================================\n");
+       printf("== Summary                                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
+       printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
+       printf("Largest number of threads per process:       %10d\n\n", NUMBER_OF_PTHREADS);
+       printf("Objects that were corrupted:                 %10.0f\n\n", errors);
+       printf("Total runtime:                               %10.2f seconds\n\n", seconds() - program_start);
+    }
+
+    /***************************************************************************************************/
+
+    MPI_Bcast(&errors, 1, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+
+    free(all_results);
+    free(results);
+
+    MPI_Finalize();
+
+    return (errors == 0.0) ? 0 : 1;
+
+}
+
+int run_alloc_test(int scenario, int allocator, int threads, long operations, double* results) {
+
+    pthread_t alloc_threads[threads];
+    pthread_barrier_t barrier;
+    long rss_before, rss_after;
+    double start = 0.0, end = 0.0;
+    int i;
+
+    alloc_test_a* args = (alloc_test_a*) aligned_alloc(CACHE_LINE_SIZE, threads * sizeof(alloc_test_a));
+    thread_heap* heaps = (thread_heap*) aligned_alloc(CACHE_LINE_SIZE, threads * sizeof(thread_heap));
+    object_queue* queues = (object_queue*) aligned_alloc(CACHE_LINE_SIZE, threads * sizeof(object_queue));
+
+    if (args == NULL || heaps == NULL || queues == NULL) {
+       free(queues);
+       free(heaps);
+       free(args);
+       return -1;
+    }
+
+    memset(args, 0, threads * sizeof(alloc_test_a));
+    memset(heaps, 0, threads * sizeof(thread_heap));
+    memset(queues, 0, threads * sizeof(object_queue));
+
+    /***** Return memory that malloc kept from earlier runs, so that they do not hide its growth *****/
+    malloc_trim(0);
+
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+
+    for (i = 0; i < threads; i++) {
+        args[i].scenario = scenario;
+        args[i].allocator = allocator;
+        args[i].thread = i;
+        args[i].threads = threads;
+        args[i].operations = operations;
+        args[i].heap = &heaps[i];
+        args[i].queues = queues;
+        args[i].barrier = &barrier;
+        if (pthread_create(&alloc_threads[i], NULL, alloc_test, &args[i]) != 0) {
+           printf("Error encountered while creating pthread.\n");
+           MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    /***** Threads are ready to start *****/
+    pthread_barrier_wait(&barrier);
+    rss_before = resident_set_size();
+    pthread_barrier_wait(&barrier);
+
+    /***** Threads have finished, and live objects have not been freed yet *****/
+    pthread_barrier_wait(&barrier);
+    rss_after = resident_set_size();
+    pthread_barrier_wait(&barrier);
+
+    results[0] = 0.0;
+    results[2] = 0.0;
+    for (i = 0; i < threads; i++) {
+        pthread_join(alloc_threads[i], NULL);
+        results[0] += args[i].performed;
+        results[2] += args[i].errors;
+        start = (i == 0 || args[i].start < start) ? args[i].start : start;
+        end = (args[i].end > end) ? args[i].end : end;
+        free_chunks(&heaps[i]);
+    }
+    results[0] /= end - start;
+    results[1] = rss_after - rss_before;
+
+    pthread_barrier_destroy(&barrier);
+    free(queues);
+    free(heaps);
+    free(args);
+
+    return 0;
+
+}
+
+void* alloc_test(void* alloc_test_args) {
+
+    alloc_test_a* args = (alloc_test_a*) alloc_test_args;
+    thread_heap* heap = args->heap;
+    int allocator = args->allocator;
+    uint64_t state = 0x9e3779b97f4a7c15ULL * (args->thread + 1);
+    void* live[LIVE_OBJECTS];
+    void** small_objects = NULL;
+    void* object;
+    long count = 0, count_performed, i;
+
+    memset(live, 0, sizeof(live));
+
+    if (args->scenario == FRAGMENTATION) {
+       count = args->operations / 2;
+       small_objects = (void**) calloc(count, sizeof(void*));
+       if (small_objects == NULL) {
+          printf("Memory allocation failed for fragmentation scenario! Aborting program...\n");
+          MPI_Abort(MPI_COMM_WORLD, 1);
+       }
+       /***** Touch the list before the RSS is measured *****/
+       memset(small_objects, 0, count * sizeof(void*));
+    }
+
+    pthread_barrier_wait(args->barrier);
+    pthread_barrier_wait(args->barrier);
+    args->start = seconds();
+
+    if (args->scenario == SIZE_CLASS_MIX) {
+       while (args->performed < args->operations) {
+             i = next_random(&state) % LIVE_OBJECTS;
+             if (live[i] != NULL) {
+                delete_object(args, live[i]);
+             }
+             live[i] = new_object(heap, allocator, random_size(&state));
+             args->performed++;
+       }
+    }
+    else if (args->scenario == PRODUCER_CONSUMER) {
+       object_queue* out = &args->queues[(args->thread + 1) % args->threads];
+       object_queue* in = &args->queues[args->thread];
+       long produced = 0, consumed = 0, target = args->operations / 2;
+       long head, tail;
+       int progress;
+
+       while (produced < target || consumed < target) {
+             progress = 0;
+             tail = atomic_load_explicit(&out->tail, memory_order_relaxed);
+             if (produced < target && tail - atomic_load_explicit(&out->head, memory_order_acquire) < QUEUE_LENGTH) {
+                out->slots[tail & (QUEUE_LENGTH - 1)] = new_object(heap, allocator, random_size(&state));
+                atomic_store_explicit(&out->tail, tail + 1, memory_order_release);
+                args->performed++;
+                produced++;
+                progress = 1;
+             }
+             head = atomic_load_explicit(&in->head, memory_order_relaxed);
+             if (consumed < target && head < atomic_load_explicit(&in->tail, memory_order_acquire)) {
+                object = in->slots[head & (QUEUE_LENGTH - 1)];
+                atomic_store_explicit(&in->head, head + 1, memory_order_release);
+                delete_object(args, object);
+                consumed++;
+                progress = 1;
+             }
+             /***** The next thread's queue is full and ours is empty, so let the others run *****/
+             if (progress == 0) {
+                sched_yield();
+             }
+       }
+    }
+    else {
+       for (i = 0; i < count; i++) {
+           small_objects[i] = new_object(heap, allocator, SMALL_OBJECT);
+           args->performed++;
+       }
+       for (i = 1; i < count; i += 2) {
+           delete_object(args, small_objects[i]);
+       }
+       for (i = 1; i < count; i += 2) {
+           small_objects[i] = new_object(heap, allocator, LARGE_OBJECT);
+           args->performed++;
+       }
+    }
+
+    args->end = seconds();
+    pthread_barrier_wait(args->barrier);
+    pthread_barrier_wait(args->barrier);
+
+    /***** Free the objects that are still live; these frees are not timed or counted *****/
+    count_performed = args->performed;
+    for (i = 0; i < LIVE_OBJECTS; i++) {
+        if (live[i] != NULL) {
+           delete_object(args, live[i]);
+        }
+    }
+    for (i = 0; i < count; i++) {
+        delete_object(args, small_objects[i]);
+    }
+    free(small_objects);
+    args->performed = count_performed;
+
+    return NULL;
+
+}
+
+void* allocate(thread_heap* heap, int allocator, size_t size) {
+    size_t* block;
+    int size_class = 0;
+
+    if (allocator == MALLOC_ALLOCATOR) {
+       return malloc(size);
+    }
+
+    if (allocator == ARENA_ALLOCATOR) {
+       return carve(heap, (size + 15) & ~(size_t) 15);
+    }
+
+    while ((size_t) POOL_SMALLEST_CLASS << size_class < size + POOL_HEADER) {
+          size_class++;
+    }
+    if (size_class >= POOL_CLASSES) {
+       return NULL;
+    }
+    if (heap->free_lists[size_class] != NULL) {
+       block = (size_t*) heap->free_lists[size_class];
+       heap->free_lists[size_class] = *(void**) block;
+    }
+    else if ((block = (size_t*) carve(heap, (size_t) POOL_SMALLEST_CLASS << size_class)) == NULL) {
+       return NULL;
+    }
+    block[0] = size_class;
+    return (char*) block + POOL_HEADER;
+}
+
+void release(thread_heap* heap, int allocator, void* object) {
+    size_t* block;
+    size_t size_class;
+
+    if (allocator == MALLOC_ALLOCATOR) {
+       free(object);
+    }
+    else if (allocator == POOL_ALLOCATOR) {
+       /***** The link to the next free object replaces the size class *****/
+       block = (size_t*) ((char*) object - POOL_HEADER);
+       size_class = block[0];
+       *(void**) block = heap->free_lists[size_class];
+       heap->free_lists[size_class] = block;
+    }
+}
+
+void* carve(thread_heap* heap, size_t size) {
+    char* chunk;
+    size_t chunk_size;
+
+    if (heap->chunk == NULL || heap->used + size > heap->size) {
+       /***** The first 16 bytes of a chunk link it to the previous chunk and hold its size *****/
+       chunk_size = (size + 16 > CHUNK_SIZE) ? size + 16 : CHUNK_SIZE;
+       chunk = (char*) mmap(NULL, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+       if (chunk == MAP_FAILED) {
+          return NULL;
+       }
+       ((char**) chunk)[0] = heap->chunks;
+       ((size_t*) chunk)[1] = chunk_size;
+       heap->chunks = chunk;
+       heap->chunk = chunk;
+       heap->size = chunk_size;
+       heap->used = 16;
+    }
+
+    chunk = heap->chunk + heap->used;
+    heap->used += size;
+    return chunk;
+}
+
+void free_chunks(thread_heap* heap) {
+    char* chunk;
+
+    while ((chunk = heap->chunks) != NULL) {
+          heap->chunks = ((char**) chunk)[0];
+          munmap(chunk, ((size_t*) chunk)[1]);
+    }
+    memset(heap, 0, sizeof(thread_heap));
+}
+
+void* new_object(thread_heap* heap, int allocator, size_t size) {
+    size_t* object = (size_t*) allocate(heap, allocator, size);
+
+    if (object == NULL) {
+       printf("Memory allocation failed for object of %lu bytes! Aborting program...\n", (unsigned long) size);
+       MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    object[0] = size;
+    ((char*) object)[size - 1] = (char) size;
+    return object;
+}
+
+void delete_object(alloc_test_a* output, void* object) {
+    size_t size = ((size_t*) object)[0];
+
+    if (size < SMALLEST_OBJECT || size > LARGEST_OBJECT || ((char*) object)[size - 1] != (char) size) {
+       output->errors++;
+    }
+    release(output->heap, output->allocator, object);
+    output->performed++;
+}
+
+size_t random_size(uint64_t* state) {
+    uint64_t random = next_random(state);
+    /***** Sizes up to 64 bytes, then (64, 128], (128, 256], ..., each half as likely *****/
+    int power = 6;
+    while (power < 12 && (random & 1) == 1) {
+          power++;
+          random >>= 1;
+    }
+    if (power == 6) {
+       return SMALLEST_OBJECT + (random >> 8) % (64 - SMALLEST_OBJECT + 1);
+    }
+    return ((size_t) 1 << (power - 1)) + 1 + (random >> 8) % ((size_t) 1 << (power - 1));
+}
+
+uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+long resident_set_size(void) {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    long size, resident = 0;
+
+    if (statm == NULL) {
+       return 0;
+    }
+    if (fscanf(statm, "%ld %ld", &size, &resident) != 2) {
+       resident = 0;
+    }
+    fclose(statm);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+double seconds(void) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec + now.tv_nsec / 1.0e9;
+}
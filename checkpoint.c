@@ -0,0 +1,588 @@
+/*!
+ *
+ *  \file    checkpoint.c
+ *  \brief   Benchmarks writing and restarting from checkpoints in different file layouts
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this program works:
+ *           Each process holds S bytes of state, which it writes to a checkpoint and then reads
+ *           back as if the job were restarting, in T bytes per write or read call. The checkpoint
+ *           is written in four layouts:
+ *           \arg file per process (N-to-N): every process writes its own file.
+ *           \arg shared file, segmented (N-to-1): every process writes its state as one contiguous
+ *                segment of a single file.
+ *           \arg shared file, strided (N-to-1): the processes take turns writing T bytes each, so
+ *                the blocks of all processes are interleaved in a single file.
+ *           \arg subfiled: the first process on each node is an aggregator. It receives the state
+ *                of the other processes on its node and writes the states of all of them to one
+ *                file per node.
+ *
+ *           Every layout is run R times. Each run creates the files, writes the state and calls
+ *           MPI_File_sync, closes the files, opens them again, reads the state back, closes them
+ *           and deletes them. Between closing and opening the files, which is not timed, every
+ *           process that opened a file drops its pages from the page cache of its node, so the
+ *           restart reads the checkpoint from storage and not from memory. The processes wait for
+ *           each other between these steps, and each step is timed on the slowest process. The program displays the write and restart-read
+ *           bandwidth of all processes, and the time of the metadata operations (create, open,
+ *           close and delete) of each layout. The state of every run is different, and the state
+ *           that is read back is checked, so a stale or misplaced block is counted as an error.
+ *
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <mpi.h>
+
+/*! Master process. Usually process 0. */
+#define MASTER                     0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS                "unknown"
+#endif
+
+/*! Every process writes its own file */
+#define FILE_PER_PROCESS           0
+/*! Every process writes one contiguous segment of a shared file */
+#define SHARED_SEGMENTED           1
+/*! The processes write interleaved blocks of a shared file */
+#define SHARED_STRIDED             2
+/*! One aggregator per node writes the state of the processes on its node */
+#define SUBFILED                   3
+/*! Number of layouts */
+#define NUMBER_OF_LAYOUTS          4
+
+/*! Names of the layouts, in the order of their numbers */
+static const char* const LAYOUT_NAMES[] = {
+    "file per process", "shared, segmented", "shared, strided", "subfiled, per node"
+};
+
+/*! Steps of a checkpoint and a restart, in the order in which they are run */
+#define CREATE_STEP                0
+#define WRITE_STEP                 1
+#define CLOSE_WRITTEN_STEP         2
+#define OPEN_STEP                  3
+#define READ_STEP                  4
+#define CLOSE_READ_STEP            5
+#define REMOVE_STEP                6
+/*! Number of steps */
+#define NUMBER_OF_STEPS            7
+
+/*! Message identifier for sending blocks of state to and from an aggregator */
+#define BLOCK_TAG                  0
+
+/*!
+ *  \brief State of a process and the layout of the processes on the nodes
+ */
+typedef struct checkpoint_context {
+    /* Directory in which the files are written */
+    const char* directory;
+    /* State of this process, and a block that an aggregator receives into or sends from */
+    char* state;
+    char* block;
+    /* Bytes of state per process, and bytes per write or read call */
+    long state_size;
+    int transfer_size;
+    int process;
+    int processes;
+    /* Processes on the same node as this one, and the number of this process among them */
+    MPI_Comm node;
+    int node_process;
+    int node_processes;
+    /* Number of this node, and the number of nodes */
+    int node_number;
+    int nodes;
+} checkpoint_context;
+
+/***************************************************************************************************/
+
+/*!
+ *
+ *  \par Description:
+ *  Writes one checkpoint in a layout and restarts from it, and returns the time of each step on
+ *  the slowest process.
+ *
+ *  \param context State of this process
+ *  \param layout Layout of the checkpoint
+ *  \param run Number of the run, which selects the contents of the state
+ *  \param times Time of each step in seconds
+ *
+ *  \return Number of wrong words that were read back on this process
+ *
+ */
+long checkpoint_test(checkpoint_context* context, int layout, int run, double* times);
+
+/*!
+ *
+ *  \par Description:
+ *  Writes or reads the state of this process in a layout. In the subfiled layout, the aggregator
+ *  moves the state of every process on its node, and the other processes send it their state or
+ *  receive it.
+ *
+ *  \param context State of this process
+ *  \param layout Layout of the checkpoint
+ *  \param file File that this process opened, or MPI_FILE_NULL
+ *  \param write 1 to write the state, 0 to read it
+ *
+ */
+void transfer_state(checkpoint_context* context, int layout, MPI_File file, int write);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the name of the file that this process opens in a layout.
+ *
+ *  \param context State of this process
+ *  \param layout Layout of the checkpoint
+ *  \param filename Buffer of FILENAME_MAX characters for the name
+ *
+ *  \return 1 if this process opens a file in the layout, 0 otherwise
+ *
+ */
+int checkpoint_filename(checkpoint_context* context, int layout, char* filename);
+
+/*!
+ *
+ *  \par Description:
+ *  Drops the cached pages of a file that was written and synced, so that the next read of the
+ *  file goes to storage.
+ *
+ *  \param filename Name of the file
+ *
+ *  \return 0 if the pages were dropped, 1 otherwise
+ *
+ */
+int evict_file(const char* filename);
+
+/*!
+ *
+ *  \par Description:
+ *  Fills the state of a process for a run. Word i of the state holds the process, the run and i,
+ *  so a block that lands in the wrong place, or is left over from another run, does not match.
+ *
+ *  \param state State
+ *  \param words Number of 64-bit words in the state
+ *  \param process Process that owns the state
+ *  \param run Number of the run
+ *
+ */
+void fill_state(long* state, long words, int process, int run);
+
+/*!
+ *
+ *  \par Description:
+ *  Counts the words of a state that do not match the ones that \b fill_state wrote.
+ *
+ *  \return Number of wrong words
+ *
+ */
+long check_state(const long* state, long words, int process, int run);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the time from a monotonic clock.
+ *
+ *  \return Time in seconds
+ *
+ */
+double seconds(void);
+
+/*!
+ *  \param argv[1] Directory in which to write the checkpoints
+ *  \param argv[2] Number of bytes of state per process
+ *  \param argv[3] Number of bytes per write or read call
+ *  \param argv[4] Number of checkpoints to write in each layout
+ */
+int main(int argc, char** argv) {
+
+    /* State of this process */
+    checkpoint_context context;
+    /* Time of each step of one run, and the shortest time of each step over all runs */
+    double times[NUMBER_OF_STEPS];
+    double best[NUMBER_OF_LAYOUTS][NUMBER_OF_STEPS];
+    /* Number of files that each layout creates */
+    int files[NUMBER_OF_LAYOUTS];
+    /* Wrong words read back on this process and on all processes */
+    long errors = 0;
+    long all_errors = 0;
+
+    /* Communicator of the aggregators, one per node */
+    MPI_Comm aggregators;
+
+    /* Used for error handling */
+    int error_code;
+    /* Current layout, run and step */
+    int layout, run, step;
+    /* Number of checkpoints to write in each layout */
+    int NUMBER_OF_RUNS;
+    /* Total number of processes used in this program */
+    int NUMBER_OF_PROCESSES;
+    /* Current process */
+    int PROCESS_ID;
+
+    /* Bytes of state on all processes */
+    double bytes;
+    /* Time of the metadata operations of a layout */
+    double metadata;
+
+    /* Used to time program execution */
+    double program_start;
+
+    /***************************************************************************************************/
+
+    if (argc != 5) {
+       printf("Usage: ./checkpoint ");
+       printf("[directory] [bytes of state per process] [bytes per write or read] [number of checkpoints]\n");
+       printf("Please try again.\n");
+       exit(1);
+    }
+
+    memset(&context, 0, sizeof(checkpoint_context));
+    context.directory = argv[1];
+
+    if ((context.state_size = atol(argv[2])) <= 0) {
+       printf("Error: Invalid argument for bytes of state per process. Please try again.\n");
+       exit(1);
+    }
+
+    if (atol(argv[3]) <= 0 || atol(argv[3]) > INT_MAX || atol(argv[3]) % sizeof(long) != 0) {
+       printf("Error: Bytes per write or read must be a positive multiple of %d. Please try again.\n",
+              (int) sizeof(long));
+       exit(1);
+    }
+
+    context.transfer_size = atoi(argv[3]);
+
+    if (context.state_size % context.transfer_size != 0) {
+       printf("Error: Bytes of state must be a multiple of bytes per write or read. Please try again.\n");
+       exit(1);
+    }
+
+    if ((NUMBER_OF_RUNS = atoi(argv[4])) <= 0) {
+       printf("Error: Invalid argument for number of checkpoints. Please try again.\n");
+       exit(1);
+    }
+
+    /***************************************************************************************************/
+
+    error_code = MPI_Init(&argc, &argv);
+    error_code = MPI_Comm_size(MPI_COMM_WORLD, &NUMBER_OF_PROCESSES);
+    error_code = MPI_Comm_rank(MPI_COMM_WORLD, &PROCESS_ID);
+
+    if (error_code != 0) {
+       printf("Error encountered while initializing MPI and obtaining task information.\n");
+       MPI_Finalize();
+       exit(1);
+    }
+
+    context.process = PROCESS_ID;
+    context.processes = NUMBER_OF_PROCESSES;
+    context.state = (char*) malloc(context.state_size);
+    context.block = (char*) malloc(context.transfer_size);
+
+    if (context.state == NULL || context.block == NULL) {
+       printf("Memory allocation failed for arrays! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Finalize();
+       exit(1);
+    }
+
+    /***** The first process on each node is its aggregator, and the aggregators number the nodes *****/
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, PROCESS_ID, MPI_INFO_NULL, &context.node);
+    MPI_Comm_rank(context.node, &context.node_process);
+    MPI_Comm_size(context.node, &context.node_processes);
+    MPI_Comm_split(MPI_COMM_WORLD, (context.node_process == 0) ? 0 : MPI_UNDEFINED, PROCESS_ID, &aggregators);
+    if (context.node_process == 0) {
+       MPI_Comm_rank(aggregators, &context.node_number);
+       MPI_Comm_size(aggregators, &context.nodes);
+       MPI_Comm_free(&aggregators);
+    }
+    MPI_Bcast(&context.node_number, 1, MPI_INT, 0, context.node);
+    MPI_Bcast(&context.nodes, 1, MPI_INT, 0, context.node);
+
+    files[FILE_PER_PROCESS] = NUMBER_OF_PROCESSES;
+    files[SHARED_SEGMENTED] = 1;
+    files[SHARED_STRIDED] = 1;
+    files[SUBFILED] = context.nodes;
+
+    /****************************************************************************************************
+    ** Write and restart from checkpoints in every layout                                              **
+    ****************************************************************************************************/
+    program_start = seconds();
+
+    if (PROCESS_ID == MASTER) {
+       printf("\nWriting checkpoints of %ld bytes per process on %d processes and %d nodes to %s... ",
+              context.state_size, NUMBER_OF_PROCESSES, context.nodes, context.directory);
+       fflush(stdout);
+    }
+
+    for (layout = 0; layout < NUMBER_OF_LAYOUTS; layout++) {
+        for (run = 0; run < NUMBER_OF_RUNS; run++) {
+            errors += checkpoint_test(&context, layout, run, times);
+            for (step = 0; step < NUMBER_OF_STEPS; step++) {
+                if (run == 0 || times[step] < best[layout][step]) {
+                   best[layout][step] = times[step];
+                }
+            }
+        }
+    }
+
+    MPI_Allreduce(&errors, &all_errors, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Print results                                                                                   **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       bytes = (double) context.state_size * NUMBER_OF_PROCESSES;
+       printf("Success!\n\n");
+       printf("======================================================================\n");
+       printf("== Checkpoint results                                               ==\n");
+       printf("======================================================================\n\n");
+       printf("Each checkpoint holds %.3f GB of state, written and read %d bytes\n", bytes / 1.0e9,
+              context.transfer_size);
+       printf("at a time. Times are the shortest of %d runs on the slowest process.\n", NUMBER_OF_RUNS);
+       printf("Writes include MPI_File_sync. Metadata is the sum of create, open,\n");
+       printf("both closes and delete, in milliseconds.\n\n");
+       printf("Layout                  Files   Write GB/s    Read GB/s   Create   Open    Close   Delete   Metadata\n");
+       printf("--------------------   ------   ----------   ----------   ------   -----   -----   ------   --------\n");
+       for (layout = 0; layout < NUMBER_OF_LAYOUTS; layout++) {
+           metadata = best[layout][CREATE_STEP] + best[layout][CLOSE_WRITTEN_STEP] + best[layout][OPEN_STEP] +
+                      best[layout][CLOSE_READ_STEP] + best[layout][REMOVE_STEP];
+           printf("%-20s   %6d   %10.3f   %10.3f   %6.1f   %5.1f   %5.1f   %6.1f   %8.1f\n", LAYOUT_NAMES[layout],
+                  files[layout], bytes / best[layout][WRITE_STEP] / 1.0e9, bytes / best[layout][READ_STEP] / 1.0e9,
+                  1.0e3 * best[layout][CREATE_STEP], 1.0e3 * best[layout][OPEN_STEP],
+                  1.0e3 * (best[layout][CLOSE_WRITTEN_STEP] + best[layout][CLOSE_READ_STEP]),
+                  1.0e3 * best[layout][REMOVE_STEP], 1.0e3 * metadata);
+       }
+       printf("\n");
+
+       printf("======================================================================\n");
+       printf("== Summary                                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
+       printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
+       printf("Number of nodes (aggregators):               %10d\n", context.nodes);
+       printf("Bytes of state per process:                  %10ld\n", context.state_size);
+       printf("Bytes per write or read:                     %10d\n\n", context.transfer_size);
+       printf("Wrong words read back:                       %10ld\n\n", all_errors);
+       printf("Total runtime:                               %10.2f seconds\n\n", seconds() - program_start);
+    }
+
+    /***************************************************************************************************/
+
+    MPI_Comm_free(&context.node);
+    free(context.block);
+    free(context.state);
+
+    MPI_Finalize();
+
+    return (all_errors == 0) ? 0 : 1;
+
+}
+
+long checkpoint_test(checkpoint_context* context, int layout, int run, double* times) {
+
+    char filename[FILENAME_MAX];
+    MPI_File file = MPI_FILE_NULL;
+    /* Files in the shared layouts are opened by all processes together */
+    MPI_Comm communicator = (layout == SHARED_SEGMENTED || layout == SHARED_STRIDED) ? MPI_COMM_WORLD : MPI_COMM_SELF;
+    int opens = checkpoint_filename(context, layout, filename);
+    long words = context->state_size / sizeof(long);
+    double start;
+    int step;
+
+    fill_state((long*) context->state, words, context->process, run);
+
+    for (step = 0; step < NUMBER_OF_STEPS; step++) {
+        if (step == OPEN_STEP && opens && evict_file(filename) != 0) {
+           /***** The restart may then be served from memory, so the read rate is too high *****/
+           printf("Warning: Unable to drop %s from the page cache on process %d.\n", filename, context->process);
+        }
+        if (step == READ_STEP) {
+           /***** Nothing of the state that was written is left in memory *****/
+           memset(context->state, 0, context->state_size);
+        }
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = MPI_Wtime();
+
+        switch (step) {
+        case CREATE_STEP:
+        case OPEN_STEP:
+            if (opens && MPI_File_open(communicator, filename, (step == CREATE_STEP) ?
+                                       MPI_MODE_CREATE | MPI_MODE_WRONLY : MPI_MODE_RDONLY,
+                                       MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+               printf("Error: Unable to open %s on process %d.\nAborting program...\n", filename, context->process);
+               MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            break;
+        case WRITE_STEP:
+            transfer_state(context, layout, file, 1);
+            if (opens) {
+               MPI_File_sync(file);
+            }
+            break;
+        case READ_STEP:
+            transfer_state(context, layout, file, 0);
+            break;
+        case CLOSE_WRITTEN_STEP:
+        case CLOSE_READ_STEP:
+            if (opens) {
+               MPI_File_close(&file);
+            }
+            break;
+        case REMOVE_STEP:
+            /***** A shared file is deleted once, by the master *****/
+            if (opens && (communicator == MPI_COMM_SELF || context->process == MASTER)) {
+               MPI_File_delete(filename, MPI_INFO_NULL);
+            }
+            break;
+        }
+
+        times[step] = MPI_Wtime() - start;
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, times, NUMBER_OF_STEPS, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    return check_state((long*) context->state, words, context->process, run);
+
+}
+
+void transfer_state(checkpoint_context* context, int layout, MPI_File file, int write) {
+
+    long blocks = context->state_size / context->transfer_size;
+    long block;
+    int size = context->transfer_size;
+    int process;
+    char* buffer;
+    MPI_Offset offset;
+    MPI_Status status;
+
+    if (layout == SUBFILED && context->node_process != 0) {
+       /***** The aggregator moves the blocks of one process after another, in order *****/
+       for (block = 0; block < blocks; block++) {
+           if (write) {
+              MPI_Send(context->state + block * size, size, MPI_BYTE, 0, BLOCK_TAG, context->node);
+           }
+           else {
+              MPI_Recv(context->state + block * size, size, MPI_BYTE, 0, BLOCK_TAG, context->node, &status);
+           }
+       }
+       return;
+    }
+
+    if (layout != SUBFILED) {
+       for (block = 0; block < blocks; block++) {
+           switch (layout) {
+           case FILE_PER_PROCESS:
+               offset = (MPI_Offset) block * size;
+               break;
+           case SHARED_SEGMENTED:
+               offset = (MPI_Offset) context->process * context->state_size + (MPI_Offset) block * size;
+               break;
+           default:
+               offset = ((MPI_Offset) block * context->processes + context->process) * size;
+               break;
+           }
+           if (write) {
+              MPI_File_write_at(file, offset, context->state + block * size, size, MPI_BYTE, &status);
+           }
+           else {
+              MPI_File_read_at(file, offset, context->state + block * size, size, MPI_BYTE, &status);
+           }
+       }
+       return;
+    }
+
+    /***** Aggregator: the state of process p on the node is segment p of the node's file *****/
+    for (process = 0; process < context->node_processes; process++) {
+        for (block = 0; block < blocks; block++) {
+            offset = (MPI_Offset) process * context->state_size + (MPI_Offset) block * size;
+            buffer = (process == 0) ? context->state + block * size : context->block;
+            if (write) {
+               if (process > 0) {
+                  MPI_Recv(buffer, size, MPI_BYTE, process, BLOCK_TAG, context->node, &status);
+               }
+               MPI_File_write_at(file, offset, buffer, size, MPI_BYTE, &status);
+            }
+            else {
+               MPI_File_read_at(file, offset, buffer, size, MPI_BYTE, &status);
+               if (process > 0) {
+                  MPI_Send(buffer, size, MPI_BYTE, process, BLOCK_TAG, context->node);
+               }
+            }
+        }
+    }
+
+}
+
+int checkpoint_filename(checkpoint_context* context, int layout, char* filename) {
+
+    switch (layout) {
+    case FILE_PER_PROCESS:
+        snprintf(filename, FILENAME_MAX, "%s/checkpoint.process.%d", context->directory, context->process);
+        return 1;
+    case SUBFILED:
+        snprintf(filename, FILENAME_MAX, "%s/checkpoint.node.%d", context->directory, context->node_number);
+        return context->node_process == 0;
+    default:
+        snprintf(filename, FILENAME_MAX, "%s/checkpoint.shared", context->directory);
+        return 1;
+    }
+
+}
+
+int evict_file(const char* filename) {
+
+    int descriptor = open(filename, O_RDONLY);
+    int status;
+
+    if (descriptor < 0) {
+       return 1;
+    }
+    /***** The pages are clean after MPI_File_sync, so the kernel can drop all of them *****/
+    fdatasync(descriptor);
+    status = posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED);
+    close(descriptor);
+
+    return (status == 0) ? 0 : 1;
+
+}
+
+void fill_state(long* state, long words, int process, int run) {
+
+    long i;
+
+    for (i = 0; i < words; i++) {
+        state[i] = ((long) process << 44) | ((long) (run & 0xFF) << 36) | i;
+    }
+
+}
+
+long check_state(const long* state, long words, int process, int run) {
+
+    long i, errors = 0;
+
+    for (i = 0; i < words; i++) {
+        if (state[i] != (((long) process << 44) | ((long) (run & 0xFF) << 36) | i)) {
+           errors++;
+        }
+    }
+
+    return errors;
+
+}
+
+double seconds(void) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec + now.tv_nsec / 1.0e9;
+}
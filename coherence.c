@@ -0,0 +1,610 @@
+/*!
+ *
+ *  \file    coherence.c
+ *  \brief   Measures the cost of moving cache lines between cores
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this program works:
+ *           Each process runs two tests:
+ *           \arg Counters: with 1, 2, 4, ... up to N threads, each thread increments a counter M
+ *                times. The counters are laid out in three ways:
+ *                padded, where every counter is on its own cache line, so the threads never share
+ *                a line; unpadded, where the counters are next to each other, so the threads write
+ *                to different words of the same line (false sharing) and the line moves between
+ *                their cores on almost every increment; and atomic, where all threads add to one
+ *                counter with an atomic fetch-and-add (true sharing).
+ *           \arg Ping-pong: for every pair of hardware threads that the process may run on, two
+ *                threads pinned to them take turns writing to one cache line, each waiting until
+ *                it sees the other's write. Half of the time of a round trip is the latency of
+ *                moving a line from one core to the other.
+ *
+ *           The program displays the increments per second of all threads and processes for each
+ *           layout, and a matrix of the core-to-core latencies of each process. Processes run the
+ *           ping-pong test one at a time, so that processes on the same node do not disturb each
+ *           other. Every counter is checked at the end of a run, and the program exits with
+ *           status 1 if an increment was lost.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+#include <pthread.h>
+
+/*! Master process. Usually process 0. */
+#define MASTER                     0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS                "unknown"
+#endif
+/*! Size of a cache line */
+#define CACHE_LINE_SIZE            64
+
+/*! Every counter is on its own cache line */
+#define PADDED_COUNTERS            0
+/*! Counters are next to each other and share cache lines */
+#define UNPADDED_COUNTERS          1
+/*! All threads add to one counter atomically */
+#define SHARED_ATOMIC              2
+/*! Number of counter layouts */
+#define NUMBER_OF_LAYOUTS          3
+
+/*! Largest number of hardware threads in the latency matrix */
+#define MATRIX_CPUS               64
+
+/*! Names of the counter layouts, in the order of their numbers */
+static const char* const LAYOUT_NAMES[] = { "padded", "unpadded", "atomic" };
+
+/*!
+ *  \brief Arguments for and output from a thread in the counter test
+ */
+typedef struct counter_test_a {
+    int layout;
+    long increments;
+    /* Counter that the thread increments, or the shared counter */
+    volatile long* counter;
+    _Atomic long* shared;
+    /* Used by all threads to start together */
+    pthread_barrier_t* barrier;
+    /* Output: times when the thread started and finished */
+    double start;
+    double end;
+} __attribute__((aligned(CACHE_LINE_SIZE))) counter_test_a;
+
+/*!
+ *  \brief Arguments for and output from a thread in the ping-pong test
+ */
+typedef struct ping_pong_a {
+    /* Cache line that the two threads write to */
+    _Atomic long* line;
+    /* Hardware thread to run on */
+    int cpu;
+    /* 0 for the thread that writes first, 1 for the other */
+    int player;
+    long round_trips;
+    pthread_barrier_t* barrier;
+    /* Output: times when the thread started and finished */
+    double start;
+    double end;
+} __attribute__((aligned(CACHE_LINE_SIZE))) ping_pong_a;
+
+/***************************************************************************************************/
+
+/*!
+ *
+ *  \par Description:
+ *  Runs the counter test with one layout and a number of threads, and measures the increments per
+ *  second, from the time the first thread starts until the last thread finishes.
+ *
+ *  \param layout \b PADDED_COUNTERS, \b UNPADDED_COUNTERS or \b SHARED_ATOMIC
+ *  \param threads Number of threads
+ *  \param increments Number of increments on each thread
+ *  \param lost Incremented by the number of increments that are missing from the counters
+ *
+ *  \return Increments per second, or -1 if memory allocation failed
+ *
+ */
+double run_counter_test(int layout, int threads, long increments, long* lost);
+
+/*!
+ *
+ *  \par Description:
+ *  Increments a counter on one thread.
+ *
+ *  \param counter_test_args Struct that contains the layout and the counter of the thread
+ *
+ *  \return NULL
+ *
+ */
+void* counter_test(void* counter_test_args);
+
+/*!
+ *
+ *  \par Description:
+ *  Bounces a cache line between two hardware threads, and measures the latency of moving it from
+ *  one to the other.
+ *
+ *  \param first First hardware thread
+ *  \param second Second hardware thread
+ *  \param round_trips Number of round trips
+ *
+ *  \return One-way latency in seconds, or -1 if memory allocation failed
+ *
+ */
+double run_ping_pong(int first, int second, long round_trips);
+
+/*!
+ *
+ *  \par Description:
+ *  Pins the calling thread to a hardware thread and takes turns with another thread writing to a
+ *  cache line.
+ *
+ *  \param ping_pong_args Struct that contains the cache line, the hardware thread and the turn
+ *
+ *  \return NULL
+ *
+ */
+void* ping_pong(void* ping_pong_args);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the time from a monotonic clock.
+ *
+ *  \return Time in seconds
+ *
+ */
+double seconds(void);
+
+/*!
+ *  \param argv[1] Largest number of threads for the counter test
+ *  \param argv[2] Number of increments to perform on each thread in each run
+ *  \param argv[3] Number of round trips between each pair of hardware threads
+ */
+int main(int argc, char** argv) {
+
+    /* Increments per second of each layout and number of threads on this process, and their sums
+       over all processes */
+    double* rates = NULL;
+    double* all_rates = NULL;
+    /* One-way latencies between the hardware threads of this process, and of all processes */
+    double* latencies = NULL;
+    double* all_latencies = NULL;
+    /* Hardware threads of this process, and of all processes */
+    int cpus[MATRIX_CPUS];
+    int* all_cpus = NULL;
+    /* Node names of all processes */
+    char host[MPI_MAX_PROCESSOR_NAME];
+    char* hosts = NULL;
+    /* Increments that were lost on this process, and on all processes */
+    long lost = 0;
+    long all_lost = 0;
+
+    /* Used for error handling */
+    int error_code;
+    /* Current layout, number of threads, process and pair of hardware threads */
+    int layout, threads, thread_index, process, i, j, length;
+    /* Number of numbers of threads, i.e. 1, 2, 4, ... up to NUMBER_OF_PTHREADS */
+    int NUMBER_OF_THREAD_COUNTS = 0;
+    /* Largest number of threads */
+    int NUMBER_OF_PTHREADS;
+    /* Number of hardware threads in the latency matrix of every process */
+    int NUMBER_OF_CPUS = 0;
+    /* Total number of processes used in this program */
+    int NUMBER_OF_PROCESSES;
+    /* Current process */
+    int PROCESS_ID;
+
+    /* Number of increments on each thread, and of round trips between each pair */
+    long INCREMENTS, ROUND_TRIPS;
+
+    /* Used to display the latency matrix */
+    cpu_set_t allowed;
+    double latency, minimum, maximum, sum;
+
+    /* Used to time program execution */
+    double program_start;
+
+    /***************************************************************************************************/
+
+    if (argc != 4) {
+       printf("Usage: ./coherence ");
+       printf("[largest number of threads] [number of increments per thread] [number of round trips]\n");
+       printf("Please try again.\n");
+       exit(1);
+    }
+
+    if ((NUMBER_OF_PTHREADS = atoi(argv[1])) <= 0) {
+       printf("Error: Invalid argument for number of threads. Please try again.\n");
+       exit(1);
+    }
+
+    if ((INCREMENTS = atol(argv[2])) <= 0) {
+       printf("Error: Invalid argument for number of increments. Please try again.\n");
+       exit(1);
+    }
+
+    if ((ROUND_TRIPS = atol(argv[3])) <= 0) {
+       printf("Error: Invalid argument for number of round trips. Please try again.\n");
+       exit(1);
+    }
+
+    for (threads = 1; threads < NUMBER_OF_PTHREADS; threads *= 2) {
+        NUMBER_OF_THREAD_COUNTS++;
+    }
+    NUMBER_OF_THREAD_COUNTS++;
+
+    /***************************************************************************************************/
+
+    error_code = MPI_Init(&argc, &argv);
+    error_code = MPI_Comm_size(MPI_COMM_WORLD, &NUMBER_OF_PROCESSES);
+    error_code = MPI_Comm_rank(MPI_COMM_WORLD, &PROCESS_ID);
+
+    if (error_code != 0) {
+       printf("Error encountered while initializing MPI and obtaining task information.\n");
+       MPI_Finalize();
+       exit(1);
+    }
+
+    /***** Every process measures the same number of hardware threads, so that the matrices can be gathered *****/
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+       CPU_SET(sched_getcpu(), &allowed);
+    }
+    for (i = 0; i < CPU_SETSIZE && NUMBER_OF_CPUS < MATRIX_CPUS; i++) {
+        if (CPU_ISSET(i, &allowed)) {
+           cpus[NUMBER_OF_CPUS++] = i;
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &NUMBER_OF_CPUS, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+    memset(host, 0, sizeof(host));
+    MPI_Get_processor_name(host, &length);
+
+    rates = (double*) calloc(NUMBER_OF_THREAD_COUNTS * NUMBER_OF_LAYOUTS, sizeof(double));
+    all_rates = (double*) calloc(NUMBER_OF_THREAD_COUNTS * NUMBER_OF_LAYOUTS, sizeof(double));
+    latencies = (double*) calloc(NUMBER_OF_CPUS * NUMBER_OF_CPUS, sizeof(double));
+    all_latencies = (double*) calloc((size_t) NUMBER_OF_PROCESSES * NUMBER_OF_CPUS * NUMBER_OF_CPUS, sizeof(double));
+    all_cpus = (int*) calloc((size_t) NUMBER_OF_PROCESSES * NUMBER_OF_CPUS, sizeof(int));
+    hosts = (char*) calloc((size_t) NUMBER_OF_PROCESSES * MPI_MAX_PROCESSOR_NAME, sizeof(char));
+
+    if (rates == NULL || all_rates == NULL || latencies == NULL || all_latencies == NULL || all_cpus == NULL || hosts == NULL) {
+       printf("Memory allocation failed for results arrays! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Finalize();
+       exit(1);
+    }
+
+    /****************************************************************************************************
+    ** Run the counter test with every layout and number of threads                                    **
+    ****************************************************************************************************/
+    program_start = seconds();
+
+    if (PROCESS_ID == MASTER) {
+       printf("\nRunning counter test with up to %d threads on each of the %d processes... ",
+              NUMBER_OF_PTHREADS, NUMBER_OF_PROCESSES);
+       fflush(stdout);
+    }
+
+    for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+        for (layout = 0; layout < NUMBER_OF_LAYOUTS; layout++) {
+            rates[thread_index * NUMBER_OF_LAYOUTS + layout] =
+                run_counter_test(layout, (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS, INCREMENTS, &lost);
+            if (rates[thread_index * NUMBER_OF_LAYOUTS + layout] < 0.0) {
+               printf("Memory allocation failed for %s counters! ", LAYOUT_NAMES[layout]);
+               printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+               MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+    }
+
+    MPI_Reduce(rates, all_rates, NUMBER_OF_THREAD_COUNTS * NUMBER_OF_LAYOUTS, MPI_DOUBLE, MPI_SUM, MASTER, MPI_COMM_WORLD);
+    MPI_Allreduce(&lost, &all_lost, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Run the ping-pong test between every pair of hardware threads, one process at a time            **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       printf("Success!\n");
+       printf("Running ping-pong test on %d hardware threads of each of the %d processes... ",
+              NUMBER_OF_CPUS, NUMBER_OF_PROCESSES);
+       fflush(stdout);
+    }
+
+    for (process = 0; process < NUMBER_OF_PROCESSES; process++) {
+        if (process == PROCESS_ID) {
+           for (i = 0; i < NUMBER_OF_CPUS; i++) {
+               for (j = i + 1; j < NUMBER_OF_CPUS; j++) {
+                   if ((latency = run_ping_pong(cpus[i], cpus[j], ROUND_TRIPS)) < 0.0) {
+                      printf("Memory allocation failed for ping-pong test! ");
+                      printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+                      MPI_Abort(MPI_COMM_WORLD, 1);
+                   }
+                   latencies[i * NUMBER_OF_CPUS + j] = latency;
+                   latencies[j * NUMBER_OF_CPUS + i] = latency;
+               }
+           }
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    MPI_Gather(latencies, NUMBER_OF_CPUS * NUMBER_OF_CPUS, MPI_DOUBLE, all_latencies, NUMBER_OF_CPUS * NUMBER_OF_CPUS,
+               MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+    MPI_Gather(cpus, NUMBER_OF_CPUS, MPI_INT, all_cpus, NUMBER_OF_CPUS, MPI_INT, MASTER, MPI_COMM_WORLD);
+    MPI_Gather(host, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, hosts, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, MASTER, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Print results                                                                                   **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       printf("Success!\n\n");
+       printf("======================================================================\n");
+       printf("== Counter test results                                             ==\n");
+       printf("======================================================================\n\n");
+       printf("Each thread increments a counter %ld times in each run. Padded\n", INCREMENTS);
+       printf("counters are on separate cache lines, unpadded counters share lines\n");
+       printf("(false sharing), and atomic counters are one counter that all\n");
+       printf("threads add to with fetch-and-add. Mops/s counts the increments of\n");
+       printf("all threads and processes.\n\n");
+       printf("Threads  ------------------- Mops/s -------------------   Unpadded   Atomic\n");
+       printf("       ");
+       for (layout = 0; layout < NUMBER_OF_LAYOUTS; layout++) {
+           printf("  %14s", LAYOUT_NAMES[layout]);
+       }
+       printf("   slowdown   slowdown\n");
+       for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+           printf("%7d", (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS);
+           for (layout = 0; layout < NUMBER_OF_LAYOUTS; layout++) {
+               printf("  %14.2f", all_rates[thread_index * NUMBER_OF_LAYOUTS + layout] / 1.0e6);
+           }
+           printf("   %7.1fx   %5.1fx\n",
+                  all_rates[thread_index * NUMBER_OF_LAYOUTS + PADDED_COUNTERS] / all_rates[thread_index * NUMBER_OF_LAYOUTS + UNPADDED_COUNTERS],
+                  all_rates[thread_index * NUMBER_OF_LAYOUTS + PADDED_COUNTERS] / all_rates[thread_index * NUMBER_OF_LAYOUTS + SHARED_ATOMIC]);
+       }
+       printf("\n");
+
+       printf("======================================================================\n");
+       printf("== Core-to-core latency results                                     ==\n");
+       printf("======================================================================\n\n");
+       printf("Two threads pinned to a pair of hardware threads take turns writing\n");
+       printf("to a cache line %ld times. Each latency is half of a round trip, in\n", ROUND_TRIPS);
+       printf("nanoseconds. Rows and columns are numbered by hardware thread.\n\n");
+       for (process = 0; process < NUMBER_OF_PROCESSES; process++) {
+           printf("Process %d (%s):\n\n", process, hosts + (size_t) process * MPI_MAX_PROCESSOR_NAME);
+           if (NUMBER_OF_CPUS < 2) {
+              printf("Only one hardware thread is available. Start the processes with\n");
+              printf("e.g. mpirun --bind-to none to measure the latency between cores.\n\n");
+              continue;
+           }
+           printf("   CPU");
+           for (j = 0; j < NUMBER_OF_CPUS; j++) {
+               printf(" %6d", all_cpus[process * NUMBER_OF_CPUS + j]);
+           }
+           printf("\n");
+           minimum = 0.0;
+           maximum = 0.0;
+           sum = 0.0;
+           for (i = 0; i < NUMBER_OF_CPUS; i++) {
+               printf("%6d", all_cpus[process * NUMBER_OF_CPUS + i]);
+               for (j = 0; j < NUMBER_OF_CPUS; j++) {
+                   if (i == j) {
+                      printf(" %6s", "-");
+                      continue;
+                   }
+                   latency = all_latencies[((size_t) process * NUMBER_OF_CPUS + i) * NUMBER_OF_CPUS + j] * 1.0e9;
+                   printf(" %6.1f", latency);
+                   minimum = (minimum == 0.0 || latency < minimum) ? latency : minimum;
+                   maximum = (latency > maximum) ? latency : maximum;
+                   sum += latency;
+               }
+               printf("\n");
+           }
+           printf("\nLatency: minimum %.1f ns, mean %.1f ns, maximum %.1f ns\n\n", minimum,
+                  sum / (NUMBER_OF_CPUS * (NUMBER_OF_CPUS - 1)), maximum);
+       }
+
+       printf("======================================================================\n");
+       printf("== Summary                                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
+       printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
+       printf("Largest number of threads per process:       %10d\n", NUMBER_OF_PTHREADS);
+       printf("Hardware threads per process in matrix:      %10d\n\n", NUMBER_OF_CPUS);
+       printf("Increments that were lost:                   %10ld\n\n", all_lost);
+       printf("Total runtime:                               %10.2f seconds\n\n", seconds() - program_start);
+    }
+
+    /***************************************************************************************************/
+
+    free(hosts);
+    free(all_cpus);
+    free(all_latencies);
+    free(latencies);
+    free(all_rates);
+    free(rates);
+
+    MPI_Finalize();
+
+    return (all_lost == 0) ? 0 : 1;
+
+}
+
+double run_counter_test(int layout, int threads, long increments, long* lost) {
+
+    pthread_t counter_threads[threads];
+    pthread_barrier_t barrier;
+    double start = 0.0, end = 0.0;
+    long total = 0;
+    int i;
+
+    counter_test_a* args = (counter_test_a*) aligned_alloc(CACHE_LINE_SIZE, threads * sizeof(counter_test_a));
+    /***** One cache line per thread holds every layout: padded counters use all of them *****/
+    char* counters = (char*) aligned_alloc(CACHE_LINE_SIZE, threads * CACHE_LINE_SIZE);
+
+    if (args == NULL || counters == NULL) {
+       free(counters);
+       free(args);
+       return -1.0;
+    }
+
+    memset(args, 0, threads * sizeof(counter_test_a));
+    memset(counters, 0, threads * CACHE_LINE_SIZE);
+
+    pthread_barrier_init(&barrier, NULL, threads);
+
+    for (i = 0; i < threads; i++) {
+        args[i].layout = layout;
+        args[i].increments = increments;
+        args[i].counter = (layout == PADDED_COUNTERS) ? (volatile long*) (counters + i * CACHE_LINE_SIZE)
+                                                      : (volatile long*) counters + i;
+        args[i].shared = (_Atomic long*) counters;
+        args[i].barrier = &barrier;
+        if (pthread_create(&counter_threads[i], NULL, counter_test, &args[i]) != 0) {
+           printf("Error encountered while creating pthread.\n");
+           MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    for (i = 0; i < threads; i++) {
+        pthread_join(counter_threads[i], NULL);
+        start = (i == 0 || args[i].start < start) ? args[i].start : start;
+        end = (args[i].end > end) ? args[i].end : end;
+        if (layout != SHARED_ATOMIC) {
+           total += *args[i].counter;
+        }
+    }
+    if (layout == SHARED_ATOMIC) {
+       total = atomic_load(args[0].shared);
+    }
+    *lost += (long) threads * increments - total;
+
+    pthread_barrier_destroy(&barrier);
+    free(counters);
+    free(args);
+
+    return threads * increments / (end - start);
+
+}
+
+void* counter_test(void* counter_test_args) {
+
+    counter_test_a* args = (counter_test_a*) counter_test_args;
+    volatile long* counter = args->counter;
+    _Atomic long* shared = args->shared;
+    long i, increments = args->increments;
+
+    pthread_barrier_wait(args->barrier);
+    args->start = seconds();
+
+    if (args->layout == SHARED_ATOMIC) {
+       for (i = 0; i < increments; i++) {
+           atomic_fetch_add_explicit(shared, 1, memory_order_relaxed);
+       }
+    }
+    else {
+       /***** volatile keeps every increment a load and a store to the counter's cache line *****/
+       for (i = 0; i < increments; i++) {
+           (*counter)++;
+       }
+    }
+
+    args->end = seconds();
+
+    return NULL;
+
+}
+
+double run_ping_pong(int first, int second, long round_trips) {
+
+    pthread_t players[2];
+    pthread_barrier_t barrier;
+    double latency;
+    int i;
+
+    ping_pong_a* args = (ping_pong_a*) aligned_alloc(CACHE_LINE_SIZE, 2 * sizeof(ping_pong_a));
+    _Atomic long* line = (_Atomic long*) aligned_alloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE);
+
+    if (args == NULL || line == NULL) {
+       free((void*) line);
+       free(args);
+       return -1.0;
+    }
+
+    memset(args, 0, 2 * sizeof(ping_pong_a));
+    atomic_init(line, 0);
+
+    pthread_barrier_init(&barrier, NULL, 2);
+
+    for (i = 0; i < 2; i++) {
+        args[i].line = line;
+        args[i].cpu = (i == 0) ? first : second;
+        args[i].player = i;
+        args[i].round_trips = round_trips;
+        args[i].barrier = &barrier;
+        if (pthread_create(&players[i], NULL, ping_pong, &args[i]) != 0) {
+           printf("Error encountered while creating pthread.\n");
+           MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    for (i = 0; i < 2; i++) {
+        pthread_join(players[i], NULL);
+    }
+
+    pthread_barrier_destroy(&barrier);
+    free((void*) line);
+
+    /***** The first thread writes first and sees the last write, so it times whole round trips *****/
+    latency = (args[0].end - args[0].start) / (2.0 * round_trips);
+    free(args);
+
+    return latency;
+
+}
+
+void* ping_pong(void* ping_pong_args) {
+
+    ping_pong_a* args = (ping_pong_a*) ping_pong_args;
+    _Atomic long* line = args->line;
+    long i, turn;
+    cpu_set_t cpu;
+
+    CPU_ZERO(&cpu);
+    CPU_SET(args->cpu, &cpu);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu);
+
+    pthread_barrier_wait(args->barrier);
+    args->start = seconds();
+
+    /***** The first thread waits for even values and the second for odd ones *****/
+    for (i = 0; i < args->round_trips; i++) {
+        turn = 2 * i + args->player;
+        while (atomic_load_explicit(line, memory_order_acquire) != turn);
+        atomic_store_explicit(line, turn + 1, memory_order_release);
+    }
+
+    /***** Wait for the last write of the other thread, so that the last round trip is complete *****/
+    if (args->player == 0) {
+       while (atomic_load_explicit(line, memory_order_acquire) != 2 * args->round_trips);
+    }
+
+    args->end = seconds();
+
+    return NULL;
+
+}
+
+double seconds(void) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec + now.tv_nsec / 1.0e9;
+}
@@ -11,8 +11,11 @@
  *
  *  \details \par How this program works:
  *           This program benchmarks the performance of the CPU and virtual memory. First, in the
- *           CPU test, each process creates N pthreads. Each pthread takes the square root of a
- *           random number between 0 and \b RAND_MAX, and repeats this calculation M times. The
+ *           CPU test, each process creates a pool of N pthreads. Each pthread takes the square root
+ *           of a random number between 0 and \b RAND_MAX, and repeats this calculation M times. The
+ *           square roots are taken \b CPU_TEST_BATCH at a time by a kernel that is compiled for
+ *           AVX-512, AVX2 and the baseline; the variant that matches the CPU is picked when the
+ *           program loads, and every process reports which variant it ran. The
  *           program times how long it takes each pthread to perform all M calculations and then
  *           displays the results. Next, in the virtual memory test, each process allocates an
  *           array whose size varies during each of the P runs and are between the minimum and
@@ -22,41 +25,153 @@
  *           went to sleep. The program times how long it takes each process to perform the memory
  *           test P times and then displays the results.
  *
+ *           \par Thread pool:
+ *           The pthreads are created once and wait at a barrier until they are given a task, so
+ *           the time to create them is not part of any test; it is displayed on its own as the
+ *           thread spawn overhead of each process. All pthreads leave the barrier together and
+ *           then start their clocks, and each one writes its results to its own slot, which was
+ *           allocated before the test on a separate cache line. The pattern test runs on the same
+ *           pthreads.
+ *
+ *           \par Scaling sweep:
+ *           If the number of pthreads is 0, each process uses one pthread for every hardware thread
+ *           that it may run on, including SMT siblings, and after the CPU test it runs the test
+ *           again on 1, 2, 4, ... pthreads, on one pthread per core, and on all of them. The
+ *           program displays the square roots per second of all pthreads, the parallel efficiency
+ *           of each number of pthreads, and the gain from running a second pthread on each core.
+ *           The PIN environment variable pins pthread i to the i-th hardware thread in compact
+ *           order (all SMT siblings of a core, then the next core) or scattered order (one
+ *           hardware thread of each core, alternating between sockets, before any SMT sibling),
+ *           so that the point where frequency throttling or shared caches limit the scaling can
+ *           be seen.
+ *
+ *           \par Pages:
+ *           The array in the memory test is allocated with \b page_alloc, so the PAGES environment
+ *           variable selects 4 KB pages, transparent huge pages, or 2 MB or 1 GB hugetlbfs pages. The
+ *           data TLB load misses of each process while it fills and checks its arrays are displayed
+ *           with its runtime.
+ *
+ *           \par Page-fault test:
+ *           Instead of sleeping, the memory test can measure the cost of getting memory from the
+ *           kernel for array sizes that double from the minimum to the maximum size. First, 1, 2,
+ *           4, ... up to N threads touch every page of a new mapping at the same time, and the
+ *           number of page faults per second is displayed per thread and for all threads; page
+ *           faults on one mapping take the same lock, so the rate per thread drops as threads are
+ *           added if the lock is contended. Then one thread times \b munmap of a touched array,
+ *           \b calloc followed by touching every page, zeroing a touched array with \b memset, and
+ *           \b mmap with \b MAP_POPULATE followed by touching every page. Each measurement is
+ *           averaged over P runs and over all processes.
+ *
+ *           \par Pattern test:
+ *           For node acceptance, the memory test can instead check memory the way memtester does.
+ *           Each process splits an array of the maximum size among N threads, and each thread
+ *           writes and checks its part with walking ones, walking zeros, the address of each word
+ *           stored in the word, random words, and moving inversions of all zeros, all ones and a
+ *           random word. Words are written and compared \b PATTERN_BLOCK at a time by kernels that
+ *           are compiled for AVX-512, AVX2 and the baseline, so that the test runs at the bandwidth
+ *           of the memory; only a block that contains a mismatch is searched one word at a time.
+ *           The patterns are repeated P times with new random words. The program displays the
+ *           number of bytes that each process checked per second, the number of words that did
+ *           not match, and the address, pattern and contents of the first word that did not match.
+ *
  */
 
+#define _GNU_SOURCE
+
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <mpi.h>
 /*! Pthreads are used in CPU test */
 #include <pthread.h>
+#include "dispatch.h"
+#include "pagealloc.h"
 
 /*! Master process. Usually process 0. */
 #define MASTER      0
 #define TRUE        1
 #define FALSE       0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
 /*! Used in memory test. PASS if memory allocation was successful and no errors were encountered */
 #define PASS        0
 /*! Used in memory test. FAIL if memory allocation was not successful or errors were encountered */
 #define FAIL       -1
+/*! Size of a cache line. Results written by different pthreads are kept on different lines. */
+#define CACHE_LINE_SIZE     64
+/*! Environment variable that selects how pthreads are pinned to hardware threads */
+#define PIN_VARIABLE        "PIN"
+/*! Pthreads are not pinned */
+#define PIN_NONE            0
+/*! Pthreads fill all SMT siblings of a core before the next core */
+#define PIN_COMPACT         1
+/*! Pthreads take one hardware thread of each core before any SMT sibling */
+#define PIN_SCATTER         2
+/*! Used in scaling sweep. Largest number of numbers of pthreads that are tested. */
+#define MAX_SWEEPS          64
+/*! Used in CPU test. Number of random numbers whose square roots are taken at a time. */
+#define CPU_TEST_BATCH 1024
+/*! Memory test that fills an array, sleeps, and checks the array */
+#define SLEEP_TEST          1
+/*! Memory test that measures page faults and the cost of allocating and freeing memory */
+#define PAGE_FAULT_TEST     2
+/*! Used in page-fault test. Results for each number of threads: faults/s per thread, faults/s, faults per page. */
+#define FAULT_RESULTS       3
+/*! Used in page-fault test. Results for each size: munmap, calloc, zeroing, MAP_POPULATE and touch times. */
+#define ALLOCATION_RESULTS  5
+/*! Memory test that writes and checks patterns like memtester */
+#define PATTERN_TEST        3
+/*! Used in pattern test. Number of 64-bit words that are written and checked at a time. */
+#define PATTERN_BLOCK       4096
+/*! Used in pattern test. Every word holds the same value. */
+#define CONSTANT_WORDS      0
+/*! Used in pattern test. Every word holds its own address. */
+#define ADDRESS_WORDS       1
+/*! Used in pattern test. Every word holds a random value computed from a seed and its address. */
+#define RANDOM_WORDS        2
+/*! Used in pattern test. Number of values sent to Master for a process: words that did not match,
+    and the address, pattern, expected value and contents of the first of them. */
+#define FAILURE_RESULTS     5
+
+/*! Names of the ways that pthreads are pinned, in the order of their numbers */
+static const char* const PIN_MODE_NAMES[] = { "none", "compact", "scatter" };
+
+/*! Used in pattern test. Names of the patterns, in the order in which they are run. */
+static const char* const PATTERN_NAMES[] = { "walking ones", "walking zeros", "address in address",
+                                             "random words", "moving inversions" };
 
 /*!
- *  \brief Arguments for the CPU test
+ *  \brief Output from the CPU test, on its own cache line
  */
-typedef struct cpu_test_a {
+typedef struct cpu_test_o {
     int process_id;
-    long runs;
-} cpu_test_a;
+    double runtime;
+    long pthread_id;
+    /* Times when the pthread started and finished, from a monotonic clock */
+    double start;
+    double end;
+} __attribute__((aligned(CACHE_LINE_SIZE))) cpu_test_o;
 
 /*!
- *  \brief Output from the CPU test
+ *  \brief Arguments for the CPU test
  */
-typedef struct cpu_test_o {
+typedef struct cpu_test_a {
     int process_id;
-    double runtime;
-    long pthread_id;
-} cpu_test_o;
+    long runs;
+    /* Seed of the pthread's own generator, since rand() takes a lock that all pthreads share */
+    unsigned int seed;
+    /* Slot that the pthread writes its results to */
+    cpu_test_o* output;
+} cpu_test_a;
 
 /*!
  *  \brief Arguments for the memory test
@@ -73,17 +188,224 @@ typedef struct mem_test_a {
 typedef struct mem_test_o {
     int process_id;
     char result;
+    /* Data TLB load misses while filling and checking the array, or -1 if not counted */
+    long long tlb_misses;
 } mem_test_o;
 
+/*!
+ *  \brief Arguments for a thread in the page-fault test
+ */
+typedef struct fault_test_a {
+    char* region;
+    long length;
+    long page_size;
+    pthread_barrier_t* barrier;
+} fault_test_a;
+
+/*!
+ *  \brief Output from a thread in the page-fault test
+ */
+typedef struct fault_test_o {
+    double start;
+    double end;
+    long faults;
+} fault_test_o;
+
+/*!
+ *  \brief Output from a thread in the pattern test, on its own cache line
+ */
+typedef struct pattern_test_o {
+    double runtime;
+    double bytes;
+    long long errors;
+    /* Address, pattern, expected value and contents of the first word that did not match */
+    long long address;
+    long long pattern;
+    long long expected;
+    long long actual;
+} __attribute__((aligned(CACHE_LINE_SIZE))) pattern_test_o;
+
+/*!
+ *  \brief Arguments for a thread in the pattern test
+ */
+typedef struct pattern_test_a {
+    uint64_t* words;
+    long length;
+    int runs;
+    uint64_t seed;
+    /* Slot that the thread writes its results to */
+    pattern_test_o* output;
+} pattern_test_a;
+
+/*!
+ *  \brief Pthreads that are created once and then run one task after another
+ */
+typedef struct thread_pool {
+    int threads;
+    pthread_t* pthreads;
+    /* Held while the pthreads are created, and the number of them that were. The pthreads exit at
+       once if fewer than \b threads could be created. */
+    pthread_mutex_t creating;
+    int created;
+    /* Argument of \b pool_worker for each pthread */
+    struct pool_worker_a* workers;
+    /* Pthreads wait at start until they are given a task, and at finish when they are done */
+    pthread_barrier_t start;
+    pthread_barrier_t finish;
+    /* Hardware thread that each pthread is pinned to, in order, or NULL if they are not pinned */
+    int* cpus;
+    int number_of_cpus;
+    /* Task that the first \b active pthreads run, or NULL to make the pthreads exit */
+    void* (*task)(void*);
+    int active;
+    /* Arguments of the task, one for each pthread, each \b arg_size bytes long */
+    char* args;
+    size_t arg_size;
+} thread_pool;
+
+/*!
+ *  \brief Argument for a pthread in a thread pool
+ */
+typedef struct pool_worker_a {
+    thread_pool* pool;
+    int index;
+} pool_worker_a;
+
+/*!
+ *  \brief Location of a hardware thread in the topology of the node
+ */
+typedef struct hardware_thread {
+    int cpu;
+    int package;
+    /* Position of its core among the cores of its package */
+    int core;
+    /* Position of the hardware thread among the SMT siblings of its core */
+    int sibling;
+} hardware_thread;
+
 /***************************************************************************************************/
 
+/*!
+ *
+ *  \par Description:
+ *  Creates a pool of pthreads, and returns when all of them are waiting for a task.
+ *
+ *  \param pool Empty thread pool
+ *  \param threads Number of pthreads
+ *  \param cpus Hardware threads to pin the pthreads to, in order, or NULL to not pin them. If
+ *              there are more pthreads than hardware threads, the order starts again.
+ *  \param number_of_cpus Number of hardware threads in \b cpus
+ *
+ *  \return 0 if successful or -1 if the pthreads could not be created, in which case the ones
+ *          that were created have exited and the pool holds nothing
+ *
+ */
+int pool_create(thread_pool* pool, int threads, int* cpus, int number_of_cpus);
+
+/*!
+ *
+ *  \par Description:
+ *  Runs a task on the first pthreads in a pool, starting them all at the same time, and returns
+ *  when all of them have finished. The other pthreads wait.
+ *
+ *  \param pool Thread pool
+ *  \param task Function to run
+ *  \param args Array of one argument for each pthread
+ *  \param arg_size Size of each argument in bytes
+ *  \param threads Number of pthreads that run the task
+ *
+ */
+void pool_run(thread_pool* pool, void* (*task)(void*), void* args, size_t arg_size, int threads);
+
+/*!
+ *
+ *  \par Description:
+ *  Makes the pthreads in a pool exit, and waits for them.
+ *
+ *  \param pool Thread pool
+ *
+ */
+void pool_destroy(thread_pool* pool);
+
+/*!
+ *
+ *  \par Description:
+ *  Runs the tasks given to a pool on one pthread until the pool is destroyed.
+ *
+ *  \param pool_worker_args Struct that contains the pool and the index of the pthread
+ *
+ *  \return NULL
+ *
+ */
+void* pool_worker(void* pool_worker_args);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the way that pthreads are pinned, selected with the PIN environment variable. An unknown
+ *  value does not pin them.
+ *
+ *  \return \b PIN_NONE, \b PIN_COMPACT or \b PIN_SCATTER
+ *
+ */
+int pin_mode(void);
+
+/*!
+ *
+ *  \par Description:
+ *  Finds the hardware threads that this process may run on, and the core and package of each one
+ *  from /sys/devices/system/cpu, and sorts them in the order that pthreads are pinned in.
+ *
+ *  \param pin \b PIN_NONE, \b PIN_COMPACT or \b PIN_SCATTER. Without pinning, the compact order
+ *             is used.
+ *  \param cpus Array of \b CPU_SETSIZE elements for the numbers of the hardware threads
+ *  \param cores Number of cores that the hardware threads belong to
+ *
+ *  \return Number of hardware threads
+ *
+ */
+int hardware_threads(int pin, int* cpus, int* cores);
+
+/*!
+ *
+ *  \par Description:
+ *  Reads a number from a file in /sys/devices/system/cpu/cpuN/topology.
+ *
+ *  \param cpu Number of the hardware thread
+ *  \param name Name of the file, e.g. "core_id"
+ *
+ *  \return The number, or -1 if it could not be read
+ *
+ */
+int read_topology(int cpu, const char* name);
+
+/*!
+ *
+ *  \par Description:
+ *  Compares two hardware threads for sorting them in compact order: by package, then core, then
+ *  SMT sibling.
+ *
+ */
+int compare_compact(const void* first, const void* second);
+
+/*!
+ *
+ *  \par Description:
+ *  Compares two hardware threads for sorting them in scattered order: by SMT sibling, then core,
+ *  then package.
+ *
+ */
+int compare_scatter(const void* first, const void* second);
+
 /*!
  *
  *  \par Description:
  *  Tests a node's CPU power by taking the square root of a number between 0 and RAND_MAX a certain
  *  number of times.
  *
- *  \param cpu_test_args Struct that contains the ID of a process
+ *  \param cpu_test_args Struct that contains the ID of a process and the slot for the results
+ *
+ *  \return NULL
  *
  */
 void* cpu_test(void* cpu_test_args);
@@ -91,8 +413,18 @@ void* cpu_test(void* cpu_test_args);
 /*!
  *
  *  \par Description:
- *  Tests a node's virtual memory by allocating an array of characters on the heap, filling the
- *  array with the letter 'B', and checking to see whether the virtual memory is corrupted.
+ *  Replaces each of \b CPU_TEST_BATCH numbers with its square root.
+ *
+ *  \param numbers Array of \b CPU_TEST_BATCH numbers that are not negative
+ *
+ */
+KERNEL_CLONES void take_square_roots(double* numbers);
+
+/*!
+ *
+ *  \par Description:
+ *  Tests a node's virtual memory by allocating an array of characters with \b page_alloc, filling
+ *  the array with the letter 'B', and checking to see whether the virtual memory is corrupted.
  *
  *  \param mem_test_args Struct that contains the ID of a process, array size, and a pointer to
  *                       a timespec struct, which is used for making a process go to sleep for N seconds
@@ -102,6 +434,130 @@ void* cpu_test(void* cpu_test_args);
  */
 mem_test_o* mem_test(mem_test_a* mem_test_args);
 
+/*!
+ *
+ *  \par Description:
+ *  Writes to the first byte of every page in a region after all threads reach a barrier, and
+ *  counts the page faults that the thread took.
+ *
+ *  \param fault_test_args Struct that contains the region, its length, the page size and the barrier
+ *
+ *  \return A \c fault_test_o struct that contains the start and end times and the number of faults
+ *
+ */
+void* touch_pages(void* fault_test_args);
+
+/*!
+ *
+ *  \par Description:
+ *  Maps an array and has a number of threads touch different parts of it at the same time.
+ *
+ *  \param size Size of array in bytes
+ *  \param threads Number of threads
+ *  \param results Faults per second per thread, faults per second for all threads, and faults
+ *                  per page
+ *
+ */
+void page_fault_test(long size, int threads, double* results);
+
+/*!
+ *
+ *  \par Description:
+ *  Times, on one thread, \b munmap of a touched array, \b calloc followed by touching every page,
+ *  \b memset of a touched array to zero, and \b mmap with \b MAP_POPULATE followed by touching
+ *  every page.
+ *
+ *  \param size Size of array in bytes
+ *  \param results Seconds for \b munmap, seconds for \b calloc and touching, bytes per second
+ *                  zeroed, seconds for \b MAP_POPULATE, and seconds for touching afterwards
+ *
+ */
+void allocation_test(long size, double* results);
+
+/*!
+ *
+ *  \par Description:
+ *  Writes and checks every pattern on part of an array, and repeats all of them a number of times.
+ *
+ *  \param pattern_test_args Struct that contains the part of the array, its length in words, the
+ *                           number of runs, the seed for random words and the slot for the
+ *                           runtime, the number of bytes checked and the first word that did
+ *                           not match
+ *
+ *  \return NULL
+ *
+ */
+void* pattern_test(void* pattern_test_args);
+
+/*!
+ *
+ *  \par Description:
+ *  Fills words with the same value, with their addresses, or with random values.
+ *
+ *  \param words Array of words
+ *  \param length Number of words
+ *  \param kind \b CONSTANT_WORDS, \b ADDRESS_WORDS or \b RANDOM_WORDS
+ *  \param value Value of every word, or the seed for random words
+ *
+ */
+KERNEL_CLONES void fill_words(uint64_t* words, long length, int kind, uint64_t value);
+
+/*!
+ *
+ *  \par Description:
+ *  Compares words with the values written by \b fill_words.
+ *
+ *  \param words Array of words
+ *  \param length Number of words
+ *  \param kind \b CONSTANT_WORDS, \b ADDRESS_WORDS or \b RANDOM_WORDS
+ *  \param value Value of every word, or the seed for random words
+ *
+ *  \return Bitwise OR of the differences, which is 0 if every word matches
+ *
+ */
+KERNEL_CLONES uint64_t check_words(const uint64_t* words, long length, int kind, uint64_t value);
+
+/*!
+ *
+ *  \par Description:
+ *  Checks words block by block, and searches a block that does not match one word at a time to
+ *  count the words that do not match and record the first of them.
+ *
+ *  \param output Output of the thread, which is updated
+ *  \param words Array of words
+ *  \param length Number of words
+ *  \param kind \b CONSTANT_WORDS, \b ADDRESS_WORDS or \b RANDOM_WORDS
+ *  \param value Value of every word, or the seed for random words
+ *  \param pattern Index of the pattern in \b PATTERN_NAMES
+ *
+ */
+void verify_words(pattern_test_o* output, const uint64_t* words, long length, int kind, uint64_t value,
+                  int pattern);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the value that \b fill_words writes to a word.
+ *
+ *  \param word Address of the word
+ *  \param kind \b CONSTANT_WORDS, \b ADDRESS_WORDS or \b RANDOM_WORDS
+ *  \param value Value of every word, or the seed for random words
+ *
+ *  \return Expected value of the word
+ *
+ */
+static inline uint64_t expected_word(const uint64_t* word, int kind, uint64_t value);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the time from a monotonic clock. Safe to call from any thread.
+ *
+ *  \return Time in seconds
+ *
+ */
+double seconds(void);
+
 /*!
  *
  *  \par Description:
@@ -114,12 +570,13 @@ mem_test_o* mem_test(mem_test_a* mem_test_args);
 void initialize(char* array, long length);
 
 /*!
- *  \param argv[1] Number of pthreads to use for CPU test
+ *  \param argv[1] Number of pthreads to use for CPU test, or 0 for one per hardware thread and a scaling sweep
  *  \param argv[2] Number of times to repeat CPU test
  *  \param argv[3] Minimum size of array for memory test
  *  \param argv[4] Maximum size of array for memory test
- *  \param argv[5] Number of seconds to sleep during memory test
+ *  \param argv[5] Number of seconds to sleep during the sleep test. Ignored by the other tests.
  *  \param argv[6] Number of times to repeat memory test
+ *  \param argv[7] (Optional) 1 for sleep test (default), 2 for page-fault test or 3 for pattern test
  */
 int main(int argc, char** argv) {
 
@@ -128,6 +585,25 @@ int main(int argc, char** argv) {
 
     /* Runtime of a process */
     double runtime;
+    /* Time to create the thread pool of a process */
+    double spawn_time;
+    /* Time to create the thread pool of all processes */
+    double* spawn_times = NULL;
+
+    /* Used in scaling sweep. Square roots per second of all pthreads of a process and of all processes. */
+    double sweep_rates[MAX_SWEEPS];
+    double all_sweep_rates[MAX_SWEEPS];
+    /* Used in scaling sweep. Numbers of pthreads that are tested. */
+    int sweep_threads[MAX_SWEEPS];
+    int NUMBER_OF_SWEEPS = 0;
+    /* TRUE if the CPU test is repeated for different numbers of pthreads */
+    int CPU_SWEEP = FALSE;
+    /* How pthreads are pinned: PIN_NONE, PIN_COMPACT or PIN_SCATTER */
+    int PIN;
+    /* Hardware threads and cores that this process may run on */
+    int HARDWARE_THREADS, CORES;
+    /* Hardware threads in the order that pthreads are pinned to them */
+    int* cpus = NULL;
 
     /* Contains runtimes of pthreads for a process */
     double* pthread_runtimes = NULL;
@@ -136,17 +612,26 @@ int main(int argc, char** argv) {
     /* Contains runtimes for memory test for all processes */
     double* mem_test_runtimes = NULL;
 
+    /* Data TLB load misses of a process during memory test, or -1 if not counted */
+    long long tlb_misses = 0;
+    /* Data TLB load misses of all processes during memory test */
+    long long* mem_test_tlb_misses = NULL;
+
     int counter; /* loop counter */
     /* Used for error handling */
     int error_code;
     /* Message identifier for sending/receiving pthread IDs to/from processes */
     int ID_TAG = 0;
     /* Number of pthreads to use per process */
-    int NUMBER_OF_PTHREADS;
+    int NUMBER_OF_PTHREADS = 0;
     /* Total number of processes used in this program */
     int NUMBER_OF_PROCESSES;
     /* Number of times to repeat memory test */
     int NUMBER_OF_RUNS;
+    /* 1 for sleep test, 2 for page-fault test or 3 for pattern test */
+    int MEMORY_TEST = SLEEP_TEST;
+    /* Used in page-fault test. Number of array sizes and of numbers of threads. */
+    int NUMBER_OF_SIZES = 0, NUMBER_OF_THREAD_COUNTS = 0;
     /* Current element in array */
     int position;
     /* Current process */
@@ -155,6 +640,8 @@ int main(int argc, char** argv) {
     int RUNTIME_TAG = 1;
     /* Process that sends data to other processes */
     int source;
+    /* Message identifier for sending/receiving TLB misses to/from a process */
+    int TLB_TAG = 2;
 
     /* Contains IDs of processes to whom pthreads belong for CPU test */
     int* all_process_ids = NULL;
@@ -169,6 +656,17 @@ int main(int argc, char** argv) {
     /* Contains IDs of pthreads for all processes */
     long* all_pthread_ids = NULL;
 
+    /* Used in page-fault test. Results for each array size of a process and sums for all processes. */
+    double* fault_results = NULL;
+    double* all_fault_results = NULL;
+
+    /* Used in pattern test. Bytes checked and runtime of a process, and of all processes. */
+    double pattern_bytes[2] = { 0.0, 0.0 };
+    double* all_pattern_bytes = NULL;
+    /* Used in pattern test. Words that did not match and the first of them, for a process and for all processes. */
+    long long pattern_failures[FAILURE_RESULTS] = { 0, 0, 0, 0, 0 };
+    long long* all_pattern_failures = NULL;
+
     /* Arguments for memory test for all processes */
     mem_test_a* mem_test_args = (mem_test_a*) calloc(1, sizeof(mem_test_a));
 
@@ -200,24 +698,31 @@ int main(int argc, char** argv) {
     /* Used to end timing program execution */
     time_t program_end;
 
-    /* Output from CPU test for all processes */
-    void* cpu_test_results = NULL;
+    /* Output from CPU test for each pthread of a process */
+    cpu_test_o* cpu_test_output = NULL;
+
+    /* Pthreads that run the CPU test and pattern test */
+    thread_pool pool;
 
     /* Used in MPI_Recv */
     MPI_Status status;
 
     /***************************************************************************************************/
 
-    if (argc != 7) {
+    if (argc < 7 || argc > 8) {
        printf("Usage: ./cpumem ");
        printf("[number of threads to use for CPU test] [number of times to repeat CPU test] ");
        printf("[minimum size of array for memory test] [maximum size of array for memory test] ");
-       printf("[seconds to sleep during memory test] [number of times to repeat memory test]\n");
+       printf("[seconds to sleep during memory test, or 0 for tests 2 and 3] [number of times to repeat memory test] ");
+       printf("[optional: 1 = sleep test, 2 = page-fault test, 3 = pattern test]\n");
        printf("Please try again.\n");
        exit(1);
     }
 
-    if ((NUMBER_OF_PTHREADS = atoi(argv[1])) == 0) {
+    if (strcmp(argv[1], "0") == 0) {
+       CPU_SWEEP = TRUE;
+    }
+    else if ((NUMBER_OF_PTHREADS = atoi(argv[1])) <= 0) {
        printf("Error: Invalid argument for number of threads for CPU test. Please try again.\n");
        exit(1);
     }
@@ -227,12 +732,12 @@ int main(int argc, char** argv) {
        exit(1);
     }
 
-    if ((MIN_SIZE = atoi(argv[3])) == 0) {
+    if ((MIN_SIZE = atol(argv[3])) == 0) {
        printf("Error: Invalid argument for minimum size of array for memory test. Please try again.\n");
        exit(1);
     }
 
-    if ((MAX_SIZE = atoi(argv[4])) == 0) {
+    if ((MAX_SIZE = atol(argv[4])) == 0) {
        printf("Error: Invalid argument for maximum size of array for memory test. Please try again.\n");
        exit(1);
     }
@@ -242,13 +747,20 @@ int main(int argc, char** argv) {
        exit(1);
     }
 
-    if ((mem_test_args->sleep_time->tv_sec = atoi(argv[5])) == 0) {
-       printf("Error: Invalid argument for number of seconds to sleep during memory test. Please try again.\n");
+    if ((NUMBER_OF_RUNS = atoi(argv[6])) == 0) {
+       printf("Error: Invalid argument for number of times to repeat memory test. Please try again.\n");
        exit(1);
     }
 
-    if ((NUMBER_OF_RUNS = atoi(argv[6])) == 0) {
-       printf("Error: Invalid argument for number of times to repeat memory test. Please try again.\n");
+    if (argc == 8 && (MEMORY_TEST = atoi(argv[7])) != SLEEP_TEST && MEMORY_TEST != PAGE_FAULT_TEST &&
+        MEMORY_TEST != PATTERN_TEST) {
+       printf("Error: Invalid argument for memory test. Must be 1, 2 or 3. Please try again.\n");
+       exit(1);
+    }
+
+    /***** Only the sleep test sleeps, so the other tests accept any number of seconds *****/
+    if ((mem_test_args->sleep_time->tv_sec = atoi(argv[5])) == 0 && MEMORY_TEST == SLEEP_TEST) {
+       printf("Error: Invalid argument for number of seconds to sleep during memory test. Please try again.\n");
        exit(1);
     }
 
@@ -266,6 +778,38 @@ int main(int argc, char** argv) {
 
     srand(time(NULL));
 
+    /***** Find the hardware threads that pthreads can be pinned to *****/
+    cpus = (int*) calloc(CPU_SETSIZE, sizeof(int));
+
+    if (cpus == NULL) {
+       printf("Memory allocation failed for cpus array! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Finalize();
+       exit(1);
+    }
+
+    PIN = pin_mode();
+    HARDWARE_THREADS = hardware_threads(PIN, cpus, &CORES);
+
+    /***** Every process sweeps the same numbers of pthreads, so that their results can be added up *****/
+    if (CPU_SWEEP == TRUE) {
+       MPI_Allreduce(MPI_IN_PLACE, &HARDWARE_THREADS, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+       MPI_Allreduce(MPI_IN_PLACE, &CORES, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+       NUMBER_OF_PTHREADS = HARDWARE_THREADS;
+       for (counter = 1; counter < HARDWARE_THREADS && NUMBER_OF_SWEEPS < MAX_SWEEPS - 2; counter *= 2) {
+           if (counter > CORES && sweep_threads[NUMBER_OF_SWEEPS - 1] < CORES) {
+              sweep_threads[NUMBER_OF_SWEEPS++] = CORES;
+           }
+           if (counter != CORES) {
+              sweep_threads[NUMBER_OF_SWEEPS++] = counter;
+           }
+       }
+       if (CORES < HARDWARE_THREADS && (NUMBER_OF_SWEEPS == 0 || sweep_threads[NUMBER_OF_SWEEPS - 1] < CORES)) {
+          sweep_threads[NUMBER_OF_SWEEPS++] = CORES;
+       }
+       sweep_threads[NUMBER_OF_SWEEPS++] = HARDWARE_THREADS;
+    }
+
     /****************************************************************************************************
     ** Using N pthreads, one for each CPU test, prepare and start CPU tests                            **
     ****************************************************************************************************/
@@ -273,9 +817,7 @@ int main(int argc, char** argv) {
 
     mem_test_args->process_id = PROCESS_ID;
 
-    pthread_t my_pthreads[NUMBER_OF_PTHREADS];
-
-    cpu_test_args = (cpu_test_a*) calloc(1, sizeof(cpu_test_a));
+    cpu_test_args = (cpu_test_a*) calloc(NUMBER_OF_PTHREADS, sizeof(cpu_test_a));
 
     if (cpu_test_args == NULL) {
        printf("Memory allocation failed for cpu_test_args array! ");
@@ -284,24 +826,39 @@ int main(int argc, char** argv) {
        exit(1);
     }
 
-    cpu_test_args->process_id = PROCESS_ID;
-    cpu_test_args->runs = atol(argv[2]);
+    cpu_test_output = (cpu_test_o*) aligned_alloc(CACHE_LINE_SIZE, NUMBER_OF_PTHREADS * sizeof(cpu_test_o));
+
+    if (cpu_test_output == NULL) {
+       printf("Memory allocation failed for cpu_test_output array! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Finalize();
+       exit(1);
+    }
+
+    for (counter = 0; counter < NUMBER_OF_PTHREADS; counter++) {
+        cpu_test_args[counter].process_id = PROCESS_ID;
+        cpu_test_args[counter].runs = atol(argv[2]);
+        cpu_test_args[counter].seed = (unsigned int) (PROCESS_ID * NUMBER_OF_PTHREADS + counter + 1);
+        cpu_test_args[counter].output = &cpu_test_output[counter];
+    }
 
     if (PROCESS_ID == MASTER) {
        printf("\n");
        printf("Creating %d threads for each of the %d processes for CPU test... ", NUMBER_OF_PTHREADS, NUMBER_OF_PROCESSES);
     }
 
-    for (counter = 0; counter < NUMBER_OF_PTHREADS; counter++) {
-          error_code = pthread_create(&my_pthreads[counter], NULL, cpu_test, (void*) cpu_test_args);
+    spawn_time = seconds();
+    error_code = pool_create(&pool, NUMBER_OF_PTHREADS, (PIN == PIN_NONE) ? NULL : cpus, HARDWARE_THREADS);
+    spawn_time = seconds() - spawn_time;
 
-          if (error_code != 0) {
-             printf("Error encountered while creating pthread.\n");
-             MPI_Finalize();
-             exit(1);
-          }
+    if (error_code != 0) {
+       printf("Error encountered while creating pthread.\n");
+       MPI_Finalize();
+       exit(1);
     }
 
+    pool_run(&pool, cpu_test, cpu_test_args, sizeof(cpu_test_a), NUMBER_OF_PTHREADS);
+
     /****************************************************************************************************
     ** Get results from CPU tests                                                                      **
     ****************************************************************************************************/
@@ -324,26 +881,8 @@ int main(int argc, char** argv) {
     }
 
     for (counter = 0; counter < NUMBER_OF_PTHREADS; counter++) {
-          error_code = pthread_join(my_pthreads[counter], &cpu_test_results);
-
-          if (error_code != 0) {
-             printf("Error encountered while creating pthread.\n");
-             MPI_Finalize();
-             exit(1);
-          }
-
-          if (cpu_test_results == NULL) {
-             printf("CPU test failed!\n");
-             printf("Memory allocation failed for cpu_test_results struct! ");
-             printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
-             MPI_Finalize();
-             exit(1);
-          }
-
-          pthread_ids[counter] = ((cpu_test_o*) cpu_test_results)->pthread_id;
-          pthread_runtimes[counter] = ((cpu_test_o*) cpu_test_results)->runtime;
-
-          free(cpu_test_results);
+        pthread_ids[counter] = cpu_test_output[counter].pthread_id;
+        pthread_runtimes[counter] = cpu_test_output[counter].runtime;
     }
 
     if (PROCESS_ID == MASTER) {
@@ -410,91 +949,272 @@ int main(int argc, char** argv) {
        MPI_Send(&pthread_runtimes[0], NUMBER_OF_PTHREADS, MPI_DOUBLE, MASTER, RUNTIME_TAG, MPI_COMM_WORLD);
     }
 
+    if (PROCESS_ID == MASTER) {
+       spawn_times = (double*) calloc(NUMBER_OF_PROCESSES, sizeof(double));
+
+       if (spawn_times == NULL) {
+          printf("Memory allocation failed for spawn_times array! ");
+          printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+          MPI_Finalize();
+          exit(1);
+       }
+    }
+
+    MPI_Gather(&spawn_time, 1, MPI_DOUBLE, spawn_times, 1, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+
     /****************************************************************************************************
-    ** Perform memory test N times                                                                     **
+    ** Repeat CPU test for each number of pthreads in the scaling sweep                                **
     ****************************************************************************************************/
-    runtime = 0.0;
+    if (CPU_SWEEP == TRUE) {
+       int sweep, threads;
+       double first_start, last_end;
 
-    if (PROCESS_ID == MASTER) {
-       printf("Now executing memory test with all %d processes using various array sizes... ", NUMBER_OF_PROCESSES);
+       if (PROCESS_ID == MASTER) {
+          printf("Running CPU test on 1 to %d threads for each of the %d processes... ", HARDWARE_THREADS, NUMBER_OF_PROCESSES);
+          fflush(stdout);
+       }
+
+       for (sweep = 0; sweep < NUMBER_OF_SWEEPS; sweep++) {
+           threads = sweep_threads[sweep];
+           /***** All processes on a node share its cores, so they start each number of pthreads together *****/
+           MPI_Barrier(MPI_COMM_WORLD);
+           pool_run(&pool, cpu_test, cpu_test_args, sizeof(cpu_test_a), threads);
+           first_start = cpu_test_output[0].start;
+           last_end = cpu_test_output[0].end;
+           for (counter = 1; counter < threads; counter++) {
+               first_start = (cpu_test_output[counter].start < first_start) ? cpu_test_output[counter].start : first_start;
+               last_end = (cpu_test_output[counter].end > last_end) ? cpu_test_output[counter].end : last_end;
+           }
+           sweep_rates[sweep] = threads * cpu_test_args->runs / (last_end - first_start);
+       }
+
+       MPI_Reduce(sweep_rates, all_sweep_rates, NUMBER_OF_SWEEPS, MPI_DOUBLE, MPI_SUM, MASTER, MPI_COMM_WORLD);
+
+       if (PROCESS_ID == MASTER) {
+          printf("Success!\n\n");
+       }
     }
 
-    counter = 1;
+    if (MEMORY_TEST == SLEEP_TEST) {
+       /****************************************************************************************************
+       ** Perform memory test N times                                                                     **
+       ****************************************************************************************************/
+       runtime = 0.0;
 
-    do {
+       if (PROCESS_ID == MASTER) {
+          printf("Now executing memory test with all %d processes using various array sizes... ", NUMBER_OF_PROCESSES);
+       }
 
-       free(mem_test_output);
+       counter = 1;
 
-       mem_test_args->array_size = rand() % (MAX_SIZE - MIN_SIZE + 1) + MIN_SIZE;
+       do {
 
-       #ifdef DEBUG
-           printf("Process %5d: Executing memory test with array size %lu... ", PROCESS_ID, mem_test_args->array_size);
-           printf("Run %d of %d.\n", counter, NUMBER_OF_RUNS);
-       #endif
+          free(mem_test_output);
 
-       start = time(NULL);
-       mem_test_output = mem_test(mem_test_args);
-       end = time(NULL);
+          mem_test_args->array_size = rand() % (MAX_SIZE - MIN_SIZE + 1) + MIN_SIZE;
 
-       #ifdef DEBUG
-           printf("Process %5d: Success!\n\n", PROCESS_ID);
-       #endif
+          #ifdef DEBUG
+              printf("Process %5d: Executing memory test with array size %lu... ", PROCESS_ID, mem_test_args->array_size);
+              printf("Run %d of %d.\n", counter, NUMBER_OF_RUNS);
+          #endif
 
-       runtime += difftime(end, start);
+          start = time(NULL);
+          mem_test_output = mem_test(mem_test_args);
+          end = time(NULL);
 
-    } while (counter++ < NUMBER_OF_RUNS &&
-             mem_test_output != NULL &&
-             mem_test_output->result == PASS);
+          #ifdef DEBUG
+              printf("Process %5d: Success!\n\n", PROCESS_ID);
+          #endif
 
-    if (mem_test_output == NULL || mem_test_output->result == FAIL) {
-       if (mem_test_output == NULL) {
-          printf("Memory test failed!\n");
-          printf("Memory allocation failed for mem_test_output struct! ");
-          printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+          runtime += difftime(end, start);
+
+          if (mem_test_output != NULL) {
+             tlb_misses = (tlb_misses < 0 || mem_test_output->tlb_misses < 0) ? -1 : tlb_misses + mem_test_output->tlb_misses;
+          }
+
+       } while (counter++ < NUMBER_OF_RUNS &&
+                mem_test_output != NULL &&
+                mem_test_output->result == PASS);
+
+       if (mem_test_output == NULL || mem_test_output->result == FAIL) {
+          if (mem_test_output == NULL) {
+             printf("Memory test failed!\n");
+             printf("Memory allocation failed for mem_test_output struct! ");
+             printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+          }
+          else {
+             printf("Memory test failed! Memory corrupted on process %d.\nAborting program...\n", PROCESS_ID);
+          }
+          MPI_Finalize();
+          exit(1);
+       }
+
+       free(mem_test_output);
+
+       if (PROCESS_ID == MASTER) {
+          printf("Success!\n\n");
+       }
+
+       /****************************************************************************************************
+       ** Send results to Master                                                                          **
+       ****************************************************************************************************/
+       if (PROCESS_ID == MASTER) {
+          mem_test_runtimes = (double*) calloc(NUMBER_OF_PROCESSES, sizeof(double));
+          mem_test_tlb_misses = (long long*) calloc(NUMBER_OF_PROCESSES, sizeof(long long));
+
+          if (mem_test_runtimes == NULL || mem_test_tlb_misses == NULL) {
+             printf("Memory allocation failed for mem_test_runtimes array! ");
+             printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+             MPI_Finalize();
+             exit(1);
+          }
+
+          mem_test_runtimes[MASTER] = runtime;
+          mem_test_tlb_misses[MASTER] = tlb_misses;
+
+          for (source = 1; source < NUMBER_OF_PROCESSES; source++) {
+              MPI_Recv(&mem_test_runtimes[source], 1, MPI_DOUBLE, source, RUNTIME_TAG, MPI_COMM_WORLD, &status);
+              MPI_Recv(&mem_test_tlb_misses[source], 1, MPI_LONG_LONG, source, TLB_TAG, MPI_COMM_WORLD, &status);
+          }
+
+          #ifdef DEBUG
+              for (counter = 1; counter < NUMBER_OF_PROCESSES; counter++) {
+                  printf("\nProcess %5d   ::   ", counter);
+                  printf("%.2f seconds\n", mem_test_runtimes[counter]);
+              }
+          #endif
        }
        else {
-          printf("Memory test failed! Memory corrupted on process %d.\nAborting program...\n", PROCESS_ID);
+          MPI_Send(&runtime, 1, MPI_DOUBLE, MASTER, RUNTIME_TAG, MPI_COMM_WORLD);
+          MPI_Send(&tlb_misses, 1, MPI_LONG_LONG, MASTER, TLB_TAG, MPI_COMM_WORLD);
        }
-       MPI_Finalize();
-       exit(1);
     }
+    /****************************************************************************************************
+    ** Perform page-fault test N times for each array size, and then send results to Master            **
+    ****************************************************************************************************/
+    else if (MEMORY_TEST == PAGE_FAULT_TEST) {
+       long size;
+       int threads, size_index, thread_index, run;
+       int results_per_size;
+
+       /***** Sizes double from MIN_SIZE up to MAX_SIZE; numbers of threads double from 1 up to N *****/
+       for (size = MIN_SIZE; size < MAX_SIZE; size *= 2) {
+           NUMBER_OF_SIZES++;
+       }
+       NUMBER_OF_SIZES++;
+       for (threads = 1; threads < NUMBER_OF_PTHREADS; threads *= 2) {
+           NUMBER_OF_THREAD_COUNTS++;
+       }
+       NUMBER_OF_THREAD_COUNTS++;
 
-    free(mem_test_output);
+       results_per_size = NUMBER_OF_THREAD_COUNTS * FAULT_RESULTS + ALLOCATION_RESULTS;
+       fault_results = (double*) calloc(NUMBER_OF_SIZES * results_per_size, sizeof(double));
+       all_fault_results = (double*) calloc(NUMBER_OF_SIZES * results_per_size, sizeof(double));
 
-    if (PROCESS_ID == MASTER) {
-       printf("Success!\n\n");
-    }
+       if (fault_results == NULL || all_fault_results == NULL) {
+          printf("Memory allocation failed for fault_results array! ");
+          printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+          MPI_Finalize();
+          exit(1);
+       }
+
+       if (PROCESS_ID == MASTER) {
+          printf("Now executing page-fault test with all %d processes using various array sizes... ", NUMBER_OF_PROCESSES);
+       }
+
+       for (size_index = 0, size = MIN_SIZE; size_index < NUMBER_OF_SIZES; size_index++, size *= 2) {
+           double* results = &fault_results[size_index * results_per_size];
+           double run_results[FAULT_RESULTS + ALLOCATION_RESULTS];
+           long array_size = (size < MAX_SIZE) ? size : MAX_SIZE;
+
+           for (run = 0; run < NUMBER_OF_RUNS; run++) {
+               for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+                   page_fault_test(array_size, (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS, run_results);
+                   for (counter = 0; counter < FAULT_RESULTS; counter++) {
+                       results[thread_index * FAULT_RESULTS + counter] += run_results[counter] / NUMBER_OF_RUNS;
+                   }
+               }
+               allocation_test(array_size, run_results);
+               for (counter = 0; counter < ALLOCATION_RESULTS; counter++) {
+                   results[NUMBER_OF_THREAD_COUNTS * FAULT_RESULTS + counter] += run_results[counter] / NUMBER_OF_RUNS;
+               }
+           }
+       }
 
+       MPI_Reduce(fault_results, all_fault_results, NUMBER_OF_SIZES * results_per_size, MPI_DOUBLE, MPI_SUM,
+                  MASTER, MPI_COMM_WORLD);
+
+       if (PROCESS_ID == MASTER) {
+          printf("Success!\n\n");
+       }
+    }
     /****************************************************************************************************
-    ** Send results to Master                                                                          **
+    ** Using N pthreads, write and check patterns in an array N times, and then send results to Master **
     ****************************************************************************************************/
-    if (PROCESS_ID == MASTER) {
-       mem_test_runtimes = (double*) calloc(NUMBER_OF_PROCESSES, sizeof(double));
+    else {
+       long words = MAX_SIZE / sizeof(uint64_t);
+       pattern_test_a pattern_test_args[NUMBER_OF_PTHREADS];
+       pattern_test_o* output = (pattern_test_o*) aligned_alloc(CACHE_LINE_SIZE, NUMBER_OF_PTHREADS * sizeof(pattern_test_o));
+       uint64_t* array = (uint64_t*) page_alloc(words, sizeof(uint64_t));
+
+       if (PROCESS_ID == MASTER) {
+          all_pattern_bytes = (double*) calloc(NUMBER_OF_PROCESSES * 2, sizeof(double));
+          all_pattern_failures = (long long*) calloc(NUMBER_OF_PROCESSES * FAILURE_RESULTS, sizeof(long long));
+       }
 
-       if (mem_test_runtimes == NULL) {
-          printf("Memory allocation failed for mem_test_runtimes array! ");
+       if (array == NULL || output == NULL || (PROCESS_ID == MASTER && (all_pattern_bytes == NULL || all_pattern_failures == NULL))) {
+          printf("Memory allocation failed for pattern test! ");
           printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
           MPI_Finalize();
           exit(1);
        }
 
-       mem_test_runtimes[MASTER] = runtime;
+       if (PROCESS_ID == MASTER) {
+          printf("Now executing pattern test with all %d processes and %d threads per process... ",
+                 NUMBER_OF_PROCESSES, NUMBER_OF_PTHREADS);
+       }
 
-       for (source = 1; source < NUMBER_OF_PROCESSES; source++) {
-           MPI_Recv(&mem_test_runtimes[source], 1, MPI_DOUBLE, source, RUNTIME_TAG, MPI_COMM_WORLD, &status);
+       /***** Each thread checks a contiguous part of the array with a whole number of blocks *****/
+       for (counter = 0; counter < NUMBER_OF_PTHREADS; counter++) {
+           long first = (words / PATTERN_BLOCK) * counter / NUMBER_OF_PTHREADS * PATTERN_BLOCK;
+           long last = (counter == NUMBER_OF_PTHREADS - 1) ? words
+                       : (words / PATTERN_BLOCK) * (counter + 1) / NUMBER_OF_PTHREADS * PATTERN_BLOCK;
+           pattern_test_args[counter].words = array + first;
+           pattern_test_args[counter].length = last - first;
+           pattern_test_args[counter].runs = NUMBER_OF_RUNS;
+           pattern_test_args[counter].seed = (uint64_t) rand() * (PROCESS_ID + 1) + counter;
+           pattern_test_args[counter].output = &output[counter];
        }
 
-       #ifdef DEBUG
-           for (counter = 1; counter < NUMBER_OF_PROCESSES; counter++) {
-               printf("\nProcess %5d   ::   ", counter);
-               printf("%.2f seconds\n", mem_test_runtimes[counter]);
+       pool_run(&pool, pattern_test, pattern_test_args, sizeof(pattern_test_a), NUMBER_OF_PTHREADS);
+
+       /***** Add up the bytes checked by all threads, and keep the lowest address that did not match *****/
+       for (counter = 0; counter < NUMBER_OF_PTHREADS; counter++) {
+           pattern_bytes[0] += output[counter].bytes;
+           pattern_bytes[1] = (output[counter].runtime > pattern_bytes[1]) ? output[counter].runtime : pattern_bytes[1];
+           if (output[counter].errors > 0 && (pattern_failures[0] == 0 || output[counter].address < pattern_failures[1])) {
+              pattern_failures[1] = output[counter].address;
+              pattern_failures[2] = output[counter].pattern;
+              pattern_failures[3] = output[counter].expected;
+              pattern_failures[4] = output[counter].actual;
            }
-       #endif
-    }
-    else {
-       MPI_Send(&runtime, 1, MPI_DOUBLE, MASTER, RUNTIME_TAG, MPI_COMM_WORLD);
+           pattern_failures[0] += output[counter].errors;
+       }
+
+       page_free(array, words, sizeof(uint64_t));
+       free(output);
+
+       MPI_Gather(pattern_bytes, 2, MPI_DOUBLE, all_pattern_bytes, 2, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+       MPI_Gather(pattern_failures, FAILURE_RESULTS, MPI_LONG_LONG, all_pattern_failures, FAILURE_RESULTS,
+                  MPI_LONG_LONG, MASTER, MPI_COMM_WORLD);
+
+       if (PROCESS_ID == MASTER) {
+          printf("Success!\n\n");
+       }
     }
 
+    pool_destroy(&pool);
+
     MPI_Barrier(MPI_COMM_WORLD);
     program_end = time(NULL);
 
@@ -514,37 +1234,153 @@ int main(int argc, char** argv) {
        printf("Process summary\n");
        printf("---------------\n\n");
        runtime = 0.0;
+       spawn_time = 0.0;
        for (source = 0, counter = 0; source < NUMBER_OF_PROCESSES; source++) {
            printf("Process %5d:\n", source);
            for (; counter < (source * NUMBER_OF_PTHREADS) + NUMBER_OF_PTHREADS; counter++) {
                printf("\t\tThread %10lu:   %10.2f seconds\n", all_pthread_ids[counter], all_pthread_runtimes[counter]);
                runtime += all_pthread_runtimes[counter];
            }
+           printf("\t\tThread spawn overhead:   %10.3f ms\n", 1.0e3 * spawn_times[source]);
+           spawn_time += spawn_times[source];
            printf("\n");
        }
-       printf("Average runtime:                     %10.2f seconds\n\n", runtime / (NUMBER_OF_PROCESSES * NUMBER_OF_PTHREADS));
-       printf("======================================================================\n");
-       printf("== Memory test results                                              ==\n");
-       printf("======================================================================\n\n");
-       printf("In the memory test, each process allocates an array whose size is\n");
-       printf("between %lu and %lu, fills the elements in it with\n", MIN_SIZE, MAX_SIZE);
-       printf("the same value, sleeps for %lu seconds, and then checks to see\n", mem_test_args->sleep_time->tv_sec);
-       printf("if the array is not corrupted after the process wakes up. The test\n");
-       printf("is repeated %d times. The results are shown below.\n\n", NUMBER_OF_RUNS);
-       printf("Total number of processes:                   %10d\n\n", NUMBER_OF_PROCESSES);
-       printf("Process summary\n");
-       printf("---------------\n\n");
-       runtime = 0.0;
-       for (source = 0; source < NUMBER_OF_PROCESSES; source++) {
-           printf("Process %5d:\n", source);
-           printf("\t\tAverage runtime:     %10.2f seconds\n", mem_test_runtimes[source] / NUMBER_OF_RUNS);
-           printf("\t\tTotal runtime:       %10.2f seconds\n\n", mem_test_runtimes[source]);
-           runtime += mem_test_runtimes[source];
+       printf("Average runtime:                     %10.2f seconds\n", runtime / (NUMBER_OF_PROCESSES * NUMBER_OF_PTHREADS));
+       printf("Average thread spawn overhead:       %10.3f ms per process, %.1f us per thread\n\n",
+              1.0e3 * spawn_time / NUMBER_OF_PROCESSES, 1.0e6 * spawn_time / (NUMBER_OF_PROCESSES * NUMBER_OF_PTHREADS));
+       if (CPU_SWEEP == TRUE) {
+          int sweep, threads;
+
+          printf("======================================================================\n");
+          printf("== CPU scaling results                                              ==\n");
+          printf("======================================================================\n\n");
+          printf("The CPU test is repeated on different numbers of threads in every\n");
+          printf("process at the same time. Square roots per second are added up over\n");
+          printf("all threads and processes. Parallel efficiency is the rate per thread\n");
+          printf("divided by the rate of one thread.\n\n");
+          printf("Hardware threads per process:                %10d\n", HARDWARE_THREADS);
+          printf("Cores per process:                           %10d\n", CORES);
+          printf("Pinning (PIN=none, compact or scatter):      %10s\n\n", PIN_MODE_NAMES[PIN]);
+          printf("Threads per process     Million square roots/s     Per thread     Efficiency\n");
+          printf("-------------------     ----------------------     ----------     ----------\n");
+          for (sweep = 0; sweep < NUMBER_OF_SWEEPS; sweep++) {
+              threads = sweep_threads[sweep];
+              printf("%19d     %22.2f     %10.2f     %9.1f%%\n", threads, all_sweep_rates[sweep] / 1.0e6,
+                     all_sweep_rates[sweep] / (threads * NUMBER_OF_PROCESSES) / 1.0e6,
+                     100.0 * all_sweep_rates[sweep] / threads / all_sweep_rates[0]);
+          }
+          printf("\n");
+          if (CORES == HARDWARE_THREADS) {
+             printf("SMT gain:                                           n/a (one hardware thread per core)\n\n");
+          }
+          else if (PIN != PIN_SCATTER) {
+             printf("SMT gain:                                           n/a (needs PIN=scatter)\n\n");
+          }
+          else {
+             for (sweep = 0; sweep_threads[sweep] != CORES; sweep++);
+             printf("SMT gain (%d vs. %d threads):                    %10.2f\n\n", HARDWARE_THREADS, CORES,
+                    all_sweep_rates[NUMBER_OF_SWEEPS - 1] / all_sweep_rates[sweep]);
+          }
+       }
+       if (MEMORY_TEST == SLEEP_TEST) {
+          printf("======================================================================\n");
+          printf("== Memory test results                                              ==\n");
+          printf("======================================================================\n\n");
+          printf("In the memory test, each process allocates an array whose size is\n");
+          printf("between %lu and %lu, fills the elements in it with\n", MIN_SIZE, MAX_SIZE);
+          printf("the same value, sleeps for %lu seconds, and then checks to see\n", mem_test_args->sleep_time->tv_sec);
+          printf("if the array is not corrupted after the process wakes up. The test\n");
+          printf("is repeated %d times. The results are shown below.\n\n", NUMBER_OF_RUNS);
+          printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
+          printf("Pages (PAGES=4k, thp, 2m or 1g):             %10s\n\n", page_backend_name());
+          printf("Process summary\n");
+          printf("---------------\n\n");
+          runtime = 0.0;
+          for (source = 0; source < NUMBER_OF_PROCESSES; source++) {
+              printf("Process %5d:\n", source);
+              printf("\t\tAverage runtime:     %10.2f seconds\n", mem_test_runtimes[source] / NUMBER_OF_RUNS);
+              printf("\t\tTotal runtime:       %10.2f seconds\n", mem_test_runtimes[source]);
+              printf("\t\tdTLB load misses:    ");
+              print_tlb_misses(mem_test_tlb_misses[source], 10);
+              printf("\n\n");
+              runtime += mem_test_runtimes[source];
+          }
+          printf("\nAverage runtime:                     %10.2f seconds\n\n", runtime / NUMBER_OF_PROCESSES);
+       }
+       else if (MEMORY_TEST == PAGE_FAULT_TEST) {
+          long size;
+          int threads, size_index, thread_index;
+          int results_per_size = NUMBER_OF_THREAD_COUNTS * FAULT_RESULTS + ALLOCATION_RESULTS;
+          double* results;
+
+          printf("======================================================================\n");
+          printf("== Page-fault test results                                          ==\n");
+          printf("======================================================================\n\n");
+          printf("In the page-fault test, each process maps arrays whose sizes double\n");
+          printf("from %lu to %lu bytes. Each result is the average of\n", MIN_SIZE, MAX_SIZE);
+          printf("%d runs and of all %d processes.\n\n", NUMBER_OF_RUNS, NUMBER_OF_PROCESSES);
+          printf("First touch: threads write to every page of a new mapping at the same time\n\n");
+          printf("        Size (bytes)   Threads   Faults/s per thread   Faults/s (all threads)   Faults per page\n");
+          printf("        ------------   -------   -------------------   ----------------------   ---------------\n");
+          for (size_index = 0, size = MIN_SIZE; size_index < NUMBER_OF_SIZES; size_index++, size *= 2) {
+              results = &all_fault_results[size_index * results_per_size];
+              for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+                  printf("%20ld   %7d   %19.0f   %22.0f   %15.4f\n", (size < MAX_SIZE) ? size : MAX_SIZE,
+                         (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS,
+                         results[thread_index * FAULT_RESULTS] / NUMBER_OF_PROCESSES,
+                         results[thread_index * FAULT_RESULTS + 1] / NUMBER_OF_PROCESSES,
+                         results[thread_index * FAULT_RESULTS + 2] / NUMBER_OF_PROCESSES);
+              }
+          }
+          printf("\nAllocation costs on one thread (milliseconds, zeroing in GB/s)\n\n");
+          printf("        Size (bytes)     munmap   calloc + touch   Zeroing   MAP_POPULATE   Touch after populate\n");
+          printf("        ------------   --------   --------------   -------   ------------   --------------------\n");
+          for (size_index = 0, size = MIN_SIZE; size_index < NUMBER_OF_SIZES; size_index++, size *= 2) {
+              results = &all_fault_results[size_index * results_per_size + NUMBER_OF_THREAD_COUNTS * FAULT_RESULTS];
+              printf("%20ld   %8.3f   %14.3f   %7.2f   %12.3f   %20.3f\n", (size < MAX_SIZE) ? size : MAX_SIZE,
+                     1.0e3 * results[0] / NUMBER_OF_PROCESSES, 1.0e3 * results[1] / NUMBER_OF_PROCESSES,
+                     results[2] / NUMBER_OF_PROCESSES / 1.0e9, 1.0e3 * results[3] / NUMBER_OF_PROCESSES,
+                     1.0e3 * results[4] / NUMBER_OF_PROCESSES);
+          }
+          printf("\n");
+       }
+       else {
+          long long errors = 0;
+
+          printf("======================================================================\n");
+          printf("== Pattern test results                                             ==\n");
+          printf("======================================================================\n\n");
+          printf("In the pattern test, each process splits an array of %lu bytes\n", MAX_SIZE);
+          printf("among %d threads, which write and check walking ones, walking zeros,\n", NUMBER_OF_PTHREADS);
+          printf("the address of each word, random words and moving inversions.\n");
+          printf("The test is repeated %d times. The results are shown below.\n\n", NUMBER_OF_RUNS);
+          printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
+          printf("Pages (PAGES=4k, thp, 2m or 1g):             %10s\n\n", page_backend_name());
+          printf("Process      GB checked      Seconds         GB/s     Words that did not match\n");
+          printf("-------      ----------      -------         ----     ------------------------\n");
+          for (source = 0; source < NUMBER_OF_PROCESSES; source++) {
+              printf("%7d   %13.2f   %10.2f   %10.2f   %26lld\n", source, all_pattern_bytes[source * 2] / 1.0e9,
+                     all_pattern_bytes[source * 2 + 1],
+                     all_pattern_bytes[source * 2] / all_pattern_bytes[source * 2 + 1] / 1.0e9,
+                     all_pattern_failures[source * FAILURE_RESULTS]);
+              errors += all_pattern_failures[source * FAILURE_RESULTS];
+          }
+          printf("\n");
+          for (source = 0; source < NUMBER_OF_PROCESSES; source++) {
+              long long* failure = &all_pattern_failures[source * FAILURE_RESULTS];
+              if (failure[0] > 0) {
+                 printf("Process %d: first word that did not match is at address 0x%016llx\n", source,
+                        (unsigned long long) failure[1]);
+                 printf("\t\tPattern: %s, expected 0x%016llx, read 0x%016llx\n", PATTERN_NAMES[failure[2]],
+                        (unsigned long long) failure[3], (unsigned long long) failure[4]);
+              }
+          }
+          printf("Memory test: %s\n\n", (errors == 0) ? "PASSED" : "FAILED");
        }
-       printf("\nAverage runtime:                     %10.2f seconds\n\n", runtime / NUMBER_OF_PROCESSES);
        printf("======================================================================\n");
        printf("== Summary                                                          ==\n");
        printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
        printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
        printf("Number of threads per process:               %10d\n\n", NUMBER_OF_PTHREADS);
        printf("Total number of threads used for CPU test:   %10d\n\n", NUMBER_OF_PTHREADS * NUMBER_OF_PROCESSES);
@@ -553,15 +1389,29 @@ int main(int argc, char** argv) {
 
     /***************************************************************************************************/
 
+    {
+       const char* kernels[2] = { "square roots", "fill and check words" };
+       const char* variants[2] = { clone_variant(), clone_variant() };
+       report_kernel_variants((MEMORY_TEST == PATTERN_TEST) ? 2 : 1, kernels, variants);
+    }
+
     if (PROCESS_ID == MASTER) {
+       free(spawn_times);
+       free(all_pattern_failures);
+       free(all_pattern_bytes);
+       free(mem_test_tlb_misses);
        free(mem_test_runtimes);
        free(all_pthread_runtimes);
        free(all_pthread_ids);
        free(all_process_ids);
     }
+    free(all_fault_results);
+    free(fault_results);
     free(pthread_runtimes);
     free(pthread_ids);
+    free(cpu_test_output);
     free(cpu_test_args);
+    free(cpus);
 
     MPI_Finalize();
 
@@ -572,43 +1422,285 @@ int main(int argc, char** argv) {
 
 }
 
+int pool_create(thread_pool* pool, int threads, int* cpus, int number_of_cpus) {
+
+    int i;
+
+    pool->threads = threads;
+    pool->cpus = cpus;
+    pool->number_of_cpus = number_of_cpus;
+    pool->task = NULL;
+    pool->active = 0;
+    pool->pthreads = (pthread_t*) calloc(threads, sizeof(pthread_t));
+    pool->workers = (pool_worker_a*) calloc(threads, sizeof(pool_worker_a));
+
+    if (pool->pthreads == NULL || pool->workers == NULL) {
+       free(pool->workers);
+       free(pool->pthreads);
+       return -1;
+    }
+
+    pthread_mutex_init(&pool->creating, NULL);
+    pthread_barrier_init(&pool->start, NULL, threads + 1);
+    pthread_barrier_init(&pool->finish, NULL, threads + 1);
+
+    /***** The pthreads wait for the lock, so none of them reaches a barrier before all are created *****/
+    pthread_mutex_lock(&pool->creating);
+    for (i = 0; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (pthread_create(&pool->pthreads[i], NULL, pool_worker, &pool->workers[i]) != 0) {
+           break;
+        }
+    }
+    pool->created = i;
+    pthread_mutex_unlock(&pool->creating);
+
+    if (pool->created < threads) {
+       /***** The barriers would never fill up, so the pthreads that were created exit instead *****/
+       for (i = 0; i < pool->created; i++) {
+           pthread_join(pool->pthreads[i], NULL);
+       }
+       pthread_barrier_destroy(&pool->finish);
+       pthread_barrier_destroy(&pool->start);
+       pthread_mutex_destroy(&pool->creating);
+       free(pool->workers);
+       free(pool->pthreads);
+       return -1;
+    }
+
+    /***** Every pthread is running and waiting for a task *****/
+    pthread_barrier_wait(&pool->finish);
+
+    return 0;
+
+}
+
+void pool_run(thread_pool* pool, void* (*task)(void*), void* args, size_t arg_size, int threads) {
+    pool->task = task;
+    pool->active = threads;
+    pool->args = (char*) args;
+    pool->arg_size = arg_size;
+    pthread_barrier_wait(&pool->start);
+    pthread_barrier_wait(&pool->finish);
+}
+
+void pool_destroy(thread_pool* pool) {
+    int i;
+
+    pool->task = NULL;
+    pthread_barrier_wait(&pool->start);
+    for (i = 0; i < pool->threads; i++) {
+        pthread_join(pool->pthreads[i], NULL);
+    }
+
+    pthread_barrier_destroy(&pool->finish);
+    pthread_barrier_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->creating);
+    free(pool->workers);
+    free(pool->pthreads);
+}
+
+void* pool_worker(void* pool_worker_args) {
+
+    thread_pool* pool = ((pool_worker_a*) pool_worker_args)->pool;
+    int index = ((pool_worker_a*) pool_worker_args)->index;
+    cpu_set_t cpu;
+
+    pthread_mutex_lock(&pool->creating);
+    pthread_mutex_unlock(&pool->creating);
+    if (pool->created < pool->threads) {
+       return NULL;
+    }
+
+    if (pool->cpus != NULL) {
+       CPU_ZERO(&cpu);
+       CPU_SET(pool->cpus[index % pool->number_of_cpus], &cpu);
+       pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu);
+    }
+
+    pthread_barrier_wait(&pool->finish);
+
+    while (TRUE) {
+          pthread_barrier_wait(&pool->start);
+          if (pool->task == NULL) {
+             break;
+          }
+          if (index < pool->active) {
+             pool->task(pool->args + index * pool->arg_size);
+          }
+          pthread_barrier_wait(&pool->finish);
+    }
+
+    return NULL;
+
+}
+
+int pin_mode(void) {
+     const char* value = getenv(PIN_VARIABLE);
+     int mode;
+     if (value != NULL) {
+        for (mode = PIN_NONE; mode <= PIN_SCATTER; mode++) {
+            if (strcmp(value, PIN_MODE_NAMES[mode]) == 0) {
+               return mode;
+            }
+        }
+     }
+     return PIN_NONE;
+}
+
+int hardware_threads(int pin, int* cpus, int* cores) {
+
+    cpu_set_t allowed;
+    hardware_thread* threads;
+    int count = 0, cpu, i, j, core_id;
+    int* core_ids;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+       cpus[0] = 0;
+       *cores = 1;
+       return 1;
+    }
+
+    threads = (hardware_thread*) calloc(CPU_SETSIZE, sizeof(hardware_thread));
+    core_ids = (int*) calloc(CPU_SETSIZE, sizeof(int));
+
+    if (threads == NULL || core_ids == NULL) {
+       free(core_ids);
+       free(threads);
+       cpus[0] = 0;
+       *cores = 1;
+       return 1;
+    }
+
+    /***** Number the cores of each package, and the SMT siblings of each core, in order of appearance *****/
+    *cores = 0;
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+           continue;
+        }
+        threads[count].cpu = cpu;
+        threads[count].package = read_topology(cpu, "physical_package_id");
+        core_id = read_topology(cpu, "core_id");
+        core_ids[count] = (core_id < 0) ? cpu : core_id;
+        threads[count].core = 0;
+        threads[count].sibling = 0;
+        for (i = 0; i < count; i++) {
+            if (threads[i].package == threads[count].package && core_ids[i] == core_ids[count]) {
+               threads[count].core = threads[i].core;
+               threads[count].sibling++;
+            }
+        }
+        if (threads[count].sibling == 0) {
+           for (i = 0; i < count; i++) {
+               threads[count].core += (threads[i].package == threads[count].package && threads[i].sibling == 0);
+           }
+           (*cores)++;
+        }
+        count++;
+    }
+
+    qsort(threads, count, sizeof(hardware_thread), (pin == PIN_SCATTER) ? compare_scatter : compare_compact);
+
+    for (j = 0; j < count; j++) {
+        cpus[j] = threads[j].cpu;
+    }
+
+    free(core_ids);
+    free(threads);
+
+    return count;
+
+}
+
+int read_topology(int cpu, const char* name) {
+    char path[128];
+    FILE* file;
+    int value = -1;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    if ((file = fopen(path, "r")) == NULL) {
+       return -1;
+    }
+    if (fscanf(file, "%d", &value) != 1) {
+       value = -1;
+    }
+    fclose(file);
+    return value;
+}
+
+int compare_compact(const void* first, const void* second) {
+    const hardware_thread* a = (const hardware_thread*) first;
+    const hardware_thread* b = (const hardware_thread*) second;
+    if (a->package != b->package) {
+       return a->package - b->package;
+    }
+    if (a->core != b->core) {
+       return a->core - b->core;
+    }
+    return a->sibling - b->sibling;
+}
+
+int compare_scatter(const void* first, const void* second) {
+    const hardware_thread* a = (const hardware_thread*) first;
+    const hardware_thread* b = (const hardware_thread*) second;
+    if (a->sibling != b->sibling) {
+       return a->sibling - b->sibling;
+    }
+    if (a->core != b->core) {
+       return a->core - b->core;
+    }
+    return a->package - b->package;
+}
+
 void* cpu_test(void* cpu_test_args) {
 
-    int count = 0;
+    double numbers[CPU_TEST_BATCH];
+    int batch, i;
+    long count = 0;
     int process_id = ((cpu_test_a*) cpu_test_args)->process_id;
     long runs = ((cpu_test_a*) cpu_test_args)->runs;
+    cpu_test_o* cpu_test_output = ((cpu_test_a*) cpu_test_args)->output;
+    unsigned int seed = ((cpu_test_a*) cpu_test_args)->seed;
     long pthread_id = (long) pthread_self();
-    time_t start, end;
+    double start, end;
 
     #ifdef DEBUG
         printf("Process %5d: Thread %lu now calculating square roots...\n", process_id, pthread_id);
     #endif
 
-    start = time(NULL);
+    start = seconds();
 
     while (count < runs) {
-          sqrt(rand());
-          count++;
+          batch = (runs - count < CPU_TEST_BATCH) ? (int) (runs - count) : CPU_TEST_BATCH;
+          for (i = 0; i < CPU_TEST_BATCH; i++) {
+              numbers[i] = (i < batch) ? rand_r(&seed) : 0.0;
+          }
+          take_square_roots(numbers);
+          count += batch;
     }
 
-    end = time(NULL);
+    end = seconds();
 
     #ifdef DEBUG
-        printf("Thread %10lu   ::   Process %5d   ::   %.2f seconds\n", pthread_id, process_id, difftime(end, start));
+        printf("Thread %10lu   ::   Process %5d   ::   %.2f seconds\n", pthread_id, process_id, end - start);
     #endif
 
-    cpu_test_o* cpu_test_output = (cpu_test_o*) calloc(1, sizeof(cpu_test_o));
-
-    if (cpu_test_output == NULL) {
-       return NULL;
-    }
-
     cpu_test_output->process_id = process_id;
     cpu_test_output->pthread_id = pthread_id;
-    cpu_test_output->runtime = difftime(end, start);
+    cpu_test_output->runtime = end - start;
+    cpu_test_output->start = start;
+    cpu_test_output->end = end;
+
+    return NULL;
 
-    return cpu_test_output;
+}
 
+KERNEL_CLONES void take_square_roots(double* numbers) {
+    int i;
+    for (i = 0; i < CPU_TEST_BATCH; i++) {
+        numbers[i] = sqrt(numbers[i]);
+    }
 }
 
 mem_test_o* mem_test(mem_test_a* mem_test_args) {
@@ -617,28 +1709,35 @@ mem_test_o* mem_test(mem_test_a* mem_test_args) {
     long array_size = mem_test_args->array_size;
     struct timespec* sleep_time = mem_test_args->sleep_time;
 
-    int i;
+    long i;
+    long long tlb_misses, check_misses;
+    int tlb_counter;
     unsigned char is_not_corrupted = TRUE;
 
     #ifdef DEBUG
         printf("Process %5d: Now starting virtual memory test...\n", process_id);
     #endif
 
-    char* temp = (char*) calloc(array_size, sizeof(char));
+    char* temp = (char*) page_alloc(array_size, sizeof(char));
 
     if (temp == NULL) {
        return NULL;
     }
 
+    tlb_counter = tlb_counter_start();
     initialize(temp, array_size);
+    tlb_misses = tlb_counter_stop(tlb_counter);
 
     nanosleep(sleep_time, NULL);
 
+    tlb_counter = tlb_counter_start();
     for (i = 0; i < array_size && is_not_corrupted == TRUE; i++) {
         is_not_corrupted = (temp[i] == 'B') ? TRUE : FALSE;
     }
+    check_misses = tlb_counter_stop(tlb_counter);
+    tlb_misses = (tlb_misses < 0 || check_misses < 0) ? -1 : tlb_misses + check_misses;
 
-    free(temp);
+    page_free(temp, array_size, sizeof(char));
 
     mem_test_o* mem_test_output = (mem_test_o*) calloc(1, sizeof(mem_test_o));
 
@@ -648,13 +1747,323 @@ mem_test_o* mem_test(mem_test_a* mem_test_args) {
 
     mem_test_output->process_id = process_id;
     mem_test_output->result = (is_not_corrupted) ? PASS : FAIL;
+    mem_test_output->tlb_misses = tlb_misses;
 
     return mem_test_output;
 
 }
 
+void* touch_pages(void* fault_test_args) {
+
+    fault_test_a* args = (fault_test_a*) fault_test_args;
+    struct rusage usage;
+    long faults;
+    long i;
+
+    fault_test_o* fault_test_output = (fault_test_o*) calloc(1, sizeof(fault_test_o));
+
+    pthread_barrier_wait(args->barrier);
+
+    getrusage(RUSAGE_THREAD, &usage);
+    faults = usage.ru_minflt;
+
+    if (fault_test_output != NULL) {
+       fault_test_output->start = seconds();
+    }
+
+    for (i = 0; i < args->length; i += args->page_size) {
+        args->region[i] = 'B';
+    }
+
+    if (fault_test_output == NULL) {
+       return NULL;
+    }
+
+    fault_test_output->end = seconds();
+
+    getrusage(RUSAGE_THREAD, &usage);
+    fault_test_output->faults = usage.ru_minflt - faults;
+
+    return fault_test_output;
+
+}
+
+void page_fault_test(long size, int threads, double* results) {
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    long pages = (size + page_size - 1) / page_size;
+    long total_faults = 0;
+    double first_start = 0.0, last_end = 0.0, rate_per_thread = 0.0;
+    int i;
+    void* output;
+
+    pthread_t* touch_threads = (pthread_t*) calloc(threads, sizeof(pthread_t));
+    fault_test_a* args = (fault_test_a*) calloc(threads, sizeof(fault_test_a));
+    pthread_barrier_t barrier;
+
+    char* region = (char*) mmap(NULL, pages * page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (touch_threads == NULL || args == NULL || region == MAP_FAILED) {
+       printf("Memory allocation failed in page-fault test! Aborting program...\n");
+       MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    pthread_barrier_init(&barrier, NULL, threads);
+
+    /***** Each thread touches a contiguous part of the array with a whole number of pages *****/
+    for (i = 0; i < threads; i++) {
+        args[i].region = region + (pages * i / threads) * page_size;
+        args[i].length = (pages * (i + 1) / threads - pages * i / threads) * page_size;
+        args[i].page_size = page_size;
+        args[i].barrier = &barrier;
+        if (pthread_create(&touch_threads[i], NULL, touch_pages, &args[i]) != 0) {
+           printf("Error creating thread in page-fault test! Aborting program...\n");
+           MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    for (i = 0; i < threads; i++) {
+        pthread_join(touch_threads[i], &output);
+        if (output == NULL) {
+           printf("Memory allocation failed in page-fault test! Aborting program...\n");
+           MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (i == 0 || ((fault_test_o*) output)->start < first_start) {
+           first_start = ((fault_test_o*) output)->start;
+        }
+        if (i == 0 || ((fault_test_o*) output)->end > last_end) {
+           last_end = ((fault_test_o*) output)->end;
+        }
+        total_faults += ((fault_test_o*) output)->faults;
+        rate_per_thread += ((fault_test_o*) output)->faults /
+                           (((fault_test_o*) output)->end - ((fault_test_o*) output)->start) / threads;
+        free(output);
+    }
+
+    pthread_barrier_destroy(&barrier);
+    munmap(region, pages * page_size);
+
+    results[0] = rate_per_thread;
+    results[1] = total_faults / (last_end - first_start);
+    results[2] = (double) total_faults / pages;
+
+    free(args);
+    free(touch_threads);
+
+}
+
+void allocation_test(long size, double* results) {
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    long length = (size + page_size - 1) / page_size * page_size;
+    double start;
+    char* region;
+    long i;
+    void* (* volatile zero)(void*, int, size_t) = memset;
+
+    /***** munmap of an array whose pages were all touched *****/
+    region = (char*) mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+       printf("Memory allocation failed in page-fault test! Aborting program...\n");
+       MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (i = 0; i < length; i += page_size) {
+        region[i] = 'B';
+    }
+    start = seconds();
+    munmap(region, length);
+    results[0] = seconds() - start;
+
+    /***** calloc, and then the first write to every page *****/
+    start = seconds();
+    region = (char*) calloc(size, sizeof(char));
+    if (region == NULL) {
+       printf("Memory allocation failed in page-fault test! Aborting program...\n");
+       MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (i = 0; i < size; i += page_size) {
+        region[i] = 'B';
+    }
+    results[1] = seconds() - start;
+
+    /***** Zeroing an array whose pages are already mapped. Called through a volatile pointer, *****/
+    /***** otherwise the compiler removes memset because the array is freed right after.       *****/
+    start = seconds();
+    zero(region, 0, size);
+    results[2] = size / (seconds() - start);
+    free(region);
+
+    /***** MAP_POPULATE faults in every page before mmap returns *****/
+    start = seconds();
+    region = (char*) mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    results[3] = seconds() - start;
+    if (region == MAP_FAILED) {
+       printf("Memory allocation failed in page-fault test! Aborting program...\n");
+       MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    start = seconds();
+    for (i = 0; i < length; i += page_size) {
+        region[i] = 'B';
+    }
+    results[4] = seconds() - start;
+    munmap(region, length);
+
+}
+
+void* pattern_test(void* pattern_test_args) {
+
+    pattern_test_a* args = (pattern_test_a*) pattern_test_args;
+    uint64_t* words = args->words;
+    long length = args->length;
+    uint64_t seed = args->seed;
+    uint64_t inversions[3];
+    long first;
+    int run, bit, i;
+    double start;
+
+    pattern_test_o* pattern_test_output = args->output;
+
+    memset(pattern_test_output, 0, sizeof(pattern_test_o));
+
+    start = seconds();
+
+    for (run = 0; run < args->runs; run++) {
+        /***** Walking ones and walking zeros *****/
+        for (bit = 0; bit < 64; bit++) {
+            fill_words(words, length, CONSTANT_WORDS, (uint64_t) 1 << bit);
+            verify_words(pattern_test_output, words, length, CONSTANT_WORDS, (uint64_t) 1 << bit, 0);
+        }
+        for (bit = 0; bit < 64; bit++) {
+            fill_words(words, length, CONSTANT_WORDS, ~((uint64_t) 1 << bit));
+            verify_words(pattern_test_output, words, length, CONSTANT_WORDS, ~((uint64_t) 1 << bit), 1);
+        }
+
+        /***** Address in address *****/
+        fill_words(words, length, ADDRESS_WORDS, 0);
+        verify_words(pattern_test_output, words, length, ADDRESS_WORDS, 0, 2);
+
+        /***** Random words, with a new seed for each run *****/
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        fill_words(words, length, RANDOM_WORDS, seed);
+        verify_words(pattern_test_output, words, length, RANDOM_WORDS, seed, 3);
+
+        /***** Moving inversions: check each block and write its inverse, first going up the array *****/
+        /***** and then going down                                                                 *****/
+        inversions[0] = 0;
+        inversions[1] = ~(uint64_t) 0;
+        inversions[2] = expected_word(words, RANDOM_WORDS, seed);
+        for (i = 0; i < 3; i++) {
+            fill_words(words, length, CONSTANT_WORDS, inversions[i]);
+            for (first = 0; first < length; first += PATTERN_BLOCK) {
+                long block = (length - first < PATTERN_BLOCK) ? length - first : PATTERN_BLOCK;
+                verify_words(pattern_test_output, words + first, block, CONSTANT_WORDS, inversions[i], 4);
+                fill_words(words + first, block, CONSTANT_WORDS, ~inversions[i]);
+            }
+            for (first = (length - 1) / PATTERN_BLOCK * PATTERN_BLOCK; first >= 0; first -= PATTERN_BLOCK) {
+                long block = (length - first < PATTERN_BLOCK) ? length - first : PATTERN_BLOCK;
+                verify_words(pattern_test_output, words + first, block, CONSTANT_WORDS, ~inversions[i], 4);
+                fill_words(words + first, block, CONSTANT_WORDS, inversions[i]);
+            }
+            verify_words(pattern_test_output, words, length, CONSTANT_WORDS, inversions[i], 4);
+        }
+    }
+
+    pattern_test_output->runtime = seconds() - start;
+
+    return NULL;
+
+}
+
+KERNEL_CLONES void fill_words(uint64_t* words, long length, int kind, uint64_t value) {
+    long i;
+    if (kind == CONSTANT_WORDS) {
+       for (i = 0; i < length; i++) {
+           words[i] = value;
+       }
+    }
+    else if (kind == ADDRESS_WORDS) {
+       for (i = 0; i < length; i++) {
+           words[i] = (uint64_t) (uintptr_t) &words[i];
+       }
+    }
+    else {
+       for (i = 0; i < length; i++) {
+           words[i] = expected_word(&words[i], RANDOM_WORDS, value);
+       }
+    }
+}
+
+KERNEL_CLONES uint64_t check_words(const uint64_t* words, long length, int kind, uint64_t value) {
+    uint64_t differences = 0;
+    long i;
+    if (kind == CONSTANT_WORDS) {
+       for (i = 0; i < length; i++) {
+           differences |= words[i] ^ value;
+       }
+    }
+    else if (kind == ADDRESS_WORDS) {
+       for (i = 0; i < length; i++) {
+           differences |= words[i] ^ (uint64_t) (uintptr_t) &words[i];
+       }
+    }
+    else {
+       for (i = 0; i < length; i++) {
+           differences |= words[i] ^ expected_word(&words[i], RANDOM_WORDS, value);
+       }
+    }
+    return differences;
+}
+
+void verify_words(pattern_test_o* output, const uint64_t* words, long length, int kind, uint64_t value,
+                  int pattern) {
+    long first, i, block;
+    uint64_t expected;
+
+    for (first = 0; first < length; first += PATTERN_BLOCK) {
+        block = (length - first < PATTERN_BLOCK) ? length - first : PATTERN_BLOCK;
+        if (check_words(words + first, block, kind, value) == 0) {
+           continue;
+        }
+        for (i = first; i < first + block; i++) {
+            expected = expected_word(&words[i], kind, value);
+            if (words[i] != expected) {
+               if (output->errors == 0) {
+                  output->address = (long long) (uintptr_t) &words[i];
+                  output->pattern = pattern;
+                  output->expected = (long long) expected;
+                  output->actual = (long long) words[i];
+               }
+               output->errors++;
+            }
+        }
+    }
+
+    output->bytes += (double) length * sizeof(uint64_t);
+}
+
+static inline uint64_t expected_word(const uint64_t* word, int kind, uint64_t value) {
+    uint64_t random;
+    if (kind == CONSTANT_WORDS) {
+       return value;
+    }
+    if (kind == ADDRESS_WORDS) {
+       return (uint64_t) (uintptr_t) word;
+    }
+    /***** SplitMix64 of the seed plus the address, so any word can be checked on its own *****/
+    random = value + (uint64_t) (uintptr_t) word;
+    random = (random ^ (random >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    random = (random ^ (random >> 27)) * 0x94d049bb133111ebULL;
+    return random ^ (random >> 31);
+}
+
+double seconds(void) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec + now.tv_nsec / 1.0e9;
+}
+
 void initialize(char* array, long length) {
-     int i;
+     long i;
      for (i = 0; i < length; i++) {
          array[i] = 'B';
      }
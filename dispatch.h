@@ -0,0 +1,142 @@
+/*!
+ *
+ *  \file    dispatch.h
+ *  \brief   Selects the kernel variant that matches the CPU a process runs on
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \date    October 17, 2026
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this works:
+ *           Kernels marked with \b KERNEL_CLONES are compiled once for AVX-512, once for AVX2 and
+ *           once for the baseline that the makefile targets. When the program is loaded, the
+ *           dynamic linker checks \b cpuid and binds each kernel to the best variant that the CPU
+ *           supports, so one binary runs on every node of a mixed cluster. Kernels written with
+ *           intrinsics are compiled with \b TARGET instead, and the program chooses between them
+ *           and a portable kernel at startup with \b CPU_SUPPORTS.
+ *
+ *           Every process reports the variants that it ran with \b report_kernel_variants, and the
+ *           master displays them next to the name of the node.
+ *
+ *           \note
+ *           Multiversioning needs GCC or Clang on x86-64. Elsewhere, or when compiled with
+ *           -DNO_DISPATCH, every kernel is compiled once and reported as "default".
+ *
+ */
+
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(NO_DISPATCH)
+#include <immintrin.h>
+/*! Kernels are multiversioned */
+#define DISPATCH
+/*! Compiles a function for AVX-512, AVX2 and the baseline, and picks one when the program loads */
+#define KERNEL_CLONES              __attribute__((target_clones("avx512f", "avx2", "default")))
+/*! Compiles a function for the given instruction set extensions, e.g. "avx512f,avx512bf16" */
+#define TARGET(features)           __attribute__((target(features)))
+/*! Nonzero if the CPU supports the given instruction set extension, e.g. "avx512bf16" */
+#define CPU_SUPPORTS(feature)      __builtin_cpu_supports(feature)
+#else
+#define KERNEL_CLONES
+#define CPU_SUPPORTS(feature)      0
+#endif
+
+/*! Longest name of a kernel or variant that is reported, including the terminating null */
+#define VARIANT_NAME_LENGTH        24
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the variant of \b KERNEL_CLONES kernels that runs on this CPU. The order of the checks
+ *  is the same as the order in which the dynamic linker picks a variant.
+ *
+ *  \return "avx512f", "avx2" or "default"
+ *
+ */
+static inline const char* clone_variant(void) {
+     #ifdef DISPATCH
+         __builtin_cpu_init();
+         if (__builtin_cpu_supports("avx512f")) {
+            return "avx512f";
+         }
+         if (__builtin_cpu_supports("avx2")) {
+            return "avx2";
+         }
+     #endif
+     return "default";
+}
+
+/*!
+ *
+ *  \par Description:
+ *  Gathers the variant of each kernel that every process ran, along with the name of its node, and
+ *  displays them on the master. Must be called by every process in MPI_COMM_WORLD.
+ *
+ *  \param count Number of kernels
+ *  \param kernels Names of the kernels. Must be the same on every process.
+ *  \param variants Variant of each kernel that this process ran
+ *
+ */
+static inline void report_kernel_variants(int count, const char* kernels[], const char* variants[]) {
+
+     char host[MPI_MAX_PROCESSOR_NAME];
+     char* names;          /* variants of this process             */
+     char* all_names;      /* variants of every process            */
+     char* hosts;          /* node names of every process          */
+     int number_of_processes, process_id, length, i, j;
+
+     MPI_Comm_size(MPI_COMM_WORLD, &number_of_processes);
+     MPI_Comm_rank(MPI_COMM_WORLD, &process_id);
+
+     memset(host, 0, sizeof(host));
+     MPI_Get_processor_name(host, &length);
+
+     names = (char*) calloc((size_t) count * VARIANT_NAME_LENGTH, sizeof(char));
+     all_names = (char*) calloc((size_t) count * VARIANT_NAME_LENGTH * number_of_processes, sizeof(char));
+     hosts = (char*) calloc((size_t) MPI_MAX_PROCESSOR_NAME * number_of_processes, sizeof(char));
+
+     if (names == NULL || all_names == NULL || hosts == NULL) {
+        printf("Memory allocation failed for kernel variants! ");
+        printf("Unable to allocate memory on process %d.\nAborting program...\n", process_id);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+     }
+
+     for (i = 0; i < count; i++) {
+         strncpy(names + (size_t) i * VARIANT_NAME_LENGTH, variants[i], VARIANT_NAME_LENGTH - 1);
+     }
+
+     MPI_Gather(names, count * VARIANT_NAME_LENGTH, MPI_CHAR, all_names, count * VARIANT_NAME_LENGTH,
+                MPI_CHAR, 0, MPI_COMM_WORLD);
+     MPI_Gather(host, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, hosts, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, 0,
+                MPI_COMM_WORLD);
+
+     if (process_id == 0) {
+        printf("======================================================================\n");
+        printf("== Kernel variants                                                  ==\n");
+        printf("======================================================================\n\n");
+        printf("Process   Node                 Kernel                     Variant\n");
+        printf("-------   ------------------   ------------------------   ------------\n");
+        for (i = 0; i < number_of_processes; i++) {
+            for (j = 0; j < count; j++) {
+                printf("%7d   %-18.18s   %-24s   %s\n", i, hosts + (size_t) i * MPI_MAX_PROCESSOR_NAME,
+                       kernels[j], all_names + ((size_t) i * count + j) * VARIANT_NAME_LENGTH);
+            }
+        }
+        printf("\n");
+     }
+
+     free(hosts);
+     free(all_names);
+     free(names);
+
+}
+
+#endif
@@ -21,6 +21,9 @@
  *           \b filegen will create a file that will be used by this program. (The file will only
  *           contain numbers.)
  *           \arg Shell sort is used to sort the subarrays and the entire array.
+ *           \arg The arrays are allocated with \b page_alloc, so the PAGES environment variable
+ *           selects 4 KB pages, transparent huge pages, or 2 MB or 1 GB hugetlbfs pages. The data
+ *           TLB load misses of each sort are displayed with its runtime.
  *
  *           \par Reference:
  *           <A HREF="http://goanna.cs.rmit.edu.au/~stbird/Tutorials/ShellSort.html">Shell Sort Algorithm</A>
@@ -32,11 +35,16 @@
 #include <stdlib.h>
 #include <time.h>
 #include <mpi.h>
+#include "pagealloc.h"
 
 /*! Master process. Usually process 0. */
 #define MASTER      0
 #define TRUE        1
 #define FALSE       0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
 
 /*!
  *
@@ -88,6 +96,13 @@ int main(int argc, char** argv) {
     /* The time it takes for all processes to write characters to file */
     double* write_times = NULL;
 
+    /* Data TLB load misses of a process while sorting its subarray, or -1 if not counted */
+    long long tlb_misses;
+    /* Data TLB load misses of the master while sorting the entire array */
+    long long sort_tlb_misses = -1;
+    /* Data TLB load misses of all processes while sorting their subarrays */
+    long long* all_tlb_misses = NULL;
+
     /* Message identifier for sending/receiving arrays to/from processes */
     int ARRAY_TAG = 0;
     /* Used for error handling */
@@ -106,11 +121,15 @@ int main(int argc, char** argv) {
     int SIZE;
     /* Process that sends data to other processes */
     int source;
+    /* Counts data TLB load misses */
+    int tlb_counter;
+    /* Message identifier for sending/receiving TLB misses to/from processes */
+    int TLB_TAG = 2;
 
     /* Used to start timing reading, sorting, and writing for each process */
-    time_t start;
+    double start;
     /* Used to end timing reading, sorting, and writing for each process */
-    time_t end;
+    double end;
     /* Used to start timing program execution */
     time_t program_start;
     /* Used to end timing program execution */
@@ -155,7 +174,7 @@ int main(int argc, char** argv) {
        exit(1);
     }
 
-    characters = (char*) calloc(SIZE, sizeof(char));
+    characters = (char*) page_alloc(SIZE, sizeof(char));
 
     if (characters == NULL) {
        printf("Memory allocation failed for characters array! ");
@@ -166,7 +185,7 @@ int main(int argc, char** argv) {
 
     MY_SIZE = SIZE / NUMBER_OF_PROCESSES;
 
-    my_chars = (char*) calloc(MY_SIZE, sizeof(char));
+    my_chars = (char*) page_alloc(MY_SIZE, sizeof(char));
 
     if (my_chars == NULL) {
        printf("Memory allocation failed for my_chars array! ");
@@ -185,8 +204,9 @@ int main(int argc, char** argv) {
     }
 
     sort_times = (double*) calloc(NUMBER_OF_PROCESSES, sizeof(double));
+    all_tlb_misses = (long long*) calloc(NUMBER_OF_PROCESSES, sizeof(long long));
 
-    if (sort_times == NULL) {
+    if (sort_times == NULL || all_tlb_misses == NULL) {
        printf("Memory allocation failed for sort_times array! ");
        printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
        MPI_Finalize();
@@ -215,14 +235,14 @@ int main(int argc, char** argv) {
        printf("\nReading in file... ");
     }
 
-    start = time(NULL);
+    start = MPI_Wtime();
     error_code = MPI_File_open(MPI_COMM_WORLD, input_filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &input_file);
     #ifdef DEBUG
         error_code = MPI_File_read(input_file, &characters[0], SIZE, MPI_CHAR, &status);
     #endif
     error_code = MPI_File_read_at(input_file, PROCESS_ID * MY_SIZE, &my_chars[0], MY_SIZE, MPI_CHAR, &status);
     error_code = MPI_File_close(&input_file);
-    end = time(NULL);
+    end = MPI_Wtime();
 
     if (error_code != 0) {
        printf("Error reading in file.\n");
@@ -231,14 +251,14 @@ int main(int argc, char** argv) {
     }
 
     if (PROCESS_ID == MASTER) {
-       read_times[MASTER] = difftime(end, start);
+       read_times[MASTER] = end - start;
        for (source = 1; source < NUMBER_OF_PROCESSES; source++) {
            MPI_Recv(&read_times[source], 1, MPI_DOUBLE, source, READ_TAG, MPI_COMM_WORLD, &status);
        }
        printf("Success!\n");
     }
     else {
-       runtime = difftime(end, start);
+       runtime = end - start;
        MPI_Send(&runtime, 1, MPI_DOUBLE, MASTER, READ_TAG, MPI_COMM_WORLD);
     }
 
@@ -272,20 +292,25 @@ int main(int argc, char** argv) {
        printf("\nSorting %d subarrays of size %d each with %d processes... ", NUMBER_OF_PROCESSES, MY_SIZE, NUMBER_OF_PROCESSES);
     }
 
-    start = time(NULL);
+    start = MPI_Wtime();
+    tlb_counter = tlb_counter_start();
     shell_sort(my_chars, MY_SIZE);
-    end = time(NULL);
+    tlb_misses = tlb_counter_stop(tlb_counter);
+    end = MPI_Wtime();
 
     if (PROCESS_ID == MASTER) {
-       sort_times[MASTER] = difftime(end, start);
+       sort_times[MASTER] = end - start;
+       all_tlb_misses[MASTER] = tlb_misses;
        for (source = 1; source < NUMBER_OF_PROCESSES; source++) {
            MPI_Recv(&sort_times[source], 1, MPI_DOUBLE, source, READ_TAG, MPI_COMM_WORLD, &status);
+           MPI_Recv(&all_tlb_misses[source], 1, MPI_LONG_LONG, source, TLB_TAG, MPI_COMM_WORLD, &status);
        }
        printf("Done!\n");
     }
     else {
-       runtime = difftime(end, start);
+       runtime = end - start;
        MPI_Send(&runtime, 1, MPI_DOUBLE, MASTER, READ_TAG, MPI_COMM_WORLD);
+       MPI_Send(&tlb_misses, 1, MPI_LONG_LONG, MASTER, TLB_TAG, MPI_COMM_WORLD);
     }
 
     /****************************************************************************************************
@@ -304,11 +329,13 @@ int main(int argc, char** argv) {
 
        printf("\nReceived %d subarrays from workers. Process %d now sorting array... ", NUMBER_OF_PROCESSES - 1, PROCESS_ID);
 
-       start = time(NULL);
+       start = MPI_Wtime();
+       tlb_counter = tlb_counter_start();
        shell_sort(characters, SIZE);
-       end = time(NULL);
+       sort_tlb_misses = tlb_counter_stop(tlb_counter);
+       end = MPI_Wtime();
 
-       sort_runtime = difftime(end, start);
+       sort_runtime = end - start;
        printf("Done!\n");
 
        for (destination = 1; destination < NUMBER_OF_PROCESSES; destination++) {
@@ -330,11 +357,11 @@ int main(int argc, char** argv) {
        printf("\n%d processes now writing different parts of sorted array to file... ", NUMBER_OF_PROCESSES);
     }
 
-    start = time(NULL);
+    start = MPI_Wtime();
     error_code = MPI_File_open(MPI_COMM_WORLD, output_filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &output_file);
     error_code = MPI_File_write_ordered(output_file, &characters[PROCESS_ID * MY_SIZE], MY_SIZE, MPI_CHAR, &status);
     error_code = MPI_File_close(&output_file);
-    end = time(NULL);
+    end = MPI_Wtime();
 
     if (error_code != 0) {
        printf("Error writing file.\n");
@@ -343,14 +370,14 @@ int main(int argc, char** argv) {
     }
 
     if (PROCESS_ID == MASTER) {
-       write_times[MASTER] = difftime(end, start);
+       write_times[MASTER] = end - start;
        for (source = 1; source < NUMBER_OF_PROCESSES; source++) {
            MPI_Recv(&write_times[source], 1, MPI_DOUBLE, source, READ_TAG, MPI_COMM_WORLD, &status);
        }
        printf("Success!\n");
     }
     else {
-       runtime = difftime(end, start);
+       runtime = end - start;
        MPI_Send(&runtime, 1, MPI_DOUBLE, MASTER, READ_TAG, MPI_COMM_WORLD);
     }
 
@@ -409,10 +436,12 @@ int main(int argc, char** argv) {
        printf("======================================================================\n");
        printf("== Sort times                                                       ==\n");
        printf("======================================================================\n\n");
-       printf("Process\t\t          Array size\t\tSeconds\n");
-       printf("-------\t\t          ----------\t\t-------\n");
+       printf("Process\t\t          Array size\t\tSeconds\t\t    dTLB load misses\n");
+       printf("-------\t\t          ----------\t\t-------\t\t    ----------------\n");
        for (position = 0; position < NUMBER_OF_PROCESSES; position++) {
-           printf("%7d\t\t%20d\t\t%7.2f\n", position, SIZE / NUMBER_OF_PROCESSES, sort_times[position]);
+           printf("%7d\t\t%20d\t\t%7.4f\t\t", position, SIZE / NUMBER_OF_PROCESSES, sort_times[position]);
+           print_tlb_misses(all_tlb_misses[position], 20);
+           printf("\n");
        }
        printf("\n");
 
@@ -442,21 +471,27 @@ int main(int argc, char** argv) {
        printf("======================================================================\n");
        printf("== Summary                                                          ==\n");
        printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
        printf("Total number of processes:                %10d\n\n", NUMBER_OF_PROCESSES);
        printf("Array size:                               %10d\n", SIZE);
        printf("Size of each subarray\n");
        printf("     (array size / number of processes):  %10d\n\n", MY_SIZE);
-       printf("Time for process %d to sort entire array:     %10.2f seconds\n\n", PROCESS_ID, sort_runtime);
+       printf("Time for process %d to sort entire array:     %10.4f seconds\n", PROCESS_ID, sort_runtime);
+       printf("dTLB load misses while sorting entire array: ");
+       print_tlb_misses(sort_tlb_misses, 10);
+       printf("\n");
+       printf("Pages (PAGES=4k, thp, 2m or 1g):             %10s\n\n", page_backend_name());
        printf("Total runtime:                               %10.2f seconds\n\n", difftime(program_end, program_start));
     }
 
     /***************************************************************************************************/
 
     free(write_times);
+    free(all_tlb_misses);
     free(sort_times);
     free(read_times);
-    free(my_chars);
-    free(characters);
+    page_free(my_chars, MY_SIZE, sizeof(char));
+    page_free(characters, SIZE, sizeof(char));
 
     remove(output_filename);
 
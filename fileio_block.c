@@ -27,6 +27,10 @@
 
 /*! Master process. Usually process 0. */
 #define MASTER      0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
 
 /*!
  *  \param argv[1] Smallest block size
@@ -304,6 +308,7 @@ int main(int argc, char** argv) {
        printf("======================================================================\n");
        printf("== Summary                                                          ==\n");
        printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
        printf("Total number of processes:           %10d\n\n", NUMBER_OF_PROCESSES);
        printf("Minimum block size:                  %10lu\n", MIN_SIZE);
        printf("Maximum block size:                  %10lu\n\n", MAX_SIZE);
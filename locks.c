@@ -0,0 +1,931 @@
+/*!
+ *
+ *  \file    locks.c
+ *  \brief   Compares locks and lock-free data structures under threads
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this program works:
+ *           Each process runs every primitive with 1, 2, 4, ... up to N threads, and each thread
+ *           performs M operations:
+ *           \arg mutex: \b pthread_mutex_lock and \b pthread_mutex_unlock
+ *           \arg spinlock: \b pthread_spin_lock and \b pthread_spin_unlock
+ *           \arg ticket: a ticket lock, where threads take numbers and enter in order
+ *           \arg MCS: a Mellor-Crummey-Scott lock, where each thread spins on its own queue node
+ *           \arg queue: a lock-free bounded multi-producer multi-consumer queue, in which each
+ *                cell has a sequence number that tells producers and consumers whose turn it is
+ *           \arg stack: a lock-free Treiber stack, whose head holds a tag that changes on every
+ *                update so that a stale compare-and-swap fails (the ABA problem)
+ *
+ *           With a lock, an operation takes the lock, increments a shared counter, updates shared
+ *           data C times and releases the lock. With the queue and the stack, operations alternate
+ *           between pushing an item and popping one. After every operation, a thread does D units
+ *           of work on its own data, so D sets how often the threads contend and C how long they
+ *           hold a lock.
+ *
+ *           Each operation is timed, and its latency is counted in a histogram whose buckets are a
+ *           quarter of a power of two wide. The program displays the operations per second of all
+ *           threads and processes, and the median, 99th and 99.9th percentile and longest latency
+ *           of each primitive and number of threads. The counter and the items are checked at the
+ *           end of a run, and the program exits with status 1 if an update or an item was lost.
+ *
+ *           \note
+ *           Threads waiting for the ticket and MCS locks or for the queue spin, and yield the CPU
+ *           after every \b SPINS_BEFORE_YIELD spins so that runs with more threads than hardware
+ *           threads finish. Latencies include the time to read the clock twice.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+#include <pthread.h>
+
+/*! Master process. Usually process 0. */
+#define MASTER                     0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS                "unknown"
+#endif
+/*! Size of a cache line. Data written by different threads is kept on different lines. */
+#define CACHE_LINE_SIZE            64
+
+/*! pthread mutex */
+#define MUTEX_LOCK                 0
+/*! pthread spinlock */
+#define SPIN_LOCK                  1
+/*! Ticket lock */
+#define TICKET_LOCK                2
+/*! Mellor-Crummey-Scott queue lock */
+#define MCS_LOCK                   3
+/*! Lock-free bounded MPMC queue */
+#define LOCK_FREE_QUEUE            4
+/*! Lock-free Treiber stack */
+#define LOCK_FREE_STACK            5
+/*! Number of primitives */
+#define NUMBER_OF_PRIMITIVES       6
+
+/*! Spins of a waiting thread before it yields the CPU */
+#define SPINS_BEFORE_YIELD      1024
+/*! Items that each thread owns in the stack test */
+#define STACK_NODES_PER_THREAD     2
+/*! Smallest number of cells in the queue. Must be a power of two. */
+#define QUEUE_CELLS             1024
+
+/*! Number of buckets in a latency histogram: four per power of two of nanoseconds */
+#define LATENCY_BUCKETS          256
+
+/*! Names of the primitives, in the order of their numbers */
+static const char* const PRIMITIVE_NAMES[] = { "mutex", "spinlock", "ticket", "MCS", "queue", "stack" };
+
+/*!
+ *  \brief Ticket lock. The two counters are on separate cache lines.
+ */
+typedef struct ticket_lock {
+    /* Next ticket to hand out */
+    _Atomic unsigned long next;
+    /* Ticket that may enter */
+    _Atomic unsigned long serving __attribute__((aligned(CACHE_LINE_SIZE)));
+} __attribute__((aligned(CACHE_LINE_SIZE))) ticket_lock;
+
+/*!
+ *  \brief Queue node of a thread waiting for an MCS lock
+ */
+typedef struct mcs_node {
+    _Atomic(struct mcs_node*) next;
+    _Atomic int locked;
+} __attribute__((aligned(CACHE_LINE_SIZE))) mcs_node;
+
+/*!
+ *  \brief Cell of the lock-free queue
+ */
+typedef struct queue_cell {
+    /* Position that the cell may be written at, or position + 1 when it holds an item */
+    _Atomic size_t sequence;
+    long value;
+} queue_cell;
+
+/*!
+ *  \brief Lock-free bounded multi-producer multi-consumer queue
+ */
+typedef struct mpmc_queue {
+    queue_cell* cells;
+    size_t mask;
+    /* Next position to push at */
+    _Atomic size_t tail __attribute__((aligned(CACHE_LINE_SIZE)));
+    /* Next position to pop from */
+    _Atomic size_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+} __attribute__((aligned(CACHE_LINE_SIZE))) mpmc_queue;
+
+/*!
+ *  \brief Lock-free Treiber stack of numbered nodes
+ */
+typedef struct treiber_stack {
+    /* Next node of each node, or -1 */
+    _Atomic long* next;
+    /* Tag in the upper 32 bits and top node + 1 in the lower 32 bits, or 0 if empty */
+    _Atomic uint64_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+} __attribute__((aligned(CACHE_LINE_SIZE))) treiber_stack;
+
+/*!
+ *  \brief Primitives shared by all threads in a run
+ */
+typedef struct shared_state {
+    pthread_mutex_t mutex;
+    pthread_spinlock_t spinlock;
+    ticket_lock ticket;
+    _Atomic(mcs_node*) mcs_tail __attribute__((aligned(CACHE_LINE_SIZE)));
+    mpmc_queue queue;
+    treiber_stack stack;
+    /* Protected by the locks */
+    long counter __attribute__((aligned(CACHE_LINE_SIZE)));
+    uint64_t data;
+} shared_state;
+
+/*!
+ *  \brief Arguments for and output from a thread
+ */
+typedef struct lock_test_a {
+    int primitive;
+    /* Number of this thread, from 0 */
+    int thread;
+    long operations;
+    long critical_work;
+    long outside_work;
+    shared_state* shared;
+    pthread_barrier_t* barrier;
+    /* Queue node of this thread for the MCS lock */
+    mcs_node node;
+    /* Nodes that this thread owns in the stack test */
+    long* nodes;
+    long owned;
+    /* Output: times when the thread started and finished, sums of the items pushed and popped,
+       nodes that could not be popped from the stack, histogram of latencies and longest latency in nanoseconds */
+    double start;
+    double end;
+    long pushed;
+    long popped;
+    long errors;
+    long histogram[LATENCY_BUCKETS];
+    long longest;
+} __attribute__((aligned(CACHE_LINE_SIZE))) lock_test_a;
+
+/***************************************************************************************************/
+
+/*!
+ *
+ *  \par Description:
+ *  Runs one primitive with a number of threads, and measures the operations per second, from the
+ *  time the first thread starts until the last thread finishes, and the latency of each operation.
+ *
+ *  \param primitive \b MUTEX_LOCK, \b SPIN_LOCK, \b TICKET_LOCK, \b MCS_LOCK, \b LOCK_FREE_QUEUE
+ *                   or \b LOCK_FREE_STACK
+ *  \param threads Number of threads
+ *  \param operations Number of operations on each thread
+ *  \param critical_work Units of work on shared data while a lock is held
+ *  \param outside_work Units of work on private data after each operation
+ *  \param histogram Incremented by the latency histogram of all threads
+ *  \param longest Set to the longest latency in nanoseconds
+ *  \param lost Incremented by the number of updates and items that were lost
+ *
+ *  \return Operations per second, or -1 if memory allocation failed
+ *
+ */
+double run_lock_test(int primitive, int threads, long operations, long critical_work, long outside_work,
+                     long* histogram, long* longest, long* lost);
+
+/*!
+ *
+ *  \par Description:
+ *  Performs the operations of one primitive on one thread.
+ *
+ *  \param lock_test_args Struct that contains the primitive and the shared state
+ *
+ *  \return NULL
+ *
+ */
+void* lock_test(void* lock_test_args);
+
+/*!
+ *
+ *  \par Description:
+ *  Takes a ticket lock, and waits until its ticket is served.
+ *
+ */
+void ticket_acquire(ticket_lock* lock);
+
+/*!
+ *
+ *  \par Description:
+ *  Releases a ticket lock to the next ticket.
+ *
+ */
+void ticket_release(ticket_lock* lock);
+
+/*!
+ *
+ *  \par Description:
+ *  Appends the node of the calling thread to the queue of an MCS lock, and waits until the thread
+ *  before it hands over the lock.
+ *
+ *  \param tail Last node in the queue of the lock
+ *  \param node Node of the calling thread
+ *
+ */
+void mcs_acquire(_Atomic(mcs_node*)* tail, mcs_node* node);
+
+/*!
+ *
+ *  \par Description:
+ *  Hands an MCS lock over to the next node in its queue, or empties the queue.
+ *
+ *  \param tail Last node in the queue of the lock
+ *  \param node Node of the calling thread
+ *
+ */
+void mcs_release(_Atomic(mcs_node*)* tail, mcs_node* node);
+
+/*!
+ *
+ *  \par Description:
+ *  Pushes an item onto the lock-free queue.
+ *
+ *  \return 0 if successful or -1 if the queue is full
+ *
+ */
+int queue_push(mpmc_queue* queue, long value);
+
+/*!
+ *
+ *  \par Description:
+ *  Pops an item from the lock-free queue.
+ *
+ *  \param value Set to the item
+ *
+ *  \return 0 if successful or -1 if the queue is empty
+ *
+ */
+int queue_pop(mpmc_queue* queue, long* value);
+
+/*!
+ *
+ *  \par Description:
+ *  Pushes a node onto the Treiber stack.
+ *
+ */
+void stack_push(treiber_stack* stack, long node);
+
+/*!
+ *
+ *  \par Description:
+ *  Pops a node from the Treiber stack.
+ *
+ *  \return Number of the node, or -1 if the stack is empty
+ *
+ */
+long stack_pop(treiber_stack* stack);
+
+/*!
+ *
+ *  \par Description:
+ *  Does units of work that the compiler cannot remove, on the given data.
+ *
+ *  \param data Data to update
+ *  \param units Number of units of work
+ *
+ */
+void work(volatile uint64_t* data, long units);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the histogram bucket of a latency. Bucket 4e + s holds latencies from (4 + s) 2^(e-2)
+ *  to (5 + s) 2^(e-2) nanoseconds.
+ *
+ *  \param nanoseconds Latency
+ *
+ *  \return Bucket
+ *
+ */
+int latency_bucket(long nanoseconds);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the latency below which a fraction of the latencies in a histogram fall, rounded up to
+ *  the top of its bucket.
+ *
+ *  \param histogram Latency histogram
+ *  \param fraction Fraction, e.g. 0.99
+ *
+ *  \return Latency in nanoseconds
+ *
+ */
+double percentile(const long* histogram, double fraction);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the time from a monotonic clock.
+ *
+ *  \return Time in seconds
+ *
+ */
+double seconds(void);
+
+/*!
+ *
+ *  \par Description:
+ *  Lets a spinning thread wait a little, and yields the CPU every \b SPINS_BEFORE_YIELD spins.
+ *
+ *  \param spins Number of spins so far, which is incremented
+ *
+ */
+static inline void spin(long* spins) {
+     if (++*spins % SPINS_BEFORE_YIELD == 0) {
+        sched_yield();
+     }
+     #if defined(__x86_64__) || defined(__i386__)
+         __builtin_ia32_pause();
+     #endif
+}
+
+/*!
+ *  \param argv[1] Largest number of threads
+ *  \param argv[2] Number of operations to perform on each thread in each run
+ *  \param argv[3] Units of work on shared data while a lock is held
+ *  \param argv[4] Units of work on private data after each operation
+ */
+int main(int argc, char** argv) {
+
+    /* Operations per second of each primitive and number of threads on this process, and their
+       sums over all processes */
+    double* rates = NULL;
+    double* all_rates = NULL;
+    /* Latency histograms of each primitive and number of threads on this process and all processes */
+    long* histograms = NULL;
+    long* all_histograms = NULL;
+    /* Longest latencies of each primitive and number of threads on this process and all processes */
+    long* longest = NULL;
+    long* all_longest = NULL;
+    /* Updates and items that were lost on this process, and on all processes */
+    long lost = 0;
+    long all_lost = 0;
+    /* Index of the results of one run */
+    int run;
+
+    /* Used for error handling */
+    int error_code;
+    /* Current primitive and number of threads */
+    int primitive, threads, thread_index;
+    /* Number of numbers of threads, i.e. 1, 2, 4, ... up to NUMBER_OF_PTHREADS */
+    int NUMBER_OF_THREAD_COUNTS = 0;
+    /* Largest number of threads */
+    int NUMBER_OF_PTHREADS;
+    /* Total number of processes used in this program */
+    int NUMBER_OF_PROCESSES;
+    /* Current process */
+    int PROCESS_ID;
+
+    /* Number of operations on each thread, and units of work inside and outside critical sections */
+    long OPERATIONS, CRITICAL_WORK, OUTSIDE_WORK;
+
+    /* Used to time program execution */
+    double program_start;
+
+    /***************************************************************************************************/
+
+    if (argc != 5) {
+       printf("Usage: ./locks ");
+       printf("[largest number of threads] [number of operations per thread] ");
+       printf("[work inside critical section] [work outside critical section]\n");
+       printf("Please try again.\n");
+       exit(1);
+    }
+
+    if ((NUMBER_OF_PTHREADS = atoi(argv[1])) <= 0) {
+       printf("Error: Invalid argument for number of threads. Please try again.\n");
+       exit(1);
+    }
+
+    if ((OPERATIONS = atol(argv[2])) < 2) {
+       printf("Error: Number of operations must be at least 2. Please try again.\n");
+       exit(1);
+    }
+
+    if ((CRITICAL_WORK = atol(argv[3])) < 0 || (OUTSIDE_WORK = atol(argv[4])) < 0) {
+       printf("Error: Invalid argument for units of work. Please try again.\n");
+       exit(1);
+    }
+
+    for (threads = 1; threads < NUMBER_OF_PTHREADS; threads *= 2) {
+        NUMBER_OF_THREAD_COUNTS++;
+    }
+    NUMBER_OF_THREAD_COUNTS++;
+
+    /***************************************************************************************************/
+
+    error_code = MPI_Init(&argc, &argv);
+    error_code = MPI_Comm_size(MPI_COMM_WORLD, &NUMBER_OF_PROCESSES);
+    error_code = MPI_Comm_rank(MPI_COMM_WORLD, &PROCESS_ID);
+
+    if (error_code != 0) {
+       printf("Error encountered while initializing MPI and obtaining task information.\n");
+       MPI_Finalize();
+       exit(1);
+    }
+
+    rates = (double*) calloc(NUMBER_OF_PRIMITIVES * NUMBER_OF_THREAD_COUNTS, sizeof(double));
+    all_rates = (double*) calloc(NUMBER_OF_PRIMITIVES * NUMBER_OF_THREAD_COUNTS, sizeof(double));
+    histograms = (long*) calloc(NUMBER_OF_PRIMITIVES * NUMBER_OF_THREAD_COUNTS * LATENCY_BUCKETS, sizeof(long));
+    all_histograms = (long*) calloc(NUMBER_OF_PRIMITIVES * NUMBER_OF_THREAD_COUNTS * LATENCY_BUCKETS, sizeof(long));
+    longest = (long*) calloc(NUMBER_OF_PRIMITIVES * NUMBER_OF_THREAD_COUNTS, sizeof(long));
+    all_longest = (long*) calloc(NUMBER_OF_PRIMITIVES * NUMBER_OF_THREAD_COUNTS, sizeof(long));
+
+    if (rates == NULL || all_rates == NULL || histograms == NULL || all_histograms == NULL || longest == NULL ||
+        all_longest == NULL) {
+       printf("Memory allocation failed for results arrays! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Finalize();
+       exit(1);
+    }
+
+    /****************************************************************************************************
+    ** Run every primitive with every number of threads                                                **
+    ****************************************************************************************************/
+    program_start = seconds();
+
+    if (PROCESS_ID == MASTER) {
+       printf("\nRunning synchronization primitives with up to %d threads on each of the %d processes... ",
+              NUMBER_OF_PTHREADS, NUMBER_OF_PROCESSES);
+       fflush(stdout);
+    }
+
+    for (primitive = 0; primitive < NUMBER_OF_PRIMITIVES; primitive++) {
+        for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+            run = primitive * NUMBER_OF_THREAD_COUNTS + thread_index;
+            rates[run] = run_lock_test(primitive, (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS,
+                                       OPERATIONS, CRITICAL_WORK, OUTSIDE_WORK, &histograms[run * LATENCY_BUCKETS],
+                                       &longest[run], &lost);
+            if (rates[run] < 0.0) {
+               printf("Memory allocation failed for %s test! ", PRIMITIVE_NAMES[primitive]);
+               printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+               MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+    }
+
+    MPI_Reduce(rates, all_rates, NUMBER_OF_PRIMITIVES * NUMBER_OF_THREAD_COUNTS, MPI_DOUBLE, MPI_SUM, MASTER,
+               MPI_COMM_WORLD);
+    MPI_Reduce(histograms, all_histograms, NUMBER_OF_PRIMITIVES * NUMBER_OF_THREAD_COUNTS * LATENCY_BUCKETS, MPI_LONG,
+               MPI_SUM, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(longest, all_longest, NUMBER_OF_PRIMITIVES * NUMBER_OF_THREAD_COUNTS, MPI_LONG, MPI_MAX, MASTER,
+               MPI_COMM_WORLD);
+    MPI_Allreduce(&lost, &all_lost, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Print results                                                                                   **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       printf("Success!\n\n");
+       printf("======================================================================\n");
+       printf("== Synchronization test results                                     ==\n");
+       printf("======================================================================\n\n");
+       printf("Each thread performs %ld operations in each run. A lock is held for\n", OPERATIONS);
+       printf("%ld units of work, and each thread does %ld units of work between\n", CRITICAL_WORK, OUTSIDE_WORK);
+       printf("operations. Queue and stack operations alternate between push and\n");
+       printf("pop. Mops/s counts the operations of all threads and processes.\n");
+       printf("Latencies are in nanoseconds, rounded up to the top of a bucket\n");
+       printf("that is a quarter of a power of two wide.\n\n");
+       for (primitive = 0; primitive < NUMBER_OF_PRIMITIVES; primitive++) {
+           printf("%s\n\n", PRIMITIVE_NAMES[primitive]);
+           printf("Threads        Mops/s      Median         p99       p99.9     Longest\n");
+           printf("-------   -----------   ---------   ---------   ---------   ---------\n");
+           for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+               run = primitive * NUMBER_OF_THREAD_COUNTS + thread_index;
+               printf("%7d   %11.2f   %9.0f   %9.0f   %9.0f   %9ld\n",
+                      (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS, all_rates[run] / 1.0e6,
+                      percentile(&all_histograms[run * LATENCY_BUCKETS], 0.5),
+                      percentile(&all_histograms[run * LATENCY_BUCKETS], 0.99),
+                      percentile(&all_histograms[run * LATENCY_BUCKETS], 0.999), all_longest[run]);
+           }
+           printf("\n");
+       }
+
+       printf("======================================================================\n");
+       printf("== Summary                                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
+       printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
+       printf("Largest number of threads per process:       %10d\n\n", NUMBER_OF_PTHREADS);
+       printf("Updates and items that were lost:            %10ld\n\n", all_lost);
+       printf("Total runtime:                               %10.2f seconds\n\n", seconds() - program_start);
+    }
+
+    /***************************************************************************************************/
+
+    free(all_longest);
+    free(longest);
+    free(all_histograms);
+    free(histograms);
+    free(all_rates);
+    free(rates);
+
+    MPI_Finalize();
+
+    return (all_lost == 0) ? 0 : 1;
+
+}
+
+double run_lock_test(int primitive, int threads, long operations, long critical_work, long outside_work,
+                     long* histogram, long* longest, long* lost) {
+
+    pthread_t lock_threads[threads];
+    pthread_barrier_t barrier;
+    double start = 0.0, end = 0.0;
+    long pushed = 0, popped = 0, node, value;
+    size_t cells = QUEUE_CELLS;
+    queue_cell* queue_cells;
+    int i, j;
+
+    shared_state* shared = (shared_state*) aligned_alloc(CACHE_LINE_SIZE, sizeof(shared_state));
+    lock_test_a* args = (lock_test_a*) aligned_alloc(CACHE_LINE_SIZE, threads * sizeof(lock_test_a));
+    long* nodes = (long*) calloc((size_t) threads * threads * STACK_NODES_PER_THREAD, sizeof(long));
+    _Atomic long* next = (_Atomic long*) calloc((size_t) threads * STACK_NODES_PER_THREAD, sizeof(_Atomic long));
+
+    /***** At most one item per thread is in the queue, so it never fills up *****/
+    while (cells < 2 * (size_t) threads) {
+          cells *= 2;
+    }
+    queue_cells = (queue_cell*) aligned_alloc(CACHE_LINE_SIZE, cells * sizeof(queue_cell));
+
+    if (shared == NULL || args == NULL || nodes == NULL || next == NULL || queue_cells == NULL) {
+       free(queue_cells);
+       free((void*) next);
+       free(nodes);
+       free(args);
+       free(shared);
+       return -1.0;
+    }
+
+    memset(shared, 0, sizeof(shared_state));
+    memset(args, 0, threads * sizeof(lock_test_a));
+    pthread_mutex_init(&shared->mutex, NULL);
+    pthread_spin_init(&shared->spinlock, PTHREAD_PROCESS_PRIVATE);
+    shared->queue.cells = queue_cells;
+    shared->queue.mask = cells - 1;
+    for (i = 0; i < (int) cells; i++) {
+        atomic_init(&queue_cells[i].sequence, (size_t) i);
+    }
+    shared->stack.next = next;
+
+    pthread_barrier_init(&barrier, NULL, threads);
+
+    for (i = 0; i < threads; i++) {
+        args[i].primitive = primitive;
+        args[i].thread = i;
+        args[i].operations = operations;
+        args[i].critical_work = critical_work;
+        args[i].outside_work = outside_work;
+        args[i].shared = shared;
+        args[i].barrier = &barrier;
+        /***** Each thread can hold every node, since it may pop nodes that others pushed *****/
+        args[i].nodes = &nodes[(size_t) i * threads * STACK_NODES_PER_THREAD];
+        for (j = 0; j < STACK_NODES_PER_THREAD; j++) {
+            args[i].nodes[j] = i * STACK_NODES_PER_THREAD + j;
+        }
+        args[i].owned = STACK_NODES_PER_THREAD;
+        if (pthread_create(&lock_threads[i], NULL, lock_test, &args[i]) != 0) {
+           printf("Error encountered while creating pthread.\n");
+           MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    for (i = 0; i < threads; i++) {
+        pthread_join(lock_threads[i], NULL);
+        start = (i == 0 || args[i].start < start) ? args[i].start : start;
+        end = (args[i].end > end) ? args[i].end : end;
+        for (j = 0; j < LATENCY_BUCKETS; j++) {
+            histogram[j] += args[i].histogram[j];
+        }
+        *longest = (args[i].longest > *longest) ? args[i].longest : *longest;
+        *lost += args[i].errors;
+        pushed += args[i].pushed;
+        popped += args[i].popped;
+    }
+
+    /***** Every update and every item must be accounted for *****/
+    if (primitive == LOCK_FREE_QUEUE) {
+       while (queue_pop(&shared->queue, &value) == 0) {
+             popped += value;
+       }
+       *lost += (pushed != popped);
+    }
+    else if (primitive == LOCK_FREE_STACK) {
+       /***** Sum of all node numbers, held by threads or still on the stack *****/
+       for (i = 0; i < threads; i++) {
+           for (j = 0; j < args[i].owned; j++) {
+               popped += args[i].nodes[j];
+           }
+       }
+       while ((node = stack_pop(&shared->stack)) >= 0) {
+             popped += node;
+       }
+       pushed = (long) threads * STACK_NODES_PER_THREAD * (threads * STACK_NODES_PER_THREAD - 1) / 2;
+       *lost += (pushed != popped);
+    }
+    else {
+       *lost += (long) threads * operations - shared->counter;
+    }
+
+    pthread_barrier_destroy(&barrier);
+    pthread_spin_destroy(&shared->spinlock);
+    pthread_mutex_destroy(&shared->mutex);
+    free(queue_cells);
+    free((void*) next);
+    free(nodes);
+    free(args);
+    free(shared);
+
+    return threads * operations / (end - start);
+
+}
+
+void* lock_test(void* lock_test_args) {
+
+    lock_test_a* args = (lock_test_a*) lock_test_args;
+    shared_state* shared = args->shared;
+    int primitive = args->primitive;
+    volatile uint64_t private_data = args->thread;
+    struct timespec before, after;
+    long i, latency, value, node, spins = 0;
+
+    pthread_barrier_wait(args->barrier);
+    args->start = seconds();
+
+    for (i = 0; i < args->operations; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &before);
+
+        if (primitive == LOCK_FREE_QUEUE) {
+           /***** A pop finds the queue empty while a producer that took a cell has not filled it yet.
+                  Every pop follows a push, so the item comes, and the wait is part of the latency. *****/
+           if (i % 2 == 0) {
+              value = (long) args->thread * args->operations + i + 1;
+              while (queue_push(&shared->queue, value) != 0) {
+                    spin(&spins);
+              }
+              args->pushed += value;
+           }
+           else {
+              while (queue_pop(&shared->queue, &value) != 0) {
+                    spin(&spins);
+              }
+              args->popped += value;
+           }
+        }
+        else if (primitive == LOCK_FREE_STACK) {
+           if (i % 2 == 0) {
+              if (args->owned > 0) {
+                 stack_push(&shared->stack, args->nodes[--args->owned]);
+              }
+           }
+           else if ((node = stack_pop(&shared->stack)) >= 0) {
+              args->nodes[args->owned++] = node;
+           }
+           else {
+              args->errors++;
+           }
+        }
+        else {
+           if (primitive == MUTEX_LOCK) {
+              pthread_mutex_lock(&shared->mutex);
+           }
+           else if (primitive == SPIN_LOCK) {
+              pthread_spin_lock(&shared->spinlock);
+           }
+           else if (primitive == TICKET_LOCK) {
+              ticket_acquire(&shared->ticket);
+           }
+           else {
+              mcs_acquire(&shared->mcs_tail, &args->node);
+           }
+
+           shared->counter++;
+           work(&shared->data, args->critical_work);
+
+           if (primitive == MUTEX_LOCK) {
+              pthread_mutex_unlock(&shared->mutex);
+           }
+           else if (primitive == SPIN_LOCK) {
+              pthread_spin_unlock(&shared->spinlock);
+           }
+           else if (primitive == TICKET_LOCK) {
+              ticket_release(&shared->ticket);
+           }
+           else {
+              mcs_release(&shared->mcs_tail, &args->node);
+           }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &after);
+        latency = (after.tv_sec - before.tv_sec) * 1000000000L + (after.tv_nsec - before.tv_nsec);
+        args->histogram[latency_bucket(latency)]++;
+        args->longest = (latency > args->longest) ? latency : args->longest;
+
+        work(&private_data, args->outside_work);
+    }
+
+    args->end = seconds();
+
+    return NULL;
+
+}
+
+void ticket_acquire(ticket_lock* lock) {
+    unsigned long ticket = atomic_fetch_add_explicit(&lock->next, 1, memory_order_relaxed);
+    long spins = 0;
+
+    while (atomic_load_explicit(&lock->serving, memory_order_acquire) != ticket) {
+          spin(&spins);
+    }
+}
+
+void ticket_release(ticket_lock* lock) {
+    unsigned long serving = atomic_load_explicit(&lock->serving, memory_order_relaxed);
+    atomic_store_explicit(&lock->serving, serving + 1, memory_order_release);
+}
+
+void mcs_acquire(_Atomic(mcs_node*)* tail, mcs_node* node) {
+    mcs_node* previous;
+    long spins = 0;
+
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&node->locked, 1, memory_order_relaxed);
+    previous = atomic_exchange_explicit(tail, node, memory_order_acq_rel);
+    if (previous != NULL) {
+       atomic_store_explicit(&previous->next, node, memory_order_release);
+       while (atomic_load_explicit(&node->locked, memory_order_acquire) == 1) {
+             spin(&spins);
+       }
+    }
+}
+
+void mcs_release(_Atomic(mcs_node*)* tail, mcs_node* node) {
+    mcs_node* next = atomic_load_explicit(&node->next, memory_order_acquire);
+    mcs_node* expected = node;
+    long spins = 0;
+
+    if (next == NULL) {
+       if (atomic_compare_exchange_strong_explicit(tail, &expected, NULL, memory_order_acq_rel,
+                                                   memory_order_acquire)) {
+          return;
+       }
+       /***** Another thread has swapped itself in as the tail but has not linked its node yet *****/
+       while ((next = atomic_load_explicit(&node->next, memory_order_acquire)) == NULL) {
+             spin(&spins);
+       }
+    }
+    atomic_store_explicit(&next->locked, 0, memory_order_release);
+}
+
+int queue_push(mpmc_queue* queue, long value) {
+    size_t position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    queue_cell* cell;
+    size_t sequence;
+    long difference;
+
+    for (;;) {
+        cell = &queue->cells[position & queue->mask];
+        sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        difference = (long) sequence - (long) position;
+        if (difference == 0) {
+           if (atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + 1, memory_order_relaxed,
+                                                     memory_order_relaxed)) {
+              break;
+           }
+        }
+        else if (difference < 0) {
+           return -1;
+        }
+        else {
+           position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+
+    cell->value = value;
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return 0;
+}
+
+int queue_pop(mpmc_queue* queue, long* value) {
+    size_t position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    queue_cell* cell;
+    size_t sequence;
+    long difference;
+
+    for (;;) {
+        cell = &queue->cells[position & queue->mask];
+        sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        difference = (long) sequence - (long) (position + 1);
+        if (difference == 0) {
+           if (atomic_compare_exchange_weak_explicit(&queue->head, &position, position + 1, memory_order_relaxed,
+                                                     memory_order_relaxed)) {
+              break;
+           }
+        }
+        else if (difference < 0) {
+           return -1;
+        }
+        else {
+           position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+
+    *value = cell->value;
+    /***** The cell may be written again one lap later *****/
+    atomic_store_explicit(&cell->sequence, position + queue->mask + 1, memory_order_release);
+    return 0;
+}
+
+void stack_push(treiber_stack* stack, long node) {
+    uint64_t head = atomic_load_explicit(&stack->head, memory_order_relaxed);
+    uint64_t replacement;
+
+    do {
+       atomic_store_explicit(&stack->next[node], (long) (head & 0xffffffffUL) - 1, memory_order_relaxed);
+       replacement = (((head >> 32) + 1) << 32) | (uint64_t) (node + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&stack->head, &head, replacement, memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+long stack_pop(treiber_stack* stack) {
+    uint64_t head = atomic_load_explicit(&stack->head, memory_order_acquire);
+    uint64_t replacement;
+    long node;
+
+    do {
+       if ((head & 0xffffffffUL) == 0) {
+          return -1;
+       }
+       node = (long) (head & 0xffffffffUL) - 1;
+       /***** next may be stale if another thread popped the node, but then the tag has changed *****/
+       replacement = (((head >> 32) + 1) << 32) | (uint64_t) (atomic_load_explicit(&stack->next[node], memory_order_relaxed) + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&stack->head, &head, replacement, memory_order_acquire,
+                                                    memory_order_acquire));
+
+    return node;
+}
+
+void work(volatile uint64_t* data, long units) {
+    long i;
+    for (i = 0; i < units; i++) {
+        *data = *data * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+}
+
+int latency_bucket(long nanoseconds) {
+    int exponent;
+
+    if (nanoseconds < 4) {
+       return (nanoseconds < 0) ? 0 : (int) nanoseconds;
+    }
+    exponent = 63 - __builtin_clzl((unsigned long) nanoseconds);
+    if (exponent * 4 + 3 >= LATENCY_BUCKETS) {
+       return LATENCY_BUCKETS - 1;
+    }
+    return exponent * 4 + (int) ((nanoseconds >> (exponent - 2)) & 3);
+}
+
+double percentile(const long* histogram, double fraction) {
+    long total = 0, count = 0;
+    int bucket;
+
+    for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        total += histogram[bucket];
+    }
+    for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        count += histogram[bucket];
+        if (count > 0 && count >= fraction * total) {
+           break;
+        }
+    }
+    if (bucket < 4) {
+       return bucket + 1;
+    }
+    return (double) ((5L + (bucket & 3)) << (bucket / 4 - 2));
+}
+
+double seconds(void) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec + now.tv_nsec / 1.0e9;
+}
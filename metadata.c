@@ -0,0 +1,533 @@
+/*!
+ *
+ *  \file    metadata.c
+ *  \brief   Benchmarks the rate of file metadata operations on all processes
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this program works:
+ *           Like mdtest, every process creates N empty files in a tree of directories with depth
+ *           D and fan-out F, and the files are spread over the directories at the bottom of the
+ *           tree. The program runs in two modes:
+ *           \arg unique directory: every process creates and removes its own tree, so no two
+ *                processes work in the same directory.
+ *           \arg shared directory: the master creates one tree, and all processes create their
+ *                files in the same directories.
+ *
+ *           Each run creates the directories, creates the files (open with O_CREAT and close),
+ *           calls stat on every file, opens every file and closes it, removes the files and
+ *           removes the directories. The processes wait for each other between these phases, and
+ *           each phase is timed on the slowest process. Every process calls stat on and opens the
+ *           files of the process on the next node, so that the node that created a file cannot
+ *           answer from its own cache. The program displays the operations per second of all
+ *           processes in each phase of each mode, from the fastest of R runs. Every failed
+ *           operation is counted, and the program exits with status 1 if one failed.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <mpi.h>
+
+/*! Master process. Usually process 0. */
+#define MASTER                     0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS                "unknown"
+#endif
+/*! Largest number of directories in a tree */
+#define MAX_DIRECTORIES            1000000
+/*! Number of files that a process holds open at once in the open and close phases */
+#define OPEN_BATCH                 256
+
+/*! Every process works in its own tree */
+#define UNIQUE_MODE                0
+/*! All processes work in one tree */
+#define SHARED_MODE                1
+/*! Number of modes */
+#define NUMBER_OF_MODES            2
+
+/*! Phases of a run, in the order in which they are run */
+#define DIRECTORY_CREATE_PHASE     0
+#define FILE_CREATE_PHASE          1
+#define STAT_PHASE                 2
+#define OPEN_PHASE                 3
+#define CLOSE_PHASE                4
+#define FILE_REMOVE_PHASE          5
+#define DIRECTORY_REMOVE_PHASE     6
+/*! Number of phases */
+#define NUMBER_OF_PHASES           7
+
+/*! Names of the phases, in the order of their numbers */
+static const char* const PHASE_NAMES[] = {
+    "directory create (mkdir)", "file create (creat+close)", "stat", "open", "close", "file remove (unlink)",
+    "directory remove (rmdir)"
+};
+
+/*!
+ *  \brief Parameters of the trees, and the process whose files this process reads
+ */
+typedef struct metadata_context {
+    /* Directory in which the trees are created */
+    const char* directory;
+    /* Number of files per process */
+    long files;
+    /* Depth and fan-out of a tree, and its number of directories in all and at the bottom */
+    int depth;
+    int fanout;
+    long directories;
+    long leaves;
+    int process;
+    int processes;
+    /* Process whose files this process calls stat on and opens */
+    int neighbor;
+    /* First failed operation on this process has been displayed */
+    int reported;
+} metadata_context;
+
+/***************************************************************************************************/
+
+/*!
+ *
+ *  \par Description:
+ *  Runs every phase once in a mode, and returns the time of each phase on the slowest process.
+ *
+ *  \param context Parameters of the trees
+ *  \param mode UNIQUE_MODE or SHARED_MODE
+ *  \param times Time of each phase in seconds
+ *
+ *  \return Number of operations that failed on this process
+ *
+ */
+long metadata_test(metadata_context* context, int mode, double* times);
+
+/*!
+ *
+ *  \par Description:
+ *  Creates or removes the directories of a tree. Parents are created before their children and
+ *  removed after them.
+ *
+ *  \param context Parameters of the trees
+ *  \param owner Process that owns the tree, or -1 for the shared tree
+ *  \param create 1 to create the directories, 0 to remove them
+ *
+ *  \return Number of operations that failed
+ *
+ */
+long walk_tree(metadata_context* context, int owner, int create);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the path of a directory in a tree. The digits of the index in base F name the
+ *  directories on the way down from the top of the tree.
+ *
+ *  \param context Parameters of the trees
+ *  \param owner Process that owns the tree, or -1 for the shared tree
+ *  \param level Level of the directory, from 0 at the top
+ *  \param index Index of the directory among the F^level directories on its level
+ *  \param path Buffer of FILENAME_MAX characters for the path
+ *
+ */
+void directory_path(metadata_context* context, int owner, int level, long index, char* path);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the path of a file. File i of a process is in directory i % F^D at the bottom of the
+ *  tree.
+ *
+ *  \param context Parameters of the trees
+ *  \param mode UNIQUE_MODE or SHARED_MODE
+ *  \param creator Process that creates the file
+ *  \param file Number of the file among the files of the process
+ *  \param path Buffer of FILENAME_MAX characters for the path
+ *
+ */
+void file_path(metadata_context* context, int mode, int creator, long file, char* path);
+
+/*!
+ *
+ *  \par Description:
+ *  Counts a failed operation, and displays the first one on each process.
+ *
+ *  \param context Parameters of the trees
+ *  \param operation Name of the operation
+ *  \param path Path that the operation was called on
+ *
+ *  \return 1
+ *
+ */
+long failed(metadata_context* context, const char* operation, const char* path);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the time from a monotonic clock.
+ *
+ *  \return Time in seconds
+ *
+ */
+double seconds(void);
+
+/*!
+ *  \param argv[1] Directory in which to create the trees
+ *  \param argv[2] Number of files per process
+ *  \param argv[3] Depth of the tree of directories
+ *  \param argv[4] Fan-out of the tree of directories
+ *  \param argv[5] Number of times to run each mode
+ */
+int main(int argc, char** argv) {
+
+    /* Parameters of the trees */
+    metadata_context context;
+    /* Time of each phase of one run, and the shortest time of each phase over all runs */
+    double times[NUMBER_OF_PHASES];
+    double best[NUMBER_OF_MODES][NUMBER_OF_PHASES];
+    /* Number of operations in each phase of each mode on all processes */
+    double operations[NUMBER_OF_MODES][NUMBER_OF_PHASES];
+    /* Failed operations on this process and on all processes */
+    long errors = 0;
+    long all_errors = 0;
+
+    /* Processes on the same node as this one */
+    MPI_Comm node;
+
+    /* Used for error handling */
+    int error_code;
+    /* Current mode, run, phase and level of the tree */
+    int mode, run, phase, level;
+    /* Number of processes on a node */
+    int node_processes;
+    /* Number of times to run each mode */
+    int NUMBER_OF_RUNS;
+    /* Total number of processes used in this program */
+    int NUMBER_OF_PROCESSES;
+    /* Current process */
+    int PROCESS_ID;
+
+    /* Directories on one level of the tree */
+    long level_directories;
+
+    /* Used to time program execution */
+    double program_start;
+
+    /***************************************************************************************************/
+
+    if (argc != 6) {
+       printf("Usage: ./metadata ");
+       printf("[directory] [number of files per process] [depth] [fan-out] [number of runs]\n");
+       printf("Please try again.\n");
+       exit(1);
+    }
+
+    memset(&context, 0, sizeof(metadata_context));
+    context.directory = argv[1];
+
+    if ((context.files = atol(argv[2])) <= 0) {
+       printf("Error: Invalid argument for number of files per process. Please try again.\n");
+       exit(1);
+    }
+
+    if ((context.depth = atoi(argv[3])) < 0) {
+       printf("Error: Invalid argument for depth. Please try again.\n");
+       exit(1);
+    }
+
+    if ((context.fanout = atoi(argv[4])) <= 0) {
+       printf("Error: Invalid argument for fan-out. Please try again.\n");
+       exit(1);
+    }
+
+    if ((NUMBER_OF_RUNS = atoi(argv[5])) <= 0) {
+       printf("Error: Invalid argument for number of runs. Please try again.\n");
+       exit(1);
+    }
+
+    /***** The tree has 1 + F + F^2 + ... + F^D directories, and the files are in the last F^D *****/
+    level_directories = 1;
+    context.directories = 1;
+    for (level = 0; level < context.depth && context.directories <= MAX_DIRECTORIES; level++) {
+        level_directories *= context.fanout;
+        context.directories += level_directories;
+    }
+    context.leaves = level_directories;
+
+    if (context.directories > MAX_DIRECTORIES) {
+       printf("Error: A tree may have at most %d directories. Please try again.\n", MAX_DIRECTORIES);
+       exit(1);
+    }
+
+    /***************************************************************************************************/
+
+    error_code = MPI_Init(&argc, &argv);
+    error_code = MPI_Comm_size(MPI_COMM_WORLD, &NUMBER_OF_PROCESSES);
+    error_code = MPI_Comm_rank(MPI_COMM_WORLD, &PROCESS_ID);
+
+    if (error_code != 0) {
+       printf("Error encountered while initializing MPI and obtaining task information.\n");
+       MPI_Finalize();
+       exit(1);
+    }
+
+    context.process = PROCESS_ID;
+    context.processes = NUMBER_OF_PROCESSES;
+
+    /***** The process on the next node is as many processes away as there are on the smallest node *****/
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, PROCESS_ID, MPI_INFO_NULL, &node);
+    MPI_Comm_size(node, &node_processes);
+    MPI_Comm_free(&node);
+    MPI_Allreduce(MPI_IN_PLACE, &node_processes, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    context.neighbor = (PROCESS_ID + node_processes) % NUMBER_OF_PROCESSES;
+
+    for (mode = 0; mode < NUMBER_OF_MODES; mode++) {
+        for (phase = 0; phase < NUMBER_OF_PHASES; phase++) {
+            operations[mode][phase] = (double) context.files * NUMBER_OF_PROCESSES;
+        }
+        operations[mode][DIRECTORY_CREATE_PHASE] = (double) context.directories;
+        operations[mode][DIRECTORY_REMOVE_PHASE] = (double) context.directories;
+    }
+    operations[UNIQUE_MODE][DIRECTORY_CREATE_PHASE] *= NUMBER_OF_PROCESSES;
+    operations[UNIQUE_MODE][DIRECTORY_REMOVE_PHASE] *= NUMBER_OF_PROCESSES;
+
+    /****************************************************************************************************
+    ** Run every phase in both modes                                                                   **
+    ****************************************************************************************************/
+    program_start = seconds();
+
+    if (PROCESS_ID == MASTER) {
+       printf("\nRunning metadata operations on %ld files per process on %d processes in %s... ",
+              context.files, NUMBER_OF_PROCESSES, context.directory);
+       fflush(stdout);
+    }
+
+    for (mode = 0; mode < NUMBER_OF_MODES; mode++) {
+        for (run = 0; run < NUMBER_OF_RUNS; run++) {
+            errors += metadata_test(&context, mode, times);
+            for (phase = 0; phase < NUMBER_OF_PHASES; phase++) {
+                if (run == 0 || times[phase] < best[mode][phase]) {
+                   best[mode][phase] = times[phase];
+                }
+            }
+        }
+    }
+
+    MPI_Allreduce(&errors, &all_errors, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Print results                                                                                   **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       printf("Success!\n\n");
+       printf("======================================================================\n");
+       printf("== Metadata results                                                 ==\n");
+       printf("======================================================================\n\n");
+       printf("Each process creates %ld files in a tree of depth %d and fan-out %d\n", context.files,
+              context.depth, context.fanout);
+       printf("(%ld directories, %ld at the bottom). Rates are operations per\n", context.directories,
+              context.leaves);
+       printf("second of all processes, from the shortest of %d runs on the slowest\n", NUMBER_OF_RUNS);
+       printf("process. In the shared mode, the master creates and removes the tree.\n\n");
+       printf("Phase                        Unique directory ops/s   Shared directory ops/s\n");
+       printf("--------------------------   ----------------------   ----------------------\n");
+       for (phase = 0; phase < NUMBER_OF_PHASES; phase++) {
+           printf("%-26s   %22.1f   %22.1f\n", PHASE_NAMES[phase],
+                  operations[UNIQUE_MODE][phase] / best[UNIQUE_MODE][phase],
+                  operations[SHARED_MODE][phase] / best[SHARED_MODE][phase]);
+       }
+       printf("\n");
+
+       printf("======================================================================\n");
+       printf("== Summary                                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
+       printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
+       printf("Number of files per process:                 %10ld\n", context.files);
+       printf("Number of directories per tree:              %10ld\n\n", context.directories);
+       printf("Failed operations:                           %10ld\n\n", all_errors);
+       printf("Total runtime:                               %10.2f seconds\n\n", seconds() - program_start);
+    }
+
+    /***************************************************************************************************/
+
+    MPI_Finalize();
+
+    return (all_errors == 0) ? 0 : 1;
+
+}
+
+long metadata_test(metadata_context* context, int mode, double* times) {
+
+    char path[FILENAME_MAX];
+    int descriptors[OPEN_BATCH];
+    struct stat status;
+    long errors = 0;
+    long file, first, last;
+    double start, batch_start;
+    int owner = (mode == UNIQUE_MODE) ? context->process : -1;
+    int phase;
+
+    for (phase = 0; phase < NUMBER_OF_PHASES; phase++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        start = seconds();
+
+        switch (phase) {
+        case DIRECTORY_CREATE_PHASE:
+        case DIRECTORY_REMOVE_PHASE:
+            if (mode == UNIQUE_MODE || context->process == MASTER) {
+               errors += walk_tree(context, owner, phase == DIRECTORY_CREATE_PHASE);
+            }
+            times[phase] = seconds() - start;
+            break;
+        case FILE_CREATE_PHASE:
+            for (file = 0; file < context->files; file++) {
+                file_path(context, mode, context->process, file, path);
+                descriptors[0] = open(path, O_CREAT | O_EXCL | O_WRONLY, 0644);
+                if (descriptors[0] < 0) {
+                   errors += failed(context, "create", path);
+                }
+                else {
+                   close(descriptors[0]);
+                }
+            }
+            times[phase] = seconds() - start;
+            break;
+        case STAT_PHASE:
+            for (file = 0; file < context->files; file++) {
+                file_path(context, mode, context->neighbor, file, path);
+                if (stat(path, &status) != 0 || !S_ISREG(status.st_mode)) {
+                   errors += failed(context, "stat", path);
+                }
+            }
+            times[phase] = seconds() - start;
+            break;
+        case OPEN_PHASE:
+            /***** Files are opened and closed in batches, and each phase is timed on its own *****/
+            times[OPEN_PHASE] = 0.0;
+            times[CLOSE_PHASE] = 0.0;
+            for (first = 0; first < context->files; first = last) {
+                last = (first + OPEN_BATCH < context->files) ? first + OPEN_BATCH : context->files;
+                batch_start = seconds();
+                for (file = first; file < last; file++) {
+                    file_path(context, mode, context->neighbor, file, path);
+                    if ((descriptors[file - first] = open(path, O_RDONLY)) < 0) {
+                       errors += failed(context, "open", path);
+                    }
+                }
+                times[OPEN_PHASE] += seconds() - batch_start;
+                batch_start = seconds();
+                for (file = first; file < last; file++) {
+                    if (descriptors[file - first] >= 0 && close(descriptors[file - first]) != 0) {
+                       file_path(context, mode, context->neighbor, file, path);
+                       errors += failed(context, "close", path);
+                    }
+                }
+                times[CLOSE_PHASE] += seconds() - batch_start;
+            }
+            break;
+        case CLOSE_PHASE:
+            /***** Timed together with the open phase *****/
+            break;
+        case FILE_REMOVE_PHASE:
+            for (file = 0; file < context->files; file++) {
+                file_path(context, mode, context->process, file, path);
+                if (unlink(path) != 0) {
+                   errors += failed(context, "unlink", path);
+                }
+            }
+            times[phase] = seconds() - start;
+            break;
+        }
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, times, NUMBER_OF_PHASES, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    return errors;
+
+}
+
+long walk_tree(metadata_context* context, int owner, int create) {
+
+    char path[FILENAME_MAX];
+    long errors = 0;
+    long index, level_directories = 1;
+    int level, step;
+
+    /***** Levels go down from the top when creating, and up from the bottom when removing *****/
+    for (step = 0; step <= context->depth; step++) {
+        level = create ? step : context->depth - step;
+        for (level_directories = 1, index = 0; index < level; index++) {
+            level_directories *= context->fanout;
+        }
+        for (index = 0; index < level_directories; index++) {
+            directory_path(context, owner, level, index, path);
+            if (create && mkdir(path, 0755) != 0) {
+               errors += failed(context, "mkdir", path);
+            }
+            else if (!create && rmdir(path) != 0) {
+               errors += failed(context, "rmdir", path);
+            }
+        }
+    }
+
+    return errors;
+
+}
+
+void directory_path(metadata_context* context, int owner, int level, long index, char* path) {
+
+    long divisor = 1;
+    int length, i;
+
+    if (owner < 0) {
+       length = snprintf(path, FILENAME_MAX, "%s/metadata.shared", context->directory);
+    }
+    else {
+       length = snprintf(path, FILENAME_MAX, "%s/metadata.process.%d", context->directory, owner);
+    }
+
+    for (i = 1; i < level; i++) {
+        divisor *= context->fanout;
+    }
+
+    for (i = 0; i < level && length < FILENAME_MAX; i++) {
+        length += snprintf(path + length, FILENAME_MAX - length, "/dir.%ld", (index / divisor) % context->fanout);
+        divisor /= context->fanout;
+    }
+
+}
+
+void file_path(metadata_context* context, int mode, int creator, long file, char* path) {
+
+    int length;
+
+    directory_path(context, (mode == UNIQUE_MODE) ? creator : -1, context->depth, file % context->leaves, path);
+    length = strlen(path);
+    snprintf(path + length, FILENAME_MAX - length, "/file.%d.%ld", creator, file);
+
+}
+
+long failed(metadata_context* context, const char* operation, const char* path) {
+
+    if (!context->reported) {
+       printf("Error: %s failed for %s on process %d: %s\n", operation, path, context->process, strerror(errno));
+       context->reported = 1;
+    }
+
+    return 1;
+
+}
+
+double seconds(void) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec + now.tv_nsec / 1.0e9;
+}
@@ -12,9 +12,11 @@
  *  \details \par How this program works:
  *           Given an M x N matrix and an N x P matrix, the program will perform matrix
  *           multiplication. Each process will be given M / Q rows from the first matrix and a copy
- *           of the entire N x P matrix. Each process will then perform matrix multiplication
- *           for each element in its rows. Finally, the results will be sent to the master, which
- *           will combine all of them together.
+ *           of the entire N x P matrix, which the master broadcasts once with \b MPI_Bcast before
+ *           any rows are sent. Each process will then perform matrix multiplication for each
+ *           element in its rows. Finally, the results will be sent to the master, which will
+ *           combine all of them together. The time spent distributing the N x P matrix is
+ *           reported separately from the time spent computing.
  *
  *           \par Example:
  *           2 processes and two 2x2 matrices.\n
@@ -25,20 +27,110 @@
  *           \arg Process 1: results[0] = (rowA[0] * matrixB[0][0]) + (rowA[1] * matrixB[1][0])
  *           \arg Process 1: results[1] = (rowA[0] * matrixB[0][1]) + (rowA[1] * matrixB[1][1])
  *
+ *           \par Verification:
+ *           The results are checked with Freivalds' algorithm instead of being computed again: for
+ *           a random vector r, C * r is compared with A * (B * r), which takes O(\f$n^2\f$) time.
+ *           The rows of A and C are scattered so that every process checks its own rows, and
+ *           B * r is computed in parallel and shared with \b MPI_Allgatherv. The time spent
+ *           verifying is displayed separately from the time spent multiplying.
+ *
+ *           \par Strassen-Winograd engine:
+ *           For square matrices, the program can also multiply the matrices with the
+ *           Strassen-Winograd algorithm, which needs seven instead of eight half-size products per
+ *           level of recursion. The seven products at the top levels are divided among groups of
+ *           processes; once a group is down to a single process, that process recurses on its own,
+ *           using only two temporary matrices per level, until the matrices are no larger than the
+ *           crossover size, at which point the cache-blocked kernel takes over. The runtime of the
+ *           engine and its error relative to the classic algorithm are displayed.
+ *
+ *           \par Mixed-precision sweep:
+ *           The program can also multiply matrices of small random integers in FP64, FP32,
+ *           BF16 (stored as the upper half of an FP32 value, accumulated in FP32) and INT8
+ *           (accumulated in INT32). The kernels are generated from one template per element type
+ *           and matched with an MPI datatype for scattering, broadcasting and gathering. When the
+ *           CPU supports AVX-512 BF16 or AVX-512 VNNI, the BF16 and INT8 kernels use those
+ *           dot-product instructions. The throughput of each precision is displayed next to FP64,
+ *           along with its largest difference from the FP64 results.
+ *
+ *           \par Pages:
+ *           Matrices A, B and C are allocated with \b page_alloc, so the PAGES environment variable
+ *           selects 4 KB pages, transparent huge pages, or 2 MB or 1 GB hugetlbfs pages. The data TLB
+ *           load misses of all processes during the classic multiplication are displayed in the
+ *           summary.
+ *
+ *           \par Kernel variants:
+ *           The row kernel, the blocked kernel and the generated kernels are compiled for AVX-512,
+ *           AVX2 and the baseline, and the variant that matches the CPU is picked when the program
+ *           loads. The BF16 and INT8 kernels are picked at startup. Every process reports which
+ *           variants it ran.
+ *
  *           \note
  *           \arg M mod Q must equal 0, where Q is the number of processes.
  *           \arg This version of matrix multiplication does not use a ring topology.
  *
  */
 
+#include <float.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <mpi.h>
+#include "dispatch.h"
+#include "pagealloc.h"
 
 /*! Master process. Usually process 0. */
 #define MASTER      0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
+/*! Multiply matrices with the classic O(\f$n^3\f$) algorithm only */
+#define CLASSIC                    1
+/*! Also multiply matrices with the Strassen-Winograd engine and compare against classic results */
+#define STRASSEN_WINOGRAD          2
+/*! Also multiply matrices in FP64, FP32, BF16 and INT8 and compare throughput */
+#define MIXED_PRECISION            3
+/*! Number of element types in the mixed-precision sweep */
+#define NUMBER_OF_PRECISIONS       4
+/*! Number of random vectors that results are checked with */
+#define FREIVALDS_TRIALS           2
+/*! Growth of the rounding error in each level of Strassen-Winograd recursion */
+#define STRASSEN_ERROR_GROWTH     12.0
+/*! Default size below which the Strassen-Winograd engine switches to the blocked kernel */
+#define DEFAULT_CROSSOVER         64
+
+/*! Size of the tiles used by the blocked kernel. Can be overridden at compile time. */
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE                64
+#endif
+
+/*! Brain floating-point number. Upper 16 bits of an IEEE single-precision number. */
+typedef uint16_t bfloat16;
+
+/*!
+ *  \brief Element type in the mixed-precision sweep, with its MPI datatypes and kernel
+ */
+typedef struct gemm_precision {
+    const char* name;
+    /* Size of an element in matrices A and B */
+    size_t element_size;
+    /* Size of an element in matrix C */
+    size_t result_size;
+    MPI_Datatype element_type;
+    MPI_Datatype result_type;
+    /* Converts an array of doubles to the element type */
+    void (*from_double)(const double* source, void* destination, size_t length);
+    /* Reads an element of matrix C as a double */
+    double (*result_to_double)(const void* results, size_t index);
+    /* Computes C = A * B for a block of rows of A. B is the result of pack, if there is one. */
+    void (*kernel)(const void* A, const void* B, void* C, int rows, int inner, int columns);
+    /* Rearranges matrix B for the kernel, or NULL if the kernel reads B as it is */
+    void* (*pack)(const void* B, int inner, int columns);
+    /* Instruction set used by the kernel */
+    const char* kernel_name;
+} gemm_precision;
 
 /*!
  *
@@ -92,11 +184,335 @@ double** create_matrix(int height, int width);
  */
 void destroy_matrix(double** matrix, int height);
 
+/*!
+ *
+ *  \par Description:
+ *  Multiplies a row of matrix A by matrix B. Each element of the result is accumulated in the same
+ *  order as a dot product, but the loop runs along the rows of \b B so that it vectorizes.
+ *
+ *  \param row Row of matrix A
+ *  \param B Matrix B
+ *  \param result Row of matrix C
+ *  \param inner Number of columns in matrix A and rows in matrix B
+ *  \param width Number of columns in matrix B
+ *
+ */
+KERNEL_CLONES void multiply_row(const double* row, const double* B, double* result, int inner, int width);
+
+/*!
+ *
+ *  \par Description:
+ *  Multiplies two square matrices using a cache-blocked loop nest, i.e. C = A * B.
+ *
+ *  \param A Left-hand matrix
+ *  \param lda Distance between rows in \b A
+ *  \param B Right-hand matrix
+ *  \param ldb Distance between rows in \b B
+ *  \param C Result matrix
+ *  \param ldc Distance between rows in \b C
+ *  \param n Number of rows and columns in each matrix
+ *
+ */
+KERNEL_CLONES void multiply_blocked(const double* A, int lda, const double* B, int ldb, double* C, int ldc, int n);
+
+/*!
+ *
+ *  \par Description:
+ *  Copies a square matrix, i.e. C = A.
+ *
+ *  \param C Result matrix
+ *  \param ldc Distance between rows in \b C
+ *  \param A Matrix to copy
+ *  \param lda Distance between rows in \b A
+ *  \param n Number of rows and columns in each matrix
+ *
+ */
+void matrix_copy(double* C, int ldc, const double* A, int lda, int n);
+
+/*!
+ *
+ *  \par Description:
+ *  Adds two square matrices, i.e. C = A + B. \b C may be the same matrix as \b A or \b B.
+ *
+ *  \param C Result matrix
+ *  \param ldc Distance between rows in \b C
+ *  \param A First matrix
+ *  \param lda Distance between rows in \b A
+ *  \param B Second matrix
+ *  \param ldb Distance between rows in \b B
+ *  \param n Number of rows and columns in each matrix
+ *
+ */
+void matrix_add(double* C, int ldc, const double* A, int lda, const double* B, int ldb, int n);
+
+/*!
+ *
+ *  \par Description:
+ *  Subtracts one square matrix from another, i.e. C = A - B. \b C may be the same matrix as
+ *  \b A or \b B.
+ *
+ *  \param C Result matrix
+ *  \param ldc Distance between rows in \b C
+ *  \param A First matrix
+ *  \param lda Distance between rows in \b A
+ *  \param B Second matrix
+ *  \param ldb Distance between rows in \b B
+ *  \param n Number of rows and columns in each matrix
+ *
+ */
+void matrix_subtract(double* C, int ldc, const double* A, int lda, const double* B, int ldb, int n);
+
+/*!
+ *
+ *  \par Description:
+ *  Multiplies two square matrices on one process with the Strassen-Winograd algorithm. Each level
+ *  of recursion computes the seven products in an order that only needs two temporary matrices,
+ *  one for sums of quadrants of \b A and one for sums of quadrants of \b B; the quadrants of
+ *  \b C hold the remaining products until they are combined.
+ *
+ *  \param A Left-hand matrix
+ *  \param lda Distance between rows in \b A
+ *  \param B Right-hand matrix
+ *  \param ldb Distance between rows in \b B
+ *  \param C Result matrix
+ *  \param ldc Distance between rows in \b C
+ *  \param n Number of rows and columns in each matrix
+ *  \param crossover Size at or below which the blocked kernel is used instead
+ *  \param workspace Scratch space for at least n * n elements
+ *
+ */
+void strassen_winograd(const double* A, int lda, const double* B, int ldb, double* C, int ldc,
+                       int n, int crossover, double* workspace);
+
+/*!
+ *
+ *  \par Description:
+ *  Multiplies two square matrices with the Strassen-Winograd algorithm using all processes in a
+ *  communicator. The processes are split into at most seven groups, and the seven products are
+ *  dealt out to the groups, which recurse with their own communicators. A group with a single
+ *  process calls \b strassen_winograd. Every process must have copies of \b A and \b B.
+ *
+ *  \param comm Processes that take part in the multiplication
+ *  \param A Left-hand matrix
+ *  \param B Right-hand matrix
+ *  \param C Result matrix. Only filled in on rank 0 of \b comm.
+ *  \param n Number of rows and columns in each matrix
+ *  \param crossover Size at or below which the blocked kernel is used instead
+ *
+ */
+void strassen_distributed(MPI_Comm comm, const double* A, const double* B, double* C, int n, int crossover);
+
+/*!
+ *
+ *  \par Description:
+ *  Checks the result of a matrix multiplication with Freivalds' algorithm. For each random
+ *  vector r, every process computes part of B * r, the parts are shared, and then every process
+ *  compares C * r with A * (B * r) for its rows of A and C. The difference in each row is divided
+ *  by the same row of |A| * (|B| * |r|), which bounds the rounding error.
+ *
+ *  \param A Matrix A. Only used by the master.
+ *  \param lda Distance between rows in \b A
+ *  \param B Matrix B. Must be the same on every process.
+ *  \param C Matrix C to check. Only used by the master.
+ *  \param ldc Distance between rows in \b C
+ *  \param height Number of rows in matrices A and C. Must be divisible by number of processes.
+ *  \param inner Number of columns in matrix A and rows in matrix B
+ *  \param width Number of columns in matrices B and C
+ *
+ *  \return Largest scaled difference over all rows and vectors. Only valid on the master.
+ *
+ */
+double freivalds_check(const double* A, int lda, const double* B, const double* C, int ldc,
+                       int height, int inner, int width);
+
+/*!
+ *
+ *  \par Description:
+ *  Converts a single-precision number to a brain floating-point number, rounding to nearest even.
+ *
+ *  \param value Single-precision number
+ *
+ *  \return Upper 16 bits of the rounded number
+ *
+ */
+bfloat16 float_to_bf16(float value);
+
+/*!
+ *
+ *  \par Description:
+ *  Converts a brain floating-point number to a single-precision number.
+ *
+ *  \param value Brain floating-point number
+ *
+ *  \return Single-precision number whose lower 16 bits are zero
+ *
+ */
+float bf16_to_float(bfloat16 value);
+
+/*!
+ *
+ *  \par Description:
+ *  Multiplies two matrices with one element type from the mixed-precision sweep. The master
+ *  converts the matrices, broadcasts B and scatters the rows of A using the MPI datatypes of the
+ *  element type; every process multiplies its rows, and the master gathers the results.
+ *
+ *  \param precision Element type, MPI datatypes and kernel to use
+ *  \param sourceA Matrix A as doubles. Only used by the master.
+ *  \param sourceB Matrix B as doubles. Only used by the master.
+ *  \param results Matrix C converted to doubles. Only filled in on the master.
+ *  \param height Number of rows in matrix A
+ *  \param inner Number of columns in matrix A and rows in matrix B
+ *  \param width Number of columns in matrix B
+ *  \param kernel_time Longest time any process spent in the kernel. Only filled in on the master.
+ *  \param pack_time Longest time any process spent packing matrix B for the kernel, which is not
+ *                   part of kernel_time. Only filled in on the master.
+ *
+ */
+void run_precision(const gemm_precision* precision, const double* sourceA, const double* sourceB,
+                   double* results, int height, int inner, int width, double* kernel_time, double* pack_time);
+
+/*!
+ *  \brief Defines a function that converts an array of doubles to \b TYPE using \b CONVERT
+ */
+#define DEFINE_FROM_DOUBLE(NAME, TYPE, CONVERT)                                                    \
+void NAME(const double* source, void* destination, size_t length) {                               \
+     size_t i;                                                                                     \
+     for (i = 0; i < length; i++) {                                                                \
+         ((TYPE*) destination)[i] = CONVERT(source[i]);                                            \
+     }                                                                                             \
+}
+
+/*!
+ *  \brief Defines a function that reads element \b index of an array of \b TYPE as a double
+ */
+#define DEFINE_RESULT_TO_DOUBLE(NAME, TYPE)                                                        \
+double NAME(const void* results, size_t index) {                                                  \
+     return (double) ((const TYPE*) results)[index];                                               \
+}
+
+/*!
+ *  \brief Defines a blocked kernel that multiplies matrices of \b IN_TYPE, widening each element
+ *         with \b LOAD and accumulating in \b OUT_TYPE
+ */
+#define DEFINE_GEMM_KERNEL(NAME, IN_TYPE, OUT_TYPE, LOAD)                                          \
+KERNEL_CLONES void NAME(const void* A, const void* B, void* C, int rows, int inner, int columns) {               \
+     const IN_TYPE* a = (const IN_TYPE*) A;                                                        \
+     const IN_TYPE* b = (const IN_TYPE*) B;                                                        \
+     OUT_TYPE* c = (OUT_TYPE*) C;                                                                  \
+     OUT_TYPE scale;                                                                               \
+     int i, j, k, jj, kk, j_end, k_end;                                                            \
+     for (i = 0; i < rows * columns; i++) {                                                        \
+         c[i] = 0;                                                                                 \
+     }                                                                                             \
+     for (kk = 0; kk < inner; kk += BLOCK_SIZE) {                                                  \
+         k_end = (kk + BLOCK_SIZE < inner) ? kk + BLOCK_SIZE : inner;                              \
+         for (jj = 0; jj < columns; jj += BLOCK_SIZE) {                                            \
+             j_end = (jj + BLOCK_SIZE < columns) ? jj + BLOCK_SIZE : columns;                      \
+             for (i = 0; i < rows; i++) {                                                          \
+                 for (k = kk; k < k_end; k++) {                                                    \
+                     scale = LOAD(a[(size_t) i * inner + k]);                                      \
+                     for (j = jj; j < j_end; j++) {                                                \
+                         c[(size_t) i * columns + j] += scale * LOAD(b[(size_t) k * columns + j]); \
+                     }                                                                             \
+                 }                                                                                 \
+             }                                                                                     \
+         }                                                                                         \
+     }                                                                                             \
+}
+
+#define AS_IS(value)         (value)
+#define TO_FLOAT(value)      ((float) (value))
+#define TO_INT8(value)       ((int8_t) (value))
+#define TO_INT32(value)      ((int32_t) (value))
+
+DEFINE_FROM_DOUBLE(fp64_from_double, double, AS_IS)
+DEFINE_FROM_DOUBLE(fp32_from_double, float, TO_FLOAT)
+DEFINE_FROM_DOUBLE(bf16_from_double, bfloat16, float_to_bf16)
+DEFINE_FROM_DOUBLE(int8_from_double, int8_t, TO_INT8)
+
+DEFINE_RESULT_TO_DOUBLE(fp64_to_double, double)
+DEFINE_RESULT_TO_DOUBLE(fp32_to_double, float)
+DEFINE_RESULT_TO_DOUBLE(int32_to_double, int32_t)
+
+DEFINE_GEMM_KERNEL(gemm_fp64, double, double, AS_IS)
+DEFINE_GEMM_KERNEL(gemm_fp32, float, float, AS_IS)
+DEFINE_GEMM_KERNEL(gemm_bf16_generic, bfloat16, float, bf16_to_float)
+DEFINE_GEMM_KERNEL(gemm_int8_generic, int8_t, int32_t, TO_INT32)
+
+#ifdef DISPATCH
+/*!
+ *
+ *  \par Description:
+ *  Multiplies BF16 matrices with the AVX-512 BF16 dot-product instruction, which multiplies pairs
+ *  of elements along the inner dimension and accumulates them in FP32. Matrix B must have been
+ *  packed by \b pack_bf16_pairs.
+ *
+ */
+TARGET("avx512f,avx512bf16") void gemm_bf16_avx512(const void* A, const void* B, void* C, int rows, int inner, int columns);
+
+/*!
+ *
+ *  \par Description:
+ *  Interleaves the rows of a BF16 matrix B in pairs for \b gemm_bf16_avx512, with the columns
+ *  padded to a multiple of 64 with zeros.
+ *
+ *  \return Packed matrix, which the caller frees
+ *
+ */
+void* pack_bf16_pairs(const void* B, int inner, int columns);
+
+/*!
+ *
+ *  \par Description:
+ *  Multiplies INT8 matrices with the AVX-512 VNNI dot-product instruction, which multiplies four
+ *  elements along the inner dimension and accumulates them in INT32. The instruction expects
+ *  unsigned elements from matrix A, so 128 is added to them and 128 times the sum of each column
+ *  of matrix B is subtracted afterwards. Matrix B must have been packed by \b pack_int8_quads.
+ *
+ */
+TARGET("avx512f,avx512vnni") void gemm_int8_avx512(const void* A, const void* B, void* C, int rows, int inner, int columns);
+
+/*!
+ *
+ *  \par Description:
+ *  Interleaves the rows of an INT8 matrix B in groups of four for \b gemm_int8_avx512, with the
+ *  columns padded to a multiple of 64 with zeros, and appends the INT32 sum of each column.
+ *
+ *  \return Packed matrix, which the caller frees
+ *
+ */
+void* pack_int8_quads(const void* B, int inner, int columns);
+#endif
+
+/*! Element types in the mixed-precision sweep. FP64 must be first. Kernels are picked by \b select_kernels. */
+gemm_precision precisions[NUMBER_OF_PRECISIONS] = {
+    { "FP64", sizeof(double),   sizeof(double),  MPI_DOUBLE,   MPI_DOUBLE,
+      fp64_from_double, fp64_to_double,  gemm_fp64, NULL, NULL },
+    { "FP32", sizeof(float),    sizeof(float),   MPI_FLOAT,    MPI_FLOAT,
+      fp32_from_double, fp32_to_double,  gemm_fp32, NULL, NULL },
+    { "BF16", sizeof(bfloat16), sizeof(float),   MPI_UINT16_T, MPI_FLOAT,
+      bf16_from_double, fp32_to_double,  gemm_bf16_generic, NULL, NULL },
+    { "INT8", sizeof(int8_t),   sizeof(int32_t), MPI_INT8_T,   MPI_INT32_T,
+      int8_from_double, int32_to_double, gemm_int8_generic, NULL, NULL }
+};
+
+/*!
+ *
+ *  \par Description:
+ *  Picks the BF16 and INT8 kernels that this CPU can run and names the variant of every kernel in
+ *  the mixed-precision sweep.
+ *
+ */
+void select_kernels(void);
+
 /*!
  *  \param argv[1] Number of rows in matrix A
  *  \param argv[2] Number of columns in matrix A
  *  \param argv[3] Number of rows in matrix B
  *  \param argv[4] Number of columns in matrix B
+ *  \param argv[5] (Optional) 1 for classic algorithm only, 2 to also use Strassen-Winograd, or
+ *                  3 to also run the mixed-precision sweep
+ *  \param argv[6] (Optional) Crossover size for Strassen-Winograd engine
  */
 int main(int argc, char** argv) {
 
@@ -113,6 +529,10 @@ int main(int argc, char** argv) {
     int B_HEIGHT;
     /* Number of columns in matrix B */
     int B_WIDTH;
+    /* Size at or below which the Strassen-Winograd engine uses the blocked kernel */
+    int CROSSOVER = DEFAULT_CROSSOVER;
+    /* 1 for classic algorithm only, 2 to also use Strassen-Winograd, or 3 for mixed-precision sweep */
+    int ENGINE = CLASSIC;
     /* Used for error handling */
     int error_code;
     /* Total number of processes used in this program */
@@ -121,8 +541,6 @@ int main(int argc, char** argv) {
     int PROCESS_ID;
 
     #ifndef SERIAL
-        /* Message identifier for sending/receiving columns to/from processes */
-        int COLUMN_TAG = 0;
         /* Main loop counter. Counts from 0 to N, where N = SIZE. */
         int program_counter;
         /* Message identifier for sending/receiving rows to/from processes */
@@ -132,21 +550,55 @@ int main(int argc, char** argv) {
     #endif
 
     /* Used to start timing matrix multiplication algorithm */
-    time_t start;
+    double start;
     /* Used to end timing matrix multiplication algorithm */
-    time_t end;
+    double end;
+    /* Time it took a process to receive matrix B */
+    double distribution_time = 0.0;
+    /* Longest time it took any process to receive matrix B */
+    double max_distribution_time = 0.0;
+    /* Largest difference between Strassen-Winograd and classic results */
+    double strassen_error = 0.0;
+    /* Time it took to multiply matrices with the Strassen-Winograd engine */
+    double strassen_time = 0.0;
+    /* Largest scaled difference found by Freivalds' algorithm in classic results */
+    double residual;
+    /* Largest scaled difference found by Freivalds' algorithm in Strassen-Winograd results */
+    double strassen_residual = 0.0;
+    /* Largest scaled difference allowed in classic results */
+    double tolerance;
+    /* Largest scaled difference allowed in Strassen-Winograd results */
+    double strassen_tolerance = 0.0;
+    /* Time it took to check classic results */
+    double verification_time;
+    /* Time it took to check Strassen-Winograd results */
+    double strassen_verification_time = 0.0;
+    /* Largest difference between results of each precision and FP64 results */
+    double precision_errors[NUMBER_OF_PRECISIONS];
+    /* Longest time any process spent in the kernel for each precision */
+    double precision_times[NUMBER_OF_PRECISIONS];
+    /* Longest time any process spent packing matrix B for each precision */
+    double pack_times[NUMBER_OF_PRECISIONS];
+
+    /* Data TLB load misses of a process during the classic multiplication, or -1 if not counted */
+    long long tlb_misses;
+    /* Data TLB load misses of all processes, or -1 if any process could not count them */
+    long long total_tlb_misses = 0;
+    /* Counts data TLB load misses */
+    int tlb_counter;
 
-    /* Derived datatype for sending a column in a matrix to a process */
-    MPI_Datatype column_type;
     /* Used in MPI_Recv */
     MPI_Status status;
 
     /***************************************************************************************************/
 
-    if (argc != 5) {
+    if (argc < 5 || argc > 7) {
        printf("Usage: ./mm ");
        printf("[number of rows in matrix A] [number of columns in matrix A] ");
-       printf("[number of rows in matrix B] [number of columns in matrix B]\nPlease try again.\n");
+       printf("[number of rows in matrix B] [number of columns in matrix B] ");
+       printf("[optional: 1 = classic, 2 = classic and Strassen-Winograd, 3 = classic and mixed precision] ");
+       printf("[optional: crossover size]\n");
+       printf("Please try again.\n");
        exit(1);
     }
 
@@ -175,11 +627,27 @@ int main(int argc, char** argv) {
        exit(1);
     }
 
+    if (argc > 5 && (ENGINE = atoi(argv[5])) != CLASSIC && ENGINE != STRASSEN_WINOGRAD && ENGINE != MIXED_PRECISION) {
+       printf("Error: Invalid argument for choice of matrix multiplication algorithm. Please try again.\n");
+       exit(1);
+    }
+
+    if (argc > 6 && (CROSSOVER = atoi(argv[6])) <= 0) {
+       printf("Error: Invalid argument for crossover size. Please try again.\n");
+       exit(1);
+    }
+
+    if (ENGINE == STRASSEN_WINOGRAD && (A_HEIGHT != A_WIDTH || B_HEIGHT != B_WIDTH)) {
+       printf("Error: Strassen-Winograd engine requires square matrices. Please try again.\n");
+       exit(1);
+    }
+
     /***************************************************************************************************/
 
-    double matrixA[A_HEIGHT][A_WIDTH];
-    double matrixB[B_HEIGHT][B_WIDTH];
-    double matrixC[A_HEIGHT][B_WIDTH];
+    /***** PAGES selects the pages that back the matrices *****/
+    double (*matrixA)[A_WIDTH] = page_alloc((size_t) A_HEIGHT * A_WIDTH, sizeof(double));
+    double (*matrixB)[B_WIDTH] = page_alloc((size_t) B_HEIGHT * B_WIDTH, sizeof(double));
+    double (*matrixC)[B_WIDTH] = page_alloc((size_t) A_HEIGHT * B_WIDTH, sizeof(double));
 
     error_code = MPI_Init(&argc, &argv);
     error_code = MPI_Comm_size(MPI_COMM_WORLD, &NUMBER_OF_PROCESSES);
@@ -191,6 +659,13 @@ int main(int argc, char** argv) {
        exit(1);
     }
 
+    if (matrixA == NULL || matrixB == NULL || matrixC == NULL) {
+       printf("Memory allocation failed for matrices! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Finalize();
+       exit(1);
+    }
+
     if (A_HEIGHT % NUMBER_OF_PROCESSES != 0) {
        printf("Number of rows in matrix A = %d\tNumber of processes = %d\n", A_HEIGHT, NUMBER_OF_PROCESSES);
        printf("Number of processes does NOT divide number of rows in matrix A. Please try again.\n");
@@ -201,25 +676,13 @@ int main(int argc, char** argv) {
 
     srand(time(NULL));
 
+    select_kernels();
+
     /***************************************************************************************************/
 
     SIZE = A_HEIGHT / NUMBER_OF_PROCESSES;
 
-    /****************************************************************************************************
-    ** MASTER                                                                                          **
-    ****************************************************************************************************/
     if (PROCESS_ID == MASTER) {
-       int j, k;
-
-       #ifndef SERIAL
-           int current_row,
-               destination,  /* process that receives data from master */
-               source,       /* process that sent data to master       */
-               previous_row;
-       #else
-           int i;
-       #endif
-
        initialize(&matrixA[0][0], A_HEIGHT, A_WIDTH);
        initialize(&matrixB[0][0], B_HEIGHT, B_WIDTH);
 
@@ -240,8 +703,37 @@ int main(int argc, char** argv) {
            print_matrix(&matrixB[0][0], B_HEIGHT, B_WIDTH);
            printf("\n");
        #endif
+    }
+
+    /****************************************************************************************************
+    ** Broadcast matrix B to workers only once                                                         **
+    ****************************************************************************************************/
+    #ifndef SERIAL
+       MPI_Barrier(MPI_COMM_WORLD);
+
+       distribution_time = MPI_Wtime();
+       MPI_Bcast(&matrixB[0][0], B_HEIGHT * B_WIDTH, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+       distribution_time = MPI_Wtime() - distribution_time;
 
-       start = time(NULL);
+       MPI_Reduce(&distribution_time, &max_distribution_time, 1, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+    #endif
+
+    tlb_counter = tlb_counter_start();
+
+    /****************************************************************************************************
+    ** MASTER                                                                                          **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       #ifndef SERIAL
+           int current_row,
+               destination,  /* process that receives data from master */
+               source,       /* process that sent data to master       */
+               previous_row;
+       #else
+           int i;
+       #endif
+
+       start = MPI_Wtime();
 
        #ifndef SERIAL
           /****************************************************************************************************
@@ -249,12 +741,7 @@ int main(int argc, char** argv) {
           ****************************************************************************************************/
           for (program_counter = 0, current_row = 0; program_counter < SIZE; program_counter++) {
               /***** Master calculates its row *****/
-              for (j = 0; j < B_WIDTH; j++) {
-                  matrixC[current_row][j] = 0.0;
-                  for (k = 0; k < A_WIDTH; k++) {
-                      matrixC[current_row][j] += (matrixA[current_row][k] * matrixB[k][j]);
-                  }
-              }
+              multiply_row(&matrixA[current_row][0], &matrixB[0][0], &matrixC[current_row][0], A_WIDTH, B_WIDTH);
 
               current_row++;
               previous_row = current_row;
@@ -263,17 +750,8 @@ int main(int argc, char** argv) {
                   MPI_Send(&matrixA[current_row++][0], A_WIDTH, MPI_DOUBLE, destination, ROW_TAG, MPI_COMM_WORLD);
               }
 
-              /****************************************************************************************************
-              ** Send matrix B to workers only once                                                              **
-              ****************************************************************************************************/
-              if (program_counter == 0) {
-                 for (destination = 1; destination < NUMBER_OF_PROCESSES; destination++) {
-                     MPI_Send(&matrixB[0][0], B_HEIGHT * B_WIDTH, MPI_DOUBLE, destination, COLUMN_TAG, MPI_COMM_WORLD);
-                 }
-              }
-
               for (source = 1; source < NUMBER_OF_PROCESSES; source++) {
-                  MPI_Recv(&matrixC[previous_row++][0], A_WIDTH, MPI_DOUBLE, source, ROW_TAG, MPI_COMM_WORLD, &status);
+                  MPI_Recv(&matrixC[previous_row++][0], B_WIDTH, MPI_DOUBLE, source, ROW_TAG, MPI_COMM_WORLD, &status);
               }
           }
        #else
@@ -281,12 +759,7 @@ int main(int argc, char** argv) {
           printf("== Serial version                                                   ==\n");
           printf("======================================================================\n\n");
           for (i = 0; i < A_HEIGHT; i++) {
-              for (j = 0; j < B_WIDTH; j++) {
-                  matrixC[i][j] = 0.0;
-                  for (k = 0; k < A_WIDTH; k++) {
-                      matrixC[i][j] += (matrixA[i][k] * matrixB[k][j]);
-                  }
-              }
+              multiply_row(&matrixA[i][0], &matrixB[0][0], &matrixC[i][0], A_WIDTH, B_WIDTH);
           }
           #ifdef DEBUG
              print_matrix(&matrixC[0][0], A_HEIGHT, B_WIDTH);
@@ -294,15 +767,13 @@ int main(int argc, char** argv) {
           #endif
        #endif
 
-       end = time(NULL);
+       end = MPI_Wtime();
     }
     /****************************************************************************************************
     ** WORKERS                                                                                         **
     ****************************************************************************************************/
     else {
        #ifndef SERIAL
-          int i, j;
-
           results = (double*) calloc(B_WIDTH, sizeof(double));
 
           if (results == NULL) {
@@ -322,31 +793,194 @@ int main(int argc, char** argv) {
           }
 
           /****************************************************************************************************
-          ** Get rows in matrix A and everything in matrix B from Master                                     **
+          ** Get rows in matrix A from Master (matrix B was already broadcast)                               **
           ****************************************************************************************************/
           for (program_counter = 0; program_counter < SIZE; program_counter++) {
 
               MPI_Recv(&rowA[0], A_WIDTH, MPI_DOUBLE, MASTER, ROW_TAG, MPI_COMM_WORLD, &status);
 
-              if (program_counter == 0) {
-                 MPI_Recv(&matrixB[0][0], B_HEIGHT * B_WIDTH, MPI_DOUBLE, MASTER, COLUMN_TAG, MPI_COMM_WORLD, &status);
-              }
-
               /***** Perform matrix multiplication, store in results, and then send results to Master *****/
-              for (i = 0; i < B_WIDTH; i++) {
-                  results[i] = 0.0;
-                  for (j = 0; j < A_WIDTH; j++) {
-                      results[i] += (rowA[j] * matrixB[j][i]);
-                  }
-              }
+              multiply_row(rowA, &matrixB[0][0], results, A_WIDTH, B_WIDTH);
 
-              MPI_Send(&results[0], A_WIDTH, MPI_DOUBLE, MASTER, ROW_TAG, MPI_COMM_WORLD);
+              MPI_Send(&results[0], B_WIDTH, MPI_DOUBLE, MASTER, ROW_TAG, MPI_COMM_WORLD);
           }
        #endif
     }
 
+    tlb_misses = tlb_counter_stop(tlb_counter);
+
     MPI_Barrier(MPI_COMM_WORLD);
 
+    /***** -1 from any process means the total is not available *****/
+    {
+       long long* all_tlb_misses = NULL;
+       int i;
+
+       if (PROCESS_ID == MASTER) {
+          all_tlb_misses = (long long*) calloc(NUMBER_OF_PROCESSES, sizeof(long long));
+
+          if (all_tlb_misses == NULL) {
+             printf("Memory allocation failed for all_tlb_misses array! ");
+             printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+             MPI_Abort(MPI_COMM_WORLD, 1);
+          }
+       }
+
+       MPI_Gather(&tlb_misses, 1, MPI_LONG_LONG, all_tlb_misses, 1, MPI_LONG_LONG, MASTER, MPI_COMM_WORLD);
+
+       if (PROCESS_ID == MASTER) {
+          for (i = 0; i < NUMBER_OF_PROCESSES; i++) {
+              total_tlb_misses = (total_tlb_misses < 0 || all_tlb_misses[i] < 0) ? -1 : total_tlb_misses + all_tlb_misses[i];
+          }
+          free(all_tlb_misses);
+       }
+    }
+
+    /****************************************************************************************************
+    ** Check results with Freivalds' algorithm                                                         **
+    ****************************************************************************************************/
+    tolerance = 2.0 * (A_WIDTH + B_WIDTH) * DBL_EPSILON;
+
+    verification_time = MPI_Wtime();
+    residual = freivalds_check(&matrixA[0][0], A_WIDTH, &matrixB[0][0], &matrixC[0][0], B_WIDTH,
+                               A_HEIGHT, A_WIDTH, B_WIDTH);
+    verification_time = MPI_Wtime() - verification_time;
+
+    /****************************************************************************************************
+    ** Multiply matrices again with the Strassen-Winograd engine and compare against classic results   **
+    ****************************************************************************************************/
+    if (ENGINE == STRASSEN_WINOGRAD) {
+       int i, j;
+       int n = A_HEIGHT;
+       int padded_size; /* size of matrices after zero-padding so that every level can be halved */
+       int levels;      /* number of levels of recursion above the crossover size */
+
+       double largest_element = 0.0;
+       double* paddedA = NULL;
+       double* paddedB = NULL;
+       double* paddedC = NULL;
+
+       for (padded_size = n, i = 0; padded_size > CROSSOVER; i++) {
+           padded_size = (padded_size + 1) / 2;
+       }
+       padded_size <<= i;
+       levels = i;
+
+       paddedA = (double*) calloc((size_t) padded_size * padded_size, sizeof(double));
+       paddedB = (double*) calloc((size_t) padded_size * padded_size, sizeof(double));
+       paddedC = (double*) calloc((size_t) padded_size * padded_size, sizeof(double));
+
+       if (paddedA == NULL || paddedB == NULL || paddedC == NULL) {
+          printf("Memory allocation failed for padded matrices! ");
+          printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+          MPI_Finalize();
+          exit(1);
+       }
+
+       MPI_Bcast(&matrixA[0][0], A_HEIGHT * A_WIDTH, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+
+       for (i = 0; i < n; i++) {
+           for (j = 0; j < n; j++) {
+               paddedA[(size_t) i * padded_size + j] = matrixA[i][j];
+               paddedB[(size_t) i * padded_size + j] = matrixB[i][j];
+           }
+       }
+
+       /***** Like end - start of the classic algorithm, the time excludes distributing the matrices *****/
+       MPI_Barrier(MPI_COMM_WORLD);
+       strassen_time = MPI_Wtime();
+
+       strassen_distributed(MPI_COMM_WORLD, paddedA, paddedB, paddedC, padded_size, CROSSOVER);
+
+       strassen_time = MPI_Wtime() - strassen_time;
+
+       /***** Rounding error may grow with each level of recursion *****/
+       strassen_tolerance = tolerance * pow(STRASSEN_ERROR_GROWTH, levels);
+
+       strassen_verification_time = MPI_Wtime();
+       strassen_residual = freivalds_check(&matrixA[0][0], A_WIDTH, &matrixB[0][0], paddedC, padded_size, n, n, n);
+       strassen_verification_time = MPI_Wtime() - strassen_verification_time;
+
+       if (PROCESS_ID == MASTER) {
+          for (i = 0; i < n; i++) {
+              for (j = 0; j < n; j++) {
+                  if (fabs(matrixC[i][j]) > largest_element) {
+                     largest_element = fabs(matrixC[i][j]);
+                  }
+                  if (fabs(paddedC[(size_t) i * padded_size + j] - matrixC[i][j]) > strassen_error) {
+                     strassen_error = fabs(paddedC[(size_t) i * padded_size + j] - matrixC[i][j]);
+                  }
+              }
+          }
+          if (largest_element > 0.0) {
+             strassen_error /= largest_element;
+          }
+       }
+
+       free(paddedC);
+       free(paddedB);
+       free(paddedA);
+    }
+
+    /****************************************************************************************************
+    ** Multiply matrices of small integers with each element type                                      **
+    ****************************************************************************************************/
+    if (ENGINE == MIXED_PRECISION) {
+       size_t i, j;
+       int precision;
+
+       double* sourceA = NULL;
+       double* sourceB = NULL;
+       double* fp64_results = NULL;
+       double* precision_results = NULL;
+
+       size_t size_of_A = (size_t) A_HEIGHT * A_WIDTH;
+       size_t size_of_B = (size_t) B_HEIGHT * B_WIDTH;
+       size_t size_of_C = (size_t) A_HEIGHT * B_WIDTH;
+
+       if (PROCESS_ID == MASTER) {
+          sourceA = (double*) calloc(size_of_A, sizeof(double));
+          sourceB = (double*) calloc(size_of_B, sizeof(double));
+          fp64_results = (double*) calloc(size_of_C, sizeof(double));
+          precision_results = (double*) calloc(size_of_C, sizeof(double));
+
+          if (sourceA == NULL || sourceB == NULL || fp64_results == NULL || precision_results == NULL) {
+             printf("Memory allocation failed for mixed-precision matrices! ");
+             printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+             MPI_Finalize();
+             exit(1);
+          }
+
+          /***** Integers between -7 and 7 are exact in every element type, and so are their products *****/
+          for (i = 0; i < size_of_A; i++) {
+              sourceA[i] = rand() % 15 - 7;
+          }
+          for (i = 0; i < size_of_B; i++) {
+              sourceB[i] = rand() % 15 - 7;
+          }
+       }
+
+       for (precision = 0; precision < NUMBER_OF_PRECISIONS; precision++) {
+           run_precision(&precisions[precision], sourceA, sourceB,
+                         (precision == 0) ? fp64_results : precision_results,
+                         A_HEIGHT, A_WIDTH, B_WIDTH, &precision_times[precision], &pack_times[precision]);
+
+           precision_errors[precision] = 0.0;
+           if (PROCESS_ID == MASTER && precision > 0) {
+              for (j = 0; j < size_of_C; j++) {
+                  if (fabs(precision_results[j] - fp64_results[j]) > precision_errors[precision]) {
+                     precision_errors[precision] = fabs(precision_results[j] - fp64_results[j]);
+                  }
+              }
+           }
+       }
+
+       free(precision_results);
+       free(fp64_results);
+       free(sourceB);
+       free(sourceA);
+    }
+
     /****************************************************************************************************
     ** Print results                                                                                   **
     ****************************************************************************************************/
@@ -362,6 +996,7 @@ int main(int argc, char** argv) {
        printf("======================================================================\n");
        printf("== Summary                                                          ==\n");
        printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
        printf("Total number of processes:                  %10d\n\n", NUMBER_OF_PROCESSES);
        printf("Matrix A\n");
        printf("   Number of rows:                          %10d\n", A_HEIGHT);
@@ -376,18 +1011,93 @@ int main(int argc, char** argv) {
        printf("   Number of rows:                          %10d\n", A_HEIGHT);
        printf("   Number of columns:                       %10d\n", B_WIDTH);
        printf("   Number of elements in matrix C:          %10d\n\n", A_HEIGHT * B_WIDTH);
-       printf("Total runtime:                              %13.2f seconds\n\n", difftime(end, start));
+       printf("Matrix B distribution time (MPI_Bcast):     %13.4f seconds\n", max_distribution_time);
+       printf("Compute time:                               %13.4f seconds\n", end - start);
+       printf("Pages (PAGES=4k, thp, 2m or 1g):            %13s\n", page_backend_name());
+       printf("dTLB load misses (all processes):           ");
+       print_tlb_misses(total_tlb_misses, 13);
+       printf("\n\n");
+       printf("Total runtime:                              %13.4f seconds\n\n", max_distribution_time + (end - start));
+       printf("Verification (Freivalds, %d random vectors): %12s\n", FREIVALDS_TRIALS, (residual <= tolerance) ? "PASSED" : "FAILED");
+       printf("   Largest scaled difference:               %13.4e\n", residual);
+       printf("   Tolerance:                               %13.4e\n", tolerance);
+       printf("   Verification time:                       %13.4f seconds\n\n", verification_time);
+
+       if (ENGINE == STRASSEN_WINOGRAD) {
+          printf("======================================================================\n");
+          printf("== Strassen-Winograd                                                ==\n");
+          printf("======================================================================\n\n");
+          printf("Crossover size:                             %10d\n", CROSSOVER);
+          printf("Runtime, without distribution and padding:  %13.4f seconds\n", strassen_time);
+          printf("Classic runtime, without distribution:      %13.4f seconds\n", end - start);
+          printf("Speedup over classic algorithm:             %13.4f\n", (end - start) / strassen_time);
+          printf("Largest error relative to classic results:  %13.4e\n\n", strassen_error);
+          printf("Verification (Freivalds, %d random vectors): %12s\n", FREIVALDS_TRIALS,
+                 (strassen_residual <= strassen_tolerance) ? "PASSED" : "FAILED");
+          printf("   Largest scaled difference:               %13.4e\n", strassen_residual);
+          printf("   Tolerance:                               %13.4e\n", strassen_tolerance);
+          printf("   Verification time:                       %13.4f seconds\n\n", strassen_verification_time);
+       }
+
+       if (ENGINE == MIXED_PRECISION) {
+          int i;
+          /* Multiplications and additions in one matrix multiplication */
+          double operations = 2.0 * A_HEIGHT * A_WIDTH * B_WIDTH;
+
+          printf("======================================================================\n");
+          printf("== Mixed precision                                                  ==\n");
+          printf("======================================================================\n\n");
+          printf("Seconds and GOP/s are for the kernel alone. Packing is the time to\n");
+          printf("rearrange matrix B for the AVX-512 BF16 and VNNI kernels.\n\n");
+          printf("Precision   Kernel              Seconds   Packing (s)     GOP/s   vs FP64   Largest error\n");
+          printf("---------   ------------   ------------   -----------   -------   -------   -------------\n");
+          for (i = 0; i < NUMBER_OF_PRECISIONS; i++) {
+              printf("%-9s   %-12s   %12.4f   %11.4f   %7.2f   %6.2fx   %13.4e\n", precisions[i].name,
+                     precisions[i].kernel_name, precision_times[i], pack_times[i],
+                     operations / precision_times[i] / 1.0e9, precision_times[0] / precision_times[i],
+                     precision_errors[i]);
+          }
+          printf("\n");
+       }
     }
 
     /***************************************************************************************************/
 
+    {
+       const char* kernels[2 + NUMBER_OF_PRECISIONS] = { "classic row" };
+       const char* variants[2 + NUMBER_OF_PRECISIONS] = { clone_variant() };
+       int count = 1, i;
+
+       if (ENGINE == STRASSEN_WINOGRAD) {
+          kernels[count] = "Strassen blocked";
+          variants[count++] = clone_variant();
+       }
+       if (ENGINE == MIXED_PRECISION) {
+          for (i = 0; i < NUMBER_OF_PRECISIONS; i++) {
+              kernels[count] = precisions[i].name;
+              variants[count++] = precisions[i].kernel_name;
+          }
+       }
+
+       report_kernel_variants(count, kernels, variants);
+    }
+
     if (PROCESS_ID != MASTER) {
        free(rowA);
        free(results);
     }
 
+    page_free(matrixC, (size_t) A_HEIGHT * B_WIDTH, sizeof(double));
+    page_free(matrixB, (size_t) B_HEIGHT * B_WIDTH, sizeof(double));
+    page_free(matrixA, (size_t) A_HEIGHT * A_WIDTH, sizeof(double));
+
     MPI_Finalize();
 
+    /***** Nonzero exit status lets scripts catch wrong results *****/
+    if (PROCESS_ID == MASTER && (residual > tolerance || strassen_residual > strassen_tolerance)) {
+       return 1;
+    }
+
     return 0;
 
 }
@@ -447,4 +1157,663 @@ void destroy_matrix(double** matrix, int height) {
 
      free(matrix);
 
+}
+
+KERNEL_CLONES void multiply_row(const double* row, const double* B, double* result, int inner, int width) {
+     int j, k;
+     for (j = 0; j < width; j++) {
+         result[j] = 0.0;
+     }
+     for (k = 0; k < inner; k++) {
+         for (j = 0; j < width; j++) {
+             result[j] += row[k] * B[(size_t) k * width + j];
+         }
+     }
+}
+
+KERNEL_CLONES void multiply_blocked(const double* A, int lda, const double* B, int ldb, double* C, int ldc, int n) {
+
+     int i, j, k, ii, jj, kk;
+     int i_end, j_end, k_end;
+     double a;
+
+     for (i = 0; i < n; i++) {
+         for (j = 0; j < n; j++) {
+             C[(size_t) i * ldc + j] = 0.0;
+         }
+     }
+
+     for (ii = 0; ii < n; ii += BLOCK_SIZE) {
+         i_end = (ii + BLOCK_SIZE < n) ? ii + BLOCK_SIZE : n;
+         for (kk = 0; kk < n; kk += BLOCK_SIZE) {
+             k_end = (kk + BLOCK_SIZE < n) ? kk + BLOCK_SIZE : n;
+             for (jj = 0; jj < n; jj += BLOCK_SIZE) {
+                 j_end = (jj + BLOCK_SIZE < n) ? jj + BLOCK_SIZE : n;
+                 for (i = ii; i < i_end; i++) {
+                     for (k = kk; k < k_end; k++) {
+                         a = A[(size_t) i * lda + k];
+                         for (j = jj; j < j_end; j++) {
+                             C[(size_t) i * ldc + j] += a * B[(size_t) k * ldb + j];
+                         }
+                     }
+                 }
+             }
+         }
+     }
+
+}
+
+void matrix_copy(double* C, int ldc, const double* A, int lda, int n) {
+     int i, j;
+     for (i = 0; i < n; i++) {
+         for (j = 0; j < n; j++) {
+             C[(size_t) i * ldc + j] = A[(size_t) i * lda + j];
+         }
+     }
+}
+
+void matrix_add(double* C, int ldc, const double* A, int lda, const double* B, int ldb, int n) {
+     int i, j;
+     for (i = 0; i < n; i++) {
+         for (j = 0; j < n; j++) {
+             C[(size_t) i * ldc + j] = A[(size_t) i * lda + j] + B[(size_t) i * ldb + j];
+         }
+     }
+}
+
+void matrix_subtract(double* C, int ldc, const double* A, int lda, const double* B, int ldb, int n) {
+     int i, j;
+     for (i = 0; i < n; i++) {
+         for (j = 0; j < n; j++) {
+             C[(size_t) i * ldc + j] = A[(size_t) i * lda + j] - B[(size_t) i * ldb + j];
+         }
+     }
+}
+
+void strassen_winograd(const double* A, int lda, const double* B, int ldb, double* C, int ldc,
+                       int n, int crossover, double* workspace) {
+
+     int h = n / 2;
+
+     const double *A11, *A12, *A21, *A22, *B11, *B12, *B21, *B22;
+     double *C11, *C12, *C21, *C22, *X, *Y;
+
+     if (n <= crossover || n % 2 != 0) {
+        multiply_blocked(A, lda, B, ldb, C, ldc, n);
+        return;
+     }
+
+     A11 = A; A12 = A + h; A21 = A + (size_t) h * lda; A22 = A21 + h;
+     B11 = B; B12 = B + h; B21 = B + (size_t) h * ldb; B22 = B21 + h;
+     C11 = C; C12 = C + h; C21 = C + (size_t) h * ldc; C22 = C21 + h;
+
+     /***** X holds sums of quadrants of A, Y holds sums of quadrants of B *****/
+     X = workspace;
+     Y = workspace + (size_t) h * h;
+     workspace += (size_t) 2 * h * h;
+
+     matrix_subtract(X, h, A11, lda, A21, lda, h);                      /* S3 = A11 - A21 */
+     matrix_subtract(Y, h, B22, ldb, B12, ldb, h);                      /* T3 = B22 - B12 */
+     strassen_winograd(X, h, Y, h, C21, ldc, h, crossover, workspace);  /* P7 = S3 * T3   */
+     matrix_add(X, h, A21, lda, A22, lda, h);                           /* S1 = A21 + A22 */
+     matrix_subtract(Y, h, B12, ldb, B11, ldb, h);                      /* T1 = B12 - B11 */
+     strassen_winograd(X, h, Y, h, C22, ldc, h, crossover, workspace);  /* P5 = S1 * T1   */
+     matrix_subtract(X, h, X, h, A11, lda, h);                          /* S2 = S1 - A11  */
+     matrix_subtract(Y, h, B22, ldb, Y, h, h);                          /* T2 = B22 - T1  */
+     strassen_winograd(X, h, Y, h, C12, ldc, h, crossover, workspace);  /* P6 = S2 * T2   */
+     matrix_subtract(X, h, A12, lda, X, h, h);                          /* S4 = A12 - S2  */
+     matrix_subtract(Y, h, Y, h, B21, ldb, h);                          /* T4 = T2 - B21  */
+     strassen_winograd(X, h, B22, ldb, C11, ldc, h, crossover, workspace); /* P3 = S4 * B22 */
+     strassen_winograd(A11, lda, B11, ldb, X, h, h, crossover, workspace); /* P1 = A11 * B11 */
+     matrix_add(C12, ldc, C12, ldc, X, h, h);                           /* U2 = P1 + P6   */
+     matrix_add(C21, ldc, C12, ldc, C21, ldc, h);                       /* U3 = U2 + P7   */
+     matrix_add(C12, ldc, C12, ldc, C22, ldc, h);                       /* U4 = U2 + P5   */
+     matrix_add(C22, ldc, C21, ldc, C22, ldc, h);                       /* U7 = U3 + P5   */
+     matrix_add(C12, ldc, C12, ldc, C11, ldc, h);                       /* U5 = U4 + P3   */
+     strassen_winograd(A22, lda, Y, h, C11, ldc, h, crossover, workspace); /* P4 = A22 * T4 */
+     matrix_subtract(C21, ldc, C21, ldc, C11, ldc, h);                  /* U6 = U3 - P4   */
+     strassen_winograd(A12, lda, B21, ldb, C11, ldc, h, crossover, workspace); /* P2 = A12 * B21 */
+     matrix_add(C11, ldc, X, h, C11, ldc, h);                           /* U1 = P1 + P2   */
+
+}
+
+void strassen_distributed(MPI_Comm comm, const double* A, const double* B, double* C, int n, int crossover) {
+
+     int h = n / 2;
+     int allocation_failed = 0;
+     int group;             /* group of processes that this process belongs to */
+     int group_rank;        /* rank of this process within its group           */
+     int number_of_groups;
+     int product;           /* 0 to 6 for P1 to P7                             */
+     int rank, size;
+
+     size_t quadrant = (size_t) h * h;
+
+     const double *A11, *A12, *A21, *A22, *B11, *B12, *B21, *B22;
+     double* P[7];
+     double *S, *T;
+
+     MPI_Comm group_comm;
+     MPI_Status status;
+
+     MPI_Comm_rank(comm, &rank);
+     MPI_Comm_size(comm, &size);
+
+     /***** A single process, or matrices too small to split, are handled without communication *****/
+     if (size == 1 || n <= crossover || n % 2 != 0) {
+        if (rank == 0) {
+           double* workspace = (double*) calloc((size_t) n * n, sizeof(double));
+
+           if (workspace == NULL) {
+              printf("Memory allocation failed for Strassen-Winograd workspace! ");
+              printf("Unable to allocate memory.\nAborting program...\n");
+              MPI_Abort(MPI_COMM_WORLD, 1);
+           }
+
+           strassen_winograd(A, n, B, n, C, n, n, crossover, workspace);
+           free(workspace);
+        }
+        return;
+     }
+
+     A11 = A; A12 = A + h; A21 = A + (size_t) h * n; A22 = A21 + h;
+     B11 = B; B12 = B + h; B21 = B + (size_t) h * n; B22 = B21 + h;
+
+     number_of_groups = (size < 7) ? size : 7;
+     group = (int) ((long) rank * number_of_groups / size);
+
+     MPI_Comm_split(comm, group, rank, &group_comm);
+     MPI_Comm_rank(group_comm, &group_rank);
+
+     S = (double*) calloc(quadrant, sizeof(double));
+     T = (double*) calloc(quadrant, sizeof(double));
+
+     for (product = 0; product < 7; product++) {
+         P[product] = NULL;
+         if (rank == 0 || (product % number_of_groups == group && group_rank == 0)) {
+            P[product] = (double*) calloc(quadrant, sizeof(double));
+            allocation_failed |= (P[product] == NULL);
+         }
+     }
+
+     if (S == NULL || T == NULL || allocation_failed) {
+        printf("Memory allocation failed for Strassen-Winograd products! ");
+        printf("Unable to allocate memory.\nAborting program...\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+     }
+
+     /****************************************************************************************************
+     ** Each group computes the products that were dealt out to it                                      **
+     ****************************************************************************************************/
+     for (product = group; product < 7; product += number_of_groups) {
+         switch (product) {
+                case 0: /* P1 = A11 * B11 */
+                     matrix_copy(S, h, A11, n, h);
+                     matrix_copy(T, h, B11, n, h);
+                     break;
+                case 1: /* P2 = A12 * B21 */
+                     matrix_copy(S, h, A12, n, h);
+                     matrix_copy(T, h, B21, n, h);
+                     break;
+                case 2: /* P3 = S4 * B22, where S4 = A12 - (A21 + A22 - A11) */
+                     matrix_add(S, h, A21, n, A22, n, h); matrix_subtract(S, h, S, h, A11, n, h);
+                     matrix_subtract(S, h, A12, n, S, h, h);
+                     matrix_copy(T, h, B22, n, h);
+                     break;
+                case 3: /* P4 = A22 * T4, where T4 = B22 - (B12 - B11) - B21 */
+                     matrix_copy(S, h, A22, n, h);
+                     matrix_subtract(T, h, B12, n, B11, n, h); matrix_subtract(T, h, B22, n, T, h, h);
+                     matrix_subtract(T, h, T, h, B21, n, h);
+                     break;
+                case 4: /* P5 = S1 * T1, where S1 = A21 + A22 and T1 = B12 - B11 */
+                     matrix_add(S, h, A21, n, A22, n, h);
+                     matrix_subtract(T, h, B12, n, B11, n, h);
+                     break;
+                case 5: /* P6 = S2 * T2, where S2 = A21 + A22 - A11 and T2 = B22 - (B12 - B11) */
+                     matrix_add(S, h, A21, n, A22, n, h); matrix_subtract(S, h, S, h, A11, n, h);
+                     matrix_subtract(T, h, B12, n, B11, n, h); matrix_subtract(T, h, B22, n, T, h, h);
+                     break;
+                case 6: /* P7 = S3 * T3, where S3 = A11 - A21 and T3 = B22 - B12 */
+                     matrix_subtract(S, h, A11, n, A21, n, h);
+                     matrix_subtract(T, h, B22, n, B12, n, h);
+                     break;
+         }
+
+         strassen_distributed(group_comm, S, T, P[product], h, crossover);
+
+         if (group_rank == 0 && rank != 0) {
+            MPI_Send(P[product], (int) quadrant, MPI_DOUBLE, 0, product, comm);
+         }
+     }
+
+     /****************************************************************************************************
+     ** Rank 0 collects the products from the other groups and combines them                            **
+     ****************************************************************************************************/
+     if (rank == 0) {
+        double *C11 = C, *C12 = C + h, *C21 = C + (size_t) h * n, *C22 = C21 + h;
+
+        for (product = 0; product < 7; product++) {
+            if (product % number_of_groups != group) {
+               MPI_Recv(P[product], (int) quadrant, MPI_DOUBLE, MPI_ANY_SOURCE, product, comm, &status);
+            }
+        }
+
+        matrix_add(C11, n, P[0], h, P[1], h, h);                  /* C11 = P1 + P2           */
+        matrix_add(C12, n, P[0], h, P[5], h, h);                  /* U2  = P1 + P6           */
+        matrix_add(C21, n, C12, n, P[6], h, h);                   /* U3  = U2 + P7           */
+        matrix_add(C22, n, C21, n, P[4], h, h);                   /* C22 = U3 + P5           */
+        matrix_subtract(C21, n, C21, n, P[3], h, h);              /* C21 = U3 - P4           */
+        matrix_add(C12, n, C12, n, P[4], h, h);                   /* U4  = U2 + P5           */
+        matrix_add(C12, n, C12, n, P[2], h, h);                   /* C12 = U4 + P3           */
+     }
+
+     for (product = 0; product < 7; product++) {
+         free(P[product]);
+     }
+     free(T);
+     free(S);
+
+     MPI_Comm_free(&group_comm);
+
+}
+
+double freivalds_check(const double* A, int lda, const double* B, const double* C, int ldc,
+                       int height, int inner, int width) {
+
+     int i, j, k, trial;
+     int number_of_processes, process_id;
+     int rows;  /* number of rows of A and C checked by each process */
+     int first, last;
+
+     double difference, bound, product, expected;
+     double largest = 0.0;
+     double result = 0.0;
+
+     double* r = (double*) calloc(width, sizeof(double));
+     double* myA = NULL;
+     double* myC = NULL;
+     /* Pairs of (B * r, |B| * |r|) for every row of B */
+     double* Br = (double*) calloc(2 * (size_t) inner, sizeof(double));
+     int* counts = NULL;
+     int* displacements = NULL;
+
+     MPI_Datatype rowsA_type, rowsC_type, block_type;
+
+     MPI_Comm_size(MPI_COMM_WORLD, &number_of_processes);
+     MPI_Comm_rank(MPI_COMM_WORLD, &process_id);
+
+     rows = height / number_of_processes;
+     myA = (double*) calloc((size_t) rows * inner, sizeof(double));
+     myC = (double*) calloc((size_t) rows * width, sizeof(double));
+     counts = (int*) calloc(number_of_processes, sizeof(int));
+     displacements = (int*) calloc(number_of_processes, sizeof(int));
+
+     if (r == NULL || Br == NULL || myA == NULL || myC == NULL || counts == NULL || displacements == NULL) {
+        printf("Memory allocation failed for verification arrays! ");
+        printf("Unable to allocate memory on process %d.\nAborting program...\n", process_id);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+     }
+
+     /****************************************************************************************************
+     ** Scatter blocks of rows; derived datatypes skip the padding between rows of A and C              **
+     ****************************************************************************************************/
+     MPI_Type_vector(rows, inner, lda, MPI_DOUBLE, &block_type);
+     MPI_Type_create_resized(block_type, 0, (MPI_Aint) rows * lda * sizeof(double), &rowsA_type);
+     MPI_Type_commit(&rowsA_type);
+     MPI_Type_free(&block_type);
+
+     MPI_Type_vector(rows, width, ldc, MPI_DOUBLE, &block_type);
+     MPI_Type_create_resized(block_type, 0, (MPI_Aint) rows * ldc * sizeof(double), &rowsC_type);
+     MPI_Type_commit(&rowsC_type);
+     MPI_Type_free(&block_type);
+
+     MPI_Scatter(A, 1, rowsA_type, myA, rows * inner, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+     MPI_Scatter(C, 1, rowsC_type, myC, rows * width, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+
+     MPI_Type_free(&rowsC_type);
+     MPI_Type_free(&rowsA_type);
+
+     /***** Rows of B are divided as evenly as possible for computing B * r *****/
+     for (i = 0; i < number_of_processes; i++) {
+         counts[i] = 2 * (inner / number_of_processes + (i < inner % number_of_processes));
+         displacements[i] = (i == 0) ? 0 : displacements[i - 1] + counts[i - 1];
+     }
+     first = displacements[process_id] / 2;
+     last = first + counts[process_id] / 2;
+
+     for (trial = 0; trial < FREIVALDS_TRIALS; trial++) {
+
+         if (process_id == MASTER) {
+            for (j = 0; j < width; j++) {
+                r[j] = (double) rand() / RAND_MAX;
+            }
+         }
+
+         MPI_Bcast(r, width, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+
+         for (k = first; k < last; k++) {
+             Br[2 * k] = 0.0;
+             Br[2 * k + 1] = 0.0;
+             for (j = 0; j < width; j++) {
+                 Br[2 * k] += B[(size_t) k * width + j] * r[j];
+                 Br[2 * k + 1] += fabs(B[(size_t) k * width + j]) * r[j];
+             }
+         }
+
+         MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, Br, counts, displacements, MPI_DOUBLE, MPI_COMM_WORLD);
+
+         for (i = 0; i < rows; i++) {
+             product = 0.0;
+             for (j = 0; j < width; j++) {
+                 product += myC[(size_t) i * width + j] * r[j];
+             }
+
+             expected = 0.0;
+             bound = 0.0;
+             for (k = 0; k < inner; k++) {
+                 expected += myA[(size_t) i * inner + k] * Br[2 * k];
+                 bound += fabs(myA[(size_t) i * inner + k]) * Br[2 * k + 1];
+             }
+
+             difference = fabs(product - expected);
+             if (bound > 0.0) {
+                difference /= bound;
+             }
+             if (difference > largest || difference != difference) {
+                largest = difference;
+             }
+         }
+     }
+
+     MPI_Reduce(&largest, &result, 1, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+
+     free(displacements);
+     free(counts);
+     free(myC);
+     free(myA);
+     free(Br);
+     free(r);
+
+     return result;
+
+}
+
+bfloat16 float_to_bf16(float value) {
+     union { float f; uint32_t u; } bits;
+     bits.f = value;
+     bits.u += 0x7FFF + ((bits.u >> 16) & 1);
+     return (bfloat16) (bits.u >> 16);
+}
+
+float bf16_to_float(bfloat16 value) {
+     union { float f; uint32_t u; } bits;
+     bits.u = (uint32_t) value << 16;
+     return bits.f;
+}
+
+#ifdef DISPATCH
+TARGET("avx512f,avx512bf16") void gemm_bf16_avx512(const void* A, const void* B, void* C, int rows, int inner, int columns) {
+
+     const bfloat16* a = (const bfloat16*) A;
+     const bfloat16* packed = (const bfloat16*) B;
+     float* c = (float*) C;
+
+     int padded_columns = (columns + 63) & ~63;
+     int pairs = (inner + 1) / 2;
+     int i, j, k;
+
+     float* row = (float*) calloc(padded_columns, sizeof(float));
+
+     if (row == NULL) {
+        printf("Memory allocation failed for BF16 row! ");
+        printf("Unable to allocate memory.\nAborting program...\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+     }
+
+     for (i = 0; i < rows; i++) {
+         const bfloat16* rowA = a + (size_t) i * inner;
+         for (j = 0; j < padded_columns; j += 64) {
+             __m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps();
+             __m512 sum2 = _mm512_setzero_ps(), sum3 = _mm512_setzero_ps();
+             for (k = 0; k < pairs; k++) {
+                 const bfloat16* panel = packed + ((size_t) k * padded_columns + j) * 2;
+                 uint32_t pair = rowA[2 * k] | ((2 * k + 1 < inner) ? (uint32_t) rowA[2 * k + 1] << 16 : 0);
+                 __m512bh broadcast = (__m512bh) _mm512_set1_epi32((int) pair);
+                 sum0 = _mm512_dpbf16_ps(sum0, broadcast, (__m512bh) _mm512_loadu_si512(panel));
+                 sum1 = _mm512_dpbf16_ps(sum1, broadcast, (__m512bh) _mm512_loadu_si512(panel + 32));
+                 sum2 = _mm512_dpbf16_ps(sum2, broadcast, (__m512bh) _mm512_loadu_si512(panel + 64));
+                 sum3 = _mm512_dpbf16_ps(sum3, broadcast, (__m512bh) _mm512_loadu_si512(panel + 96));
+             }
+             _mm512_storeu_ps(row + j, sum0);
+             _mm512_storeu_ps(row + j + 16, sum1);
+             _mm512_storeu_ps(row + j + 32, sum2);
+             _mm512_storeu_ps(row + j + 48, sum3);
+         }
+         for (j = 0; j < columns; j++) {
+             c[(size_t) i * columns + j] = row[j];
+         }
+     }
+
+     free(row);
+
+}
+
+void* pack_bf16_pairs(const void* B, int inner, int columns) {
+
+     const bfloat16* b = (const bfloat16*) B;
+
+     /***** Round up so that every vector is full; padded elements are zero *****/
+     int padded_columns = (columns + 63) & ~63;
+     int pairs = (inner + 1) / 2;
+     int j, k;
+
+     bfloat16* packed = (bfloat16*) calloc((size_t) pairs * padded_columns * 2, sizeof(bfloat16));
+
+     if (packed == NULL) {
+        printf("Memory allocation failed for packed BF16 matrix! ");
+        printf("Unable to allocate memory.\nAborting program...\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+     }
+
+     /***** packed[k / 2][j][k % 2] = B[k][j] *****/
+     for (k = 0; k < inner; k++) {
+         for (j = 0; j < columns; j++) {
+             packed[((size_t) (k / 2) * padded_columns + j) * 2 + (k % 2)] = b[(size_t) k * columns + j];
+         }
+     }
+
+     return packed;
+
+}
+#endif
+
+#ifdef DISPATCH
+TARGET("avx512f,avx512vnni") void gemm_int8_avx512(const void* A, const void* B, void* C, int rows, int inner, int columns) {
+
+     const int8_t* a = (const int8_t*) A;
+     const int8_t* packed = (const int8_t*) B;
+     int32_t* c = (int32_t*) C;
+
+     int padded_columns = (columns + 63) & ~63;
+     int quads = (inner + 3) / 4;
+     int i, j, k;
+
+     /***** The column sums follow the packed elements *****/
+     const int32_t* column_sums = (const int32_t*) (packed + (size_t) quads * padded_columns * 4);
+     int32_t* row = (int32_t*) calloc(padded_columns, sizeof(int32_t));
+
+     if (row == NULL) {
+        printf("Memory allocation failed for INT8 row! ");
+        printf("Unable to allocate memory.\nAborting program...\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+     }
+
+     for (i = 0; i < rows; i++) {
+         const int8_t* rowA = a + (size_t) i * inner;
+         for (j = 0; j < padded_columns; j += 64) {
+             __m512i sum0 = _mm512_setzero_si512(), sum1 = _mm512_setzero_si512();
+             __m512i sum2 = _mm512_setzero_si512(), sum3 = _mm512_setzero_si512();
+             for (k = 0; k < quads; k++) {
+                 const int8_t* panel = packed + ((size_t) k * padded_columns + j) * 4;
+                 uint32_t quad = 0;
+                 int l;
+                 for (l = 0; l < 4; l++) {
+                     uint8_t element = (4 * k + l < inner) ? (uint8_t) (rowA[4 * k + l] + 128) : 128;
+                     quad |= (uint32_t) element << (8 * l);
+                 }
+                 __m512i broadcast = _mm512_set1_epi32((int) quad);
+                 sum0 = _mm512_dpbusd_epi32(sum0, broadcast, _mm512_loadu_si512(panel));
+                 sum1 = _mm512_dpbusd_epi32(sum1, broadcast, _mm512_loadu_si512(panel + 64));
+                 sum2 = _mm512_dpbusd_epi32(sum2, broadcast, _mm512_loadu_si512(panel + 128));
+                 sum3 = _mm512_dpbusd_epi32(sum3, broadcast, _mm512_loadu_si512(panel + 192));
+             }
+             _mm512_storeu_si512(row + j, sum0);
+             _mm512_storeu_si512(row + j + 16, sum1);
+             _mm512_storeu_si512(row + j + 32, sum2);
+             _mm512_storeu_si512(row + j + 48, sum3);
+         }
+         for (j = 0; j < columns; j++) {
+             c[(size_t) i * columns + j] = row[j] - 128 * column_sums[j];
+         }
+     }
+
+     free(row);
+
+}
+
+void* pack_int8_quads(const void* B, int inner, int columns) {
+
+     const int8_t* b = (const int8_t*) B;
+
+     /***** Round up so that every vector is full; padded elements are zero *****/
+     int padded_columns = (columns + 63) & ~63;
+     int quads = (inner + 3) / 4;
+     int j, k;
+
+     /***** Every group of four rows holds a multiple of 64 bytes, so the column sums after them are aligned *****/
+     int8_t* packed = (int8_t*) calloc((size_t) quads * padded_columns * 4 + padded_columns * sizeof(int32_t), 1);
+     int32_t* column_sums;
+
+     if (packed == NULL) {
+        printf("Memory allocation failed for packed INT8 matrix! ");
+        printf("Unable to allocate memory.\nAborting program...\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+     }
+
+     column_sums = (int32_t*) (packed + (size_t) quads * padded_columns * 4);
+
+     /***** packed[k / 4][j][k % 4] = B[k][j] *****/
+     for (k = 0; k < inner; k++) {
+         for (j = 0; j < columns; j++) {
+             packed[((size_t) (k / 4) * padded_columns + j) * 4 + (k % 4)] = b[(size_t) k * columns + j];
+             column_sums[j] += b[(size_t) k * columns + j];
+         }
+     }
+
+     return packed;
+
+}
+#endif
+
+void select_kernels(void) {
+     int i;
+     for (i = 0; i < NUMBER_OF_PRECISIONS; i++) {
+         precisions[i].kernel_name = clone_variant();
+     }
+     #ifdef DISPATCH
+         if (CPU_SUPPORTS("avx512bf16")) {
+            precisions[2].kernel = gemm_bf16_avx512;
+            precisions[2].pack = pack_bf16_pairs;
+            precisions[2].kernel_name = "AVX-512 BF16";
+         }
+         if (CPU_SUPPORTS("avx512vnni")) {
+            precisions[3].kernel = gemm_int8_avx512;
+            precisions[3].pack = pack_int8_quads;
+            precisions[3].kernel_name = "AVX-512 VNNI";
+         }
+     #endif
+}
+
+void run_precision(const gemm_precision* precision, const double* sourceA, const double* sourceB,
+                   double* results, int height, int inner, int width, double* kernel_time, double* pack_time) {
+
+     int i;
+     int number_of_processes, process_id;
+     int rows; /* number of rows in matrix A for each process */
+
+     double time_in_kernel;
+     double time_packing = 0.0;
+
+     void* matrixA = NULL;
+     void* matrixB = NULL;
+     /* Matrix B as the kernel reads it */
+     void* packedB = NULL;
+     void* matrixC = NULL;
+     void* rowsA = NULL;
+     void* rowsC = NULL;
+
+     MPI_Comm_size(MPI_COMM_WORLD, &number_of_processes);
+     MPI_Comm_rank(MPI_COMM_WORLD, &process_id);
+
+     rows = height / number_of_processes;
+
+     matrixB = calloc((size_t) inner * width, precision->element_size);
+     rowsA = calloc((size_t) rows * inner, precision->element_size);
+     rowsC = calloc((size_t) rows * width, precision->result_size);
+
+     if (process_id == MASTER) {
+        matrixA = calloc((size_t) height * inner, precision->element_size);
+        matrixC = calloc((size_t) height * width, precision->result_size);
+     }
+
+     if (matrixB == NULL || rowsA == NULL || rowsC == NULL ||
+         (process_id == MASTER && (matrixA == NULL || matrixC == NULL))) {
+        printf("Memory allocation failed for %s matrices! ", precision->name);
+        printf("Unable to allocate memory on process %d.\nAborting program...\n", process_id);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+     }
+
+     if (process_id == MASTER) {
+        precision->from_double(sourceA, matrixA, (size_t) height * inner);
+        precision->from_double(sourceB, matrixB, (size_t) inner * width);
+     }
+
+     MPI_Bcast(matrixB, inner * width, precision->element_type, MASTER, MPI_COMM_WORLD);
+     MPI_Scatter(matrixA, rows * inner, precision->element_type,
+                 rowsA, rows * inner, precision->element_type, MASTER, MPI_COMM_WORLD);
+
+     /***** Packing is timed on its own, since the FP64 and FP32 kernels read B as it is *****/
+     packedB = matrixB;
+     if (precision->pack != NULL) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        time_packing = MPI_Wtime();
+        packedB = precision->pack(matrixB, inner, width);
+        time_packing = MPI_Wtime() - time_packing;
+     }
+
+     MPI_Barrier(MPI_COMM_WORLD);
+     time_in_kernel = MPI_Wtime();
+     precision->kernel(rowsA, packedB, rowsC, rows, inner, width);
+     time_in_kernel = MPI_Wtime() - time_in_kernel;
+
+     MPI_Reduce(&time_in_kernel, kernel_time, 1, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+     MPI_Reduce(&time_packing, pack_time, 1, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+     MPI_Gather(rowsC, rows * width, precision->result_type,
+                matrixC, rows * width, precision->result_type, MASTER, MPI_COMM_WORLD);
+
+     if (process_id == MASTER) {
+        for (i = 0; i < height * width; i++) {
+            results[i] = precision->result_to_double(matrixC, i);
+        }
+     }
+
+     free(matrixC);
+     free(matrixA);
+     free(rowsC);
+     free(rowsA);
+     if (packedB != matrixB) {
+        free(packedB);
+     }
+     free(matrixB);
+
 }
\ No newline at end of file
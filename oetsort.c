@@ -20,6 +20,12 @@
  *           "snake-like" order (diagonally, in ascending order). If it is not, this process is repeated
  *           until it is sorted.
  *
+ *           \par Kernel variants:
+ *           Each compare-exchange keeps the smaller and larger of two elements without branching,
+ *           so the pairs in a row are compared in vectors. The sort kernels are compiled for
+ *           AVX-512, AVX2 and the baseline, the variant that matches the CPU is picked when the
+ *           program loads, and every process reports which variant it ran.
+ *
  *           \note
  *           Unfortunately, the time complexity of this program is O(\f$n^2\f$) because bubble sort is
  *           used to sort the rows and columns, so it is recommended that the value for argv[1] should
@@ -35,11 +41,16 @@
 #include <stdlib.h>
 #include <time.h>
 #include <mpi.h>
+#include "dispatch.h"
 
 /*! Master process. Usually process 0. */
 #define MASTER      0
 #define TRUE        1
 #define FALSE       0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
 
 /*!
  *
@@ -62,7 +73,7 @@ void initialize(int* matrix, int width, int height);
  *  \param length Size of subarray
  *
  */
-void esort(int* row, int length);
+KERNEL_CLONES void esort(int* row, int length);
 
 /*!
  *
@@ -73,7 +84,7 @@ void esort(int* row, int length);
  *  \param length Size of subarray
  *
  */
-void ersort(int* row, int length);
+KERNEL_CLONES void ersort(int* row, int length);
 
 /*!
  *
@@ -84,7 +95,7 @@ void ersort(int* row, int length);
  *  \param length Size of subarray
  *
  */
-void osort(int* row, int length);
+KERNEL_CLONES void osort(int* row, int length);
 
 /*!
  *
@@ -95,7 +106,7 @@ void osort(int* row, int length);
  *  \param length Size of subarray
  *
  */
-void orsort(int* row, int length);
+KERNEL_CLONES void orsort(int* row, int length);
 
 /*!
  *
@@ -172,9 +183,9 @@ int main(int argc, char** argv) {
     unsigned char is_sorted;
 
     /* Used to start timing program execution */
-    time_t program_start;
+    double program_start;
     /* Used to end timing program execution */
-    time_t program_end;
+    double program_end;
 
     /* Derived datatype for sending a column in a matrix to a process */
     MPI_Datatype column_type;
@@ -266,7 +277,7 @@ int main(int argc, char** argv) {
            printf("\n");
        #endif
 
-       program_start = time(NULL);
+       program_start = MPI_Wtime();
 
        do {
            #ifdef DEBUG
@@ -375,7 +386,7 @@ int main(int argc, char** argv) {
 
        } while (is_sorted == FALSE);
 
-       program_end = time(NULL);
+       program_end = MPI_Wtime();
     }
     /****************************************************************************************************
     ** WORKERS                                                                                         **
@@ -456,14 +467,21 @@ int main(int argc, char** argv) {
        printf("======================================================================\n");
        printf("== Summary                                                          ==\n");
        printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
        printf("Total number of processes:         %10d\n\n", NUMBER_OF_PROCESSES);
        printf("Length and width of square matrix: %10d\n",  DIMENSION);
        printf("Number of elements in matrix:      %10d\n\n", DIMENSION * DIMENSION);
-       printf("Total runtime:                        %10.2f seconds\n\n", difftime(program_end, program_start));
+       printf("Total runtime:                        %10.4f seconds\n\n", program_end - program_start);
     }
 
     /***************************************************************************************************/
 
+    {
+       const char* kernels[1] = { "compare-exchange" };
+       const char* variants[1] = { clone_variant() };
+       report_kernel_variants(1, kernels, variants);
+    }
+
     free(numbers);
 
     MPI_Finalize();
@@ -486,47 +504,43 @@ void initialize(int* matrix, int height, int width) {
      }
 }
 
-void esort(int *row, int length) {
-     int i, temp;
+KERNEL_CLONES void esort(int *row, int length) {
+     int i, first, second;
      for (i = 0; i < length - 1; i += 2) {
-         if (row[i+1] < row[i]) {
-            temp = row[i+1];
-            row[i+1] = row[i];
-            row[i] = temp;
-         }
+         first = (row[i+1] < row[i]) ? row[i+1] : row[i];
+         second = (row[i+1] < row[i]) ? row[i] : row[i+1];
+         row[i] = first;
+         row[i+1] = second;
      }
 }
 
-void ersort(int *row, int length) {
-     int i, temp;
+KERNEL_CLONES void ersort(int *row, int length) {
+     int i, first, second;
      for (i = 0; i < length - 1; i += 2) {
-         if (row[i+1] > row[i]) {
-            temp = row[i+1];
-            row[i+1] = row[i];
-            row[i] = temp;
-         }
+         first = (row[i+1] > row[i]) ? row[i+1] : row[i];
+         second = (row[i+1] > row[i]) ? row[i] : row[i+1];
+         row[i] = first;
+         row[i+1] = second;
      }
 }
 
-void osort(int *row, int length) {
-     int i, temp;
+KERNEL_CLONES void osort(int *row, int length) {
+     int i, first, second;
      for (i = 1; i < length - 1; i += 2) {
-         if (row[i+1] < row[i]) {
-            temp = row[i+1];
-            row[i+1] = row[i];
-            row[i] = temp;
-         }
+         first = (row[i+1] < row[i]) ? row[i+1] : row[i];
+         second = (row[i+1] < row[i]) ? row[i] : row[i+1];
+         row[i] = first;
+         row[i+1] = second;
      }
 }
 
-void orsort(int *row, int length) {
-     int i, temp;
+KERNEL_CLONES void orsort(int *row, int length) {
+     int i, first, second;
      for (i = 1; i < length - 1; i += 2) {
-         if (row[i+1] > row[i]) {
-            temp = row[i+1];
-            row[i+1] = row[i];
-            row[i] = temp;
-         }
+         first = (row[i+1] > row[i]) ? row[i+1] : row[i];
+         second = (row[i+1] > row[i]) ? row[i] : row[i+1];
+         row[i] = first;
+         row[i+1] = second;
      }
 }
 
@@ -0,0 +1,282 @@
+/*!
+ *
+ *  \file    pagealloc.h
+ *  \brief   Allocates large arrays with 4 KB pages, transparent huge pages or hugetlbfs pages, and
+ *           counts TLB misses
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \date    October 17, 2026
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this works:
+ *           The PAGES environment variable selects how \b page_alloc backs an array for the whole
+ *           run:
+ *           \arg 4k: Ordinary 4 KB pages (default)
+ *           \arg thp: Transparent huge pages. The array is aligned to 2 MB and marked with
+ *                     madvise(MADV_HUGEPAGE), so the kernel backs it with 2 MB pages when it can.
+ *           \arg 2m: 2 MB pages from the hugetlbfs pool (/proc/sys/vm/nr_hugepages)
+ *           \arg 1g: 1 GB pages from the hugetlbfs pool
+ *                    (/sys/kernel/mm/hugepages/hugepages-1048576kB/nr_hugepages)
+ *
+ *           If the hugetlbfs pool does not have enough free pages, the array falls back to
+ *           transparent huge pages, and \b page_backend_name reports the pages that were actually
+ *           used. Like \b calloc, every array starts out filled with zeros.
+ *
+ *           \b tlb_counter_start and \b tlb_counter_stop count the data TLB load misses of the
+ *           calling thread with perf_event_open, so that the gain from huge pages can be seen. On
+ *           systems without hardware counters, or where /proc/sys/kernel/perf_event_paranoid does
+ *           not allow them, the count is -1 and is reported as not available.
+ *
+ */
+
+#ifndef PAGEALLOC_H
+#define PAGEALLOC_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/*! Environment variable that selects the pages used by \b page_alloc */
+#define PAGES_VARIABLE             "PAGES"
+/*! Ordinary pages */
+#define PAGES_4K                   0
+/*! Transparent huge pages */
+#define PAGES_THP                  1
+/*! 2 MB pages from hugetlbfs */
+#define PAGES_2M                   2
+/*! 1 GB pages from hugetlbfs */
+#define PAGES_1G                   3
+/*! Size of a transparent huge page */
+#define HUGE_PAGE_SIZE             (2UL << 20)
+
+/*! Names of the page modes, in the order of their numbers */
+static const char* const PAGE_MODE_NAMES[] = { "4k", "thp", "2m", "1g" };
+/*! Sizes that arrays are rounded up to in each page mode */
+static const size_t PAGE_MODE_SIZES[] = { 4096UL, 2UL << 20, 2UL << 20, 1UL << 30 };
+
+/*! Pages that backed the last array allocated by \b page_alloc, or -1 if none was allocated */
+static int page_backend = -1;
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the page mode selected with the PAGES environment variable. An unknown value selects
+ *  4 KB pages.
+ *
+ *  \return \b PAGES_4K, \b PAGES_THP, \b PAGES_2M or \b PAGES_1G
+ *
+ */
+static inline int page_mode(void) {
+     const char* value = getenv(PAGES_VARIABLE);
+     int mode;
+     if (value != NULL) {
+        for (mode = PAGES_4K; mode <= PAGES_1G; mode++) {
+            if (strcmp(value, PAGE_MODE_NAMES[mode]) == 0) {
+               return mode;
+            }
+        }
+     }
+     return PAGES_4K;
+}
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the name of the pages that backed the last array allocated by \b page_alloc. If a
+ *  hugetlbfs array fell back to transparent huge pages, both are named.
+ *
+ *  \return Name of the pages, e.g. "thp" or "2m -> thp"
+ *
+ */
+static inline const char* page_backend_name(void) {
+     static char name[16];
+     int mode = page_mode();
+     int backend = (page_backend < 0) ? mode : page_backend;
+     if (backend == mode) {
+        return PAGE_MODE_NAMES[mode];
+     }
+     snprintf(name, sizeof(name), "%s -> %s", PAGE_MODE_NAMES[mode], PAGE_MODE_NAMES[backend]);
+     return name;
+}
+
+/*!
+ *
+ *  \par Description:
+ *  Maps \b size bytes aligned to a transparent huge page and asks the kernel to back them with
+ *  huge pages. Extra space is mapped so that the start can be aligned, and then unmapped.
+ *
+ *  \param size Number of bytes. Must be a multiple of the page size.
+ *
+ *  \return Pointer to the array, or NULL if it could not be mapped
+ *
+ */
+static inline void* map_transparent_huge_pages(size_t size) {
+     char* mapping;
+     char* aligned;
+     size_t head, tail;
+
+     mapping = (char*) mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+     if (mapping == MAP_FAILED) {
+        return NULL;
+     }
+
+     aligned = (char*) (((uintptr_t) mapping + HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (HUGE_PAGE_SIZE - 1));
+     head = aligned - mapping;
+     tail = HUGE_PAGE_SIZE - head;
+     if (head > 0) {
+        munmap(mapping, head);
+     }
+     if (tail > 0) {
+        munmap(aligned + size, tail);
+     }
+
+     madvise(aligned, size, MADV_HUGEPAGE);
+     return aligned;
+}
+
+/*!
+ *
+ *  \par Description:
+ *  Allocates a zeroed array with the pages selected by the PAGES environment variable. The size
+ *  is rounded up to a whole number of pages. Must be freed with \b page_free.
+ *
+ *  \param count Number of elements
+ *  \param size Size of each element
+ *
+ *  \return Pointer to the array, or NULL if it could not be allocated
+ *
+ */
+static inline void* page_alloc(size_t count, size_t size) {
+     int mode = page_mode();
+     size_t page_size = PAGE_MODE_SIZES[mode];
+     size_t length = (count * size + page_size - 1) / page_size * page_size;
+     void* array;
+
+     if (length == 0) {
+        length = page_size;
+     }
+
+     if (mode == PAGES_2M || mode == PAGES_1G) {
+        int log2_page_size = (mode == PAGES_2M) ? 21 : 30;
+        array = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (log2_page_size << MAP_HUGE_SHIFT), -1, 0);
+        if (array != MAP_FAILED) {
+           page_backend = mode;
+           return array;
+        }
+        /***** Not enough pages in the hugetlbfs pool *****/
+        mode = PAGES_THP;
+     }
+
+     if (mode == PAGES_THP) {
+        array = map_transparent_huge_pages(length);
+     }
+     else {
+        array = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        array = (array == MAP_FAILED) ? NULL : array;
+     }
+
+     if (array != NULL) {
+        page_backend = mode;
+     }
+     return array;
+}
+
+/*!
+ *
+ *  \par Description:
+ *  Frees an array allocated by \b page_alloc.
+ *
+ *  \param array Pointer returned by \b page_alloc. May be NULL.
+ *  \param count Number of elements passed to \b page_alloc
+ *  \param size Size of each element passed to \b page_alloc
+ *
+ */
+static inline void page_free(void* array, size_t count, size_t size) {
+     size_t page_size = PAGE_MODE_SIZES[page_mode()];
+     size_t length = (count * size + page_size - 1) / page_size * page_size;
+     if (array != NULL) {
+        munmap(array, (length == 0) ? page_size : length);
+     }
+}
+
+/*!
+ *
+ *  \par Description:
+ *  Starts counting the data TLB load misses of the calling thread in user space.
+ *
+ *  \return File descriptor of the counter, or -1 if TLB misses cannot be counted
+ *
+ */
+static inline int tlb_counter_start(void) {
+     struct perf_event_attr attributes;
+     int counter;
+
+     memset(&attributes, 0, sizeof(attributes));
+     attributes.type = PERF_TYPE_HW_CACHE;
+     attributes.size = sizeof(attributes);
+     attributes.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+     attributes.disabled = 1;
+     attributes.exclude_kernel = 1;
+     attributes.exclude_hv = 1;
+
+     counter = (int) syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+     if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+     }
+     return counter;
+}
+
+/*!
+ *
+ *  \par Description:
+ *  Stops a counter started by \b tlb_counter_start and closes it.
+ *
+ *  \param counter File descriptor returned by \b tlb_counter_start
+ *
+ *  \return Number of data TLB load misses, or -1 if they could not be counted
+ *
+ */
+static inline long long tlb_counter_stop(int counter) {
+     long long misses = -1;
+     if (counter < 0) {
+        return -1;
+     }
+     ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+     if (read(counter, &misses, sizeof(misses)) != sizeof(misses)) {
+        misses = -1;
+     }
+     close(counter);
+     return misses;
+}
+
+/*!
+ *
+ *  \par Description:
+ *  Prints a number of TLB misses in a field of the given width, or "n/a" if they were not counted.
+ *
+ *  \param misses Number of TLB misses, or -1
+ *  \param width Width of the field
+ *
+ */
+static inline void print_tlb_misses(long long misses, int width) {
+     if (misses < 0) {
+        printf("%*s", width, "n/a");
+     }
+     else {
+        printf("%*lld", width, misses);
+     }
+}
+
+#endif
@@ -0,0 +1,126 @@
+#!/bin/bash
+#
+# Builds the benchmarks with profile-guided optimization (PGO) and compares each kernel with the
+# same kernel built without it (-O3 -march=native):
+#
+#   1. Builds the instrumented binaries (make pgo-gen) and the native binaries (make native)
+#   2. Runs each kernel with an instrumented binary on a small training input, which writes
+#      profiles to pgo-data
+#   3. Builds the optimized binaries from the profiles (make pgo)
+#   4. Runs each kernel on a larger input with the native and PGO binaries and displays both times
+#
+# The time of a kernel is the one that its program displays, so MPI startup, initialization and
+# verification are left out and do not dilute the difference between the builds.
+#
+# Set MPIRUN to change how programs are started, NP to change the number of processes, and REPEAT
+# to change how many times each kernel is timed. The shortest time is displayed.
+
+MPIRUN=${MPIRUN:-mpirun}
+NP=${NP:-2}
+REPEAT=${REPEAT:-3}
+
+# Kernel | program | number of processes (default NP if empty) | training arguments | benchmark arguments |
+# time of the kernel in the output of the program, which is one of:
+#   a label, such as "Compute time:"  the seconds on the line that starts with the label
+#   processes                         the longest time in the table of runtimes of the processes
+#   precisions                        the sum of the times of the precisions in mm's mixed-precision table
+#   formats                           the sum of the times of the formats in spmv's table of runtimes
+KERNELS=(
+    "mm classic|mm||128 128 128 128|512 512 512 512|Compute time:"
+    "mm Strassen-Winograd|mm||128 128 128 128 2|512 512 512 512 2|Runtime, without distribution and padding:"
+    "mm mixed precision|mm||64 64 64 64 3|512 512 512 512 3|precisions"
+    "pi Bailey-Borwein-Plouffe|pi||1000000 1|20000000 1|processes"
+    "pi Gregory-Leibniz|pi||1000000 2|50000000 2|processes"
+    "prime trial division|prime||300000 1|3000000 1|processes"
+    "prime Lagarias-Miller-Odlyzko|prime||1000000000 2|100000000000 2|processes"
+    "prime sieve|prime||100000000 3|1000000000 3|processes"
+    "prime Miller-Rabin|prime||200000 4|2000000 4|processes"
+    "fileio shell sort|fileio||200000|2000000|Time for process 0 to sort entire array:"
+    "oetsort esort/osort|oetsort||100|200|Total runtime:"
+    "shearsort|shearsort|4|4|4|Total runtime:"
+    "spmv CSR and SELL-C-sigma|spmv||1 32 10|1 64 50|formats"
+)
+
+# Prints the time of a kernel from the output of its program (see KERNELS), or nothing if the
+# output does not have it
+kernel_time() {
+    awk -v kernel="$1" '
+        kernel == "processes" && NF == 3 && $1 ~ /^[0-9]+$/ && $2 ~ /^[0-9]+$/ && $3 ~ /^[0-9.]+$/ {
+            if (!found || $3 > time) { time = $3 }
+            found = 1
+        }
+        kernel == "precisions" && $1 ~ /^(FP64|FP32|BF16|INT8)$/ { time += $(NF - 4); found = 1 }
+        kernel == "formats" && $1 ~ /^(CSR|SELL-C-sigma)$/ { time += $2; found = 1 }
+        kernel ~ /:$/ && index($0, kernel) == 1 && $NF == "seconds" { time = $(NF - 1); found = 1 }
+        END { if (found) { printf "%.6f\n", time } }
+    '
+}
+
+# Runs a program and prints the time of its kernel in seconds, or FAILED if the program exits with
+# an error or does not display the time
+run() {
+    local processes=$1 kernel=$2
+    shift 2
+    local time
+    time=$($MPIRUN -np "$processes" "$@" 2> /dev/null | kernel_time "$kernel"; exit "${PIPESTATUS[0]}")
+    if [ $? -ne 0 ] || [ -z "$time" ]; then
+       echo FAILED
+       return
+    fi
+    echo "$time"
+}
+
+# Prints the shortest of REPEAT runtimes
+best() {
+    local shortest="" time i
+    for ((i = 0; i < REPEAT; i++)); do
+        time=$(run "$@")
+        if [ "$time" = FAILED ]; then
+           echo FAILED
+           return
+        fi
+        if [ -z "$shortest" ] || awk -v a="$time" -v b="$shortest" 'BEGIN { exit !(a < b) }'; then
+           shortest=$time
+        fi
+    done
+    echo "$shortest"
+}
+
+make clean-pgo filegen native pgo-gen || exit 1
+
+# fileio sorts the characters in unsorted.txt
+if [ ! -f unsorted.txt ]; then
+   ./filegen 2000000
+fi
+
+echo "Training..."
+for kernel in "${KERNELS[@]}"; do
+    IFS='|' read -r name program processes training benchmark kernel_output <<< "$kernel"
+    if [ "$(run "${processes:-$NP}" "$kernel_output" "./${program}_pgo-gen" $training)" = FAILED ]; then
+       echo "Training run of $name failed"
+    fi
+done
+
+make pgo || exit 1
+
+echo
+echo "======================================================================"
+echo "== PGO vs. -O3 -march=native                                       =="
+echo "======================================================================"
+echo
+echo "Shortest kernel time of $REPEAT runs in seconds, as displayed by each program."
+echo
+printf "%-32s %12s %12s %10s\n" "Kernel" "Native" "PGO" "Change"
+printf "%-32s %12s %12s %10s\n" "------" "------" "---" "------"
+for kernel in "${KERNELS[@]}"; do
+    IFS='|' read -r name program processes training benchmark kernel_output <<< "$kernel"
+    native=$(best "${processes:-$NP}" "$kernel_output" "./${program}_native" $benchmark)
+    pgo=$(best "${processes:-$NP}" "$kernel_output" "./${program}_pgo" $benchmark)
+    if [ "$native" = FAILED ] || [ "$pgo" = FAILED ]; then
+       change=FAILED
+    else
+       change=$(awk -v a="$native" -v b="$pgo" 'BEGIN { printf "%+.1f%%", 100.0 * (b - a) / a }')
+    fi
+    printf "%-32s %12s %12s %10s\n" "$name" "$native" "$pgo" "$change"
+done
+echo
@@ -18,24 +18,108 @@
  *           sums all the results together. Finally, the value of pi up to the 48th digit as well
  *           as the runtimes for each process are displayed.
  *
+ *           \par Verification:
+ *           The result is compared with the known digits of pi. The error must not exceed the bound
+ *           on the error from stopping the series after N terms plus the bound on the rounding
+ *           error from adding N terms in double precision. The number of correct decimal digits
+ *           and the time spent verifying are displayed separately from the runtimes.
+ *
+ *           \par Kernel variants:
+ *           Each process adds its terms in \b SERIES_LANES partial sums so that the terms can be
+ *           computed in vectors. The series kernels are compiled for AVX-512, AVX2 and the
+ *           baseline, the variant that matches the CPU is picked when the program loads, and every
+ *           process reports which variant it ran.
+ *
  *           \par References:
  *           \arg <A HREF="http://en.wikipedia.org/wiki/Bailey-Borwein-Plouffe_formula">Bailey-Borwein-Plouffe Formula</A>
  *           \arg <A HREF="http://en.wikipedia.org/wiki/Leibniz_formula_for_pi">Gregory-Leibniz Series</A>
  *
  */
 
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <mpi.h>
+#include "dispatch.h"
 
 /*! Master process. Usually process 0. */
 #define MASTER                     0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS                "unknown"
+#endif
 /*! Formula: Sum[ 1/(16^i) * ( 4/(8^i+1) - 2/(8^i+4) - 1/(8^i+5) - 1/(8^i+6) ) ] */
 #define BAILEY_BORWEIN_PLOUFFE     1
 /*! Formula: 4 * Sum[ (-1)^i/(2i+1) ] */
 #define GREGORY_LEIBNIZ            2
+/*! First 50 decimal places of pi */
+#define PI_DIGITS                  "3.14159265358979323846264338327950288419716939937510"
+/*! Double nearest to pi */
+#define PI_HIGH                    3.141592653589793116
+/*! Difference between pi and \b PI_HIGH */
+#define PI_LOW                     1.2246467991473532e-16
+/*! Number of partial sums that each series is split into so that the terms are computed in vectors */
+#define SERIES_LANES               8
+
+/*!
+ *
+ *  \par Description:
+ *  Returns a bound on the error of pi calculated with N terms of a series by Q processes. The
+ *  bound is the sum of the remainder of the series after N terms and the rounding error from
+ *  adding the terms.
+ *
+ *  \param choice 1 for Bailey-Borwein-Plouffe or 2 for Gregory-Leibniz
+ *  \param iterations Number of terms N
+ *  \param processes Number of processes Q, each of which adds its own terms
+ *
+ *  \return Largest possible difference between the result and pi
+ *
+ */
+double error_bound(unsigned short choice, long iterations, int processes);
+
+/*!
+ *
+ *  \par Description:
+ *  Counts the decimal places of a number that are the same as those of pi when both are printed
+ *  with 48 decimal places.
+ *
+ *  \param value Calculated value of pi
+ *
+ *  \return Number of correct decimal places
+ *
+ */
+int correct_digits(double value);
+
+/*!
+ *
+ *  \par Description:
+ *  Adds terms \b first to \b last - 1 of the Bailey-Borwein-Plouffe formula. 1/(16^i) is a power
+ *  of two, so each lane scales it down by 16^SERIES_LANES without rounding.
+ *
+ *  \param first Index of first term
+ *  \param last Index after last term
+ *
+ *  \return Sum of the terms
+ *
+ */
+KERNEL_CLONES double bailey_borwein_plouffe(long first, long last);
+
+/*!
+ *
+ *  \par Description:
+ *  Adds terms \b first to \b last - 1 of the Gregory-Leibniz series, without the factor of 4. The
+ *  sign of each lane never changes because \b SERIES_LANES is even.
+ *
+ *  \param first Index of first term
+ *  \param last Index after last term
+ *
+ *  \return Sum of the terms
+ *
+ */
+KERNEL_CLONES double gregory_leibniz(long first, long last);
 
 /*!
  *  \param argv[1] Number of calculations
@@ -49,11 +133,6 @@ int main(int argc, char** argv) {
     double sum = 0.0;
     /* Value of pi after calculations */
     double total_sum = 0.0;
-    /*
-     * Bailey-Borwein-Plouffe: 1/(16^i)
-     * Gregory-Leibniz:</B> (-1)^i/(2i+1)
-     */
-    double var1;
 
     /* Runtimes of all processes */
     double* runtimes = NULL;
@@ -73,8 +152,6 @@ int main(int argc, char** argv) {
     /* Message identifier for sending/receiving subtotal */
     int SUM_TAG = 2;
 
-    /* Keeps track of number of calculations for a process */
-    long counter;
     /* Total number of calculations */
     long ITERATIONS;
     /* Upper bound of range */
@@ -94,13 +171,22 @@ int main(int argc, char** argv) {
     /* Used to end timing program execution */
     time_t program_end;
     /* Used to start timing calculations done by one process */
-    time_t start;
+    double start;
     /* Used to end timing calculations done by one process */
-    time_t end;
+    double end;
 
     /* Either 1 for Bailey-Borwein-Plouffe formula or 2 for Gregory-Leibniz series */
     unsigned short CHOICE;
 
+    /* Difference between calculated value and pi */
+    double error = 0.0;
+    /* Largest difference allowed between calculated value and pi */
+    double bound = 0.0;
+    /* Time it took to verify the calculated value */
+    double verification_time;
+    /* Whether the calculated value passed verification */
+    int verified = 1;
+
     /* Used in MPI_Recv */
     MPI_Status status;
 
@@ -118,7 +204,7 @@ int main(int argc, char** argv) {
        exit(1);
     }
 
-    if ((CHOICE = atoi(argv[2])) <= 0 && CHOICE >= 3) {
+    if ((CHOICE = atoi(argv[2])) < BAILEY_BORWEIN_PLOUFFE || CHOICE > GREGORY_LEIBNIZ) {
        printf("Error: Invalid argument for choice of method for calculating pi. Please try again.\n");
        exit(1);
     }
@@ -164,12 +250,7 @@ int main(int argc, char** argv) {
     range_size = ITERATIONS / NUMBER_OF_PROCESSES;
     remainder = ITERATIONS % NUMBER_OF_PROCESSES;
 
-    minimum = range_size * PROCESS_ID + 1;
-
-    if (PROCESS_ID == MASTER) {
-       minimum = 0;
-    }
-
+    minimum = range_size * PROCESS_ID;
     maximum = range_size * (PROCESS_ID + 1);
 
     if (PROCESS_ID == NUMBER_OF_PROCESSES - 1) {
@@ -181,36 +262,20 @@ int main(int argc, char** argv) {
     ** Bailey-Borwein-Plouffe formula                                                                  **
     ****************************************************************************************************/
     if (CHOICE == BAILEY_BORWEIN_PLOUFFE) {
-       double var2, /* -(4 / (8k + 1)) */
-              var3, /* -(2 / (8k + 4)) */
-              var4, /* -(1 / (8k + 5)) */
-              var5; /* -(1 / (8k + 6)) */
-
-       start = time(NULL);
-       for (counter = minimum; counter < maximum; counter++) {
-           var1 = 1.0 / (pow(16.0, counter));
-           var2 = 4.0 / (8.0 * counter + 1.0);
-           var3 = 2.0 / ((8.0 * counter) + 4.0);
-           var4 = 1.0 / (8.0 * counter + 5.0);
-           var5 = 1.0 / (8.0 * counter + 6.0);
-           sum += (var1 * (var2 - var3 - var4 - var5));
-       }
-       end = time(NULL);
+       start = MPI_Wtime();
+       sum = bailey_borwein_plouffe(minimum, maximum);
+       end = MPI_Wtime();
     }
     /****************************************************************************************************
     ** Gregory-Leibniz series                                                                          **
     ****************************************************************************************************/
     else if (CHOICE == GREGORY_LEIBNIZ) {
-       start = time(NULL);
-       for (counter = minimum; counter < maximum; counter++) {
-           var1 = (pow(-1.0, counter)) / (2.0 * counter + 1);
-           sum += var1;
-       }
-       sum *= 4.0;
-       end = time(NULL);
+       start = MPI_Wtime();
+       sum = 4.0 * gregory_leibniz(minimum, maximum);
+       end = MPI_Wtime();
     }
 
-    runtime = difftime(end, start);
+    runtime = end - start;
 
     /****************************************************************************************************
     ** Send results to Master                                                                          **
@@ -247,12 +312,13 @@ int main(int argc, char** argv) {
        printf("Process          Number of iterations          Runtime\n");
        printf("-------          --------------------          -------\n\n");
        for (source = 0; source < NUMBER_OF_PROCESSES; source++) {
-           printf("%7d          %20lu          %7.2f\n", source, ranges[source], runtimes[source]);
+           printf("%7d          %20lu          %7.4f\n", source, ranges[source], runtimes[source]);
        }
        printf("\n");
        printf("======================================================================\n");
        printf("== Summary                                                          ==\n");
        printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
        printf("Total number of processes:                    %10d\n\n", NUMBER_OF_PROCESSES);
        printf("Method used for calculating pi: ");
        switch (CHOICE) {
@@ -261,15 +327,145 @@ int main(int argc, char** argv) {
        }
        printf("Total number of iterations:         %20lu\n\n", ITERATIONS);
        printf("Total runtime:                                   %10.2f seconds\n\n", difftime(program_end, program_start));
+
+       verification_time = MPI_Wtime();
+       error = (total_sum - PI_HIGH) - PI_LOW;
+       bound = error_bound(CHOICE, ITERATIONS, NUMBER_OF_PROCESSES);
+       verified = fabs(error) <= bound;
+       verification_time = MPI_Wtime() - verification_time;
+
+       printf("Verification:                                        %6s\n", verified ? "PASSED" : "FAILED");
+       printf("   Correct decimal places:                       %10d\n", correct_digits(total_sum));
+       printf("   Error:                                        %10.2e\n", error);
+       printf("   Error bound:                                  %10.2e\n", bound);
+       printf("   Verification time:                            %10.6f seconds\n\n", verification_time);
     }
 
     /***************************************************************************************************/
 
+    {
+       const char* kernels[1] = { (CHOICE == BAILEY_BORWEIN_PLOUFFE) ? "Bailey-Borwein-Plouffe" : "Gregory-Leibniz" };
+       const char* variants[1] = { clone_variant() };
+       report_kernel_variants(1, kernels, variants);
+    }
+
     free(ranges);
     free(runtimes);
 
     MPI_Finalize();
 
-    return 0;
+    /***** Nonzero exit status lets scripts catch wrong results *****/
+    return verified ? 0 : 1;
+
+}
+
+double error_bound(unsigned short choice, long iterations, int processes) {
+
+    double n = (double) iterations;
+    double truncation, magnitude;
+
+    if (choice == BAILEY_BORWEIN_PLOUFFE) {
+       /* Terms after the Nth are at most 4 / (8k + 1) / 16^k, a geometric series with ratio 1/16 */
+       truncation = 4.0 / (8.0 * n + 1.0) * pow(16.0, -n) * 16.0 / 15.0;
+       /* Sum of the absolute values of the terms is less than pi */
+       magnitude = 4.0;
+    }
+    else {
+       /* Alternating series: remainder is at most the first omitted term */
+       truncation = 4.0 / (2.0 * n + 1.0);
+       /* 4 * Sum[ 1/(2i+1) ] for i < N */
+       magnitude = 4.0 * (1.0 + 0.5 * log(2.0 * n + 1.0));
+    }
+
+    /***** Each term is rounded once and each addition once, including the final sum of Q subtotals *****/
+    return truncation + 2.0 * (n + processes) * DBL_EPSILON * magnitude;
+
+}
+
+int correct_digits(double value) {
+
+    char digits[64];
+    int i;
+
+    snprintf(digits, sizeof(digits), "%.48f", value);
+    if (strncmp(digits, "3.", 2) != 0) {
+       return 0;
+    }
+
+    for (i = 2; digits[i] != '\0' && digits[i] == PI_DIGITS[i]; i++);
+
+    return i - 2;
+
+}
+
+KERNEL_CLONES double bailey_borwein_plouffe(long first, long last) {
+
+    double partial[SERIES_LANES];
+    double scale[SERIES_LANES];   /* 1/(16^i) */
+    double eight_i[SERIES_LANES]; /* 8i       */
+    double sum = 0.0;
+    long i;
+    int lane;
+
+    for (lane = 0; lane < SERIES_LANES; lane++) {
+        partial[lane] = 0.0;
+        scale[lane] = pow(16.0, -(double) (first + lane));
+        eight_i[lane] = 8.0 * (first + lane);
+    }
+
+    /***** 16^-SERIES_LANES = 2^-32 *****/
+    for (i = first; i + SERIES_LANES <= last; i += SERIES_LANES) {
+        for (lane = 0; lane < SERIES_LANES; lane++) {
+            partial[lane] += scale[lane] * (4.0 / (eight_i[lane] + 1.0) - 2.0 / (eight_i[lane] + 4.0)
+                                            - 1.0 / (eight_i[lane] + 5.0) - 1.0 / (eight_i[lane] + 6.0));
+            scale[lane] *= 1.0 / 4294967296.0;
+            eight_i[lane] += 8.0 * SERIES_LANES;
+        }
+    }
+
+    for (lane = 0; i < last; i++, lane++) {
+        partial[lane] += scale[lane] * (4.0 / (eight_i[lane] + 1.0) - 2.0 / (eight_i[lane] + 4.0)
+                                        - 1.0 / (eight_i[lane] + 5.0) - 1.0 / (eight_i[lane] + 6.0));
+    }
+
+    for (lane = 0; lane < SERIES_LANES; lane++) {
+        sum += partial[lane];
+    }
+
+    return sum;
+
+}
+
+KERNEL_CLONES double gregory_leibniz(long first, long last) {
+
+    double partial[SERIES_LANES];
+    double sign[SERIES_LANES];            /* (-1)^i */
+    double denominator[SERIES_LANES];     /* 2i + 1 */
+    double sum = 0.0;
+    long i;
+    int lane;
+
+    for (lane = 0; lane < SERIES_LANES; lane++) {
+        partial[lane] = 0.0;
+        sign[lane] = ((first + lane) % 2 == 0) ? 1.0 : -1.0;
+        denominator[lane] = 2.0 * (first + lane) + 1.0;
+    }
+
+    for (i = first; i + SERIES_LANES <= last; i += SERIES_LANES) {
+        for (lane = 0; lane < SERIES_LANES; lane++) {
+            partial[lane] += sign[lane] / denominator[lane];
+            denominator[lane] += 2.0 * SERIES_LANES;
+        }
+    }
+
+    for (lane = 0; i < last; i++, lane++) {
+        partial[lane] += sign[lane] / denominator[lane];
+    }
+
+    for (lane = 0; lane < SERIES_LANES; lane++) {
+        sum += partial[lane];
+    }
+
+    return sum;
 
-}
\ No newline at end of file
+}
@@ -18,14 +18,62 @@
  *           loop terminates; otherwise, it is prime, and the process adds one to its total count.
  *           Finally, the runtimes and total counts of each process are displayed.
  *
- *           \par Reference:
- *           <A HREF="http://www.troubleshooters.com/codecorn/primenumbers/primenumbers.htm">Fun With Prime Numbers</A>
+ *           \par Cyclic blocks:
+ *           Larger numbers take longer to test, so the process with the last range finishes last.
+ *           If a block size B is given, the numbers are also divided into blocks of B numbers, and
+ *           process r tests blocks r, r + Q, r + 2Q, and so on, so that every process gets small and
+ *           large numbers without any communication. Both divisions are timed, one after the
+ *           other, and the spread of the runtimes of the processes is displayed for each.
+ *
+ *           \par Lagarias-Miller-Odlyzko method:
+ *           For large N, the primes can be counted without testing each number. With y = alpha *
+ *           cbrt(N) and a = pi(y), pi(N) = phi(N, a) + a - 1 - P2(N, a), where phi(N, a) counts the
+ *           numbers up to N that are not divisible by any of the first a primes and P2(N, a) counts
+ *           the numbers up to N that are products of two primes larger than y. phi(N, a) is split
+ *           into ordinary leaves, which are added up by the master, and special leaves, which need
+ *           phi(N / n, b) for N / n < N / y. The interval [1, N / y] is divided into ranges for each
+ *           process, and each process sieves its range segment by segment, using a binary indexed
+ *           tree to count the numbers left in a segment. Counts below the start of a range are not
+ *           known until all processes are done, so they are added afterwards with \b MPI_Exscan.
+ *           P2(N, a) is computed in the same ranges with a segmented sieve of Eratosthenes. The
+ *           runtime is O(\f$N^{2/3}\f$) instead of O(\f$N^{3/2}\f$) for trial division.
+ *
+ *           \par Sieve of Eratosthenes:
+ *           Each process sieves its range in segments that fit in the L1 cache. Only odd numbers
+ *           are stored, one bit each, so a byte holds 16 numbers. The multiples of 3, 5, 7, 11 and
+ *           13 repeat every 15015 bytes, so that pattern is copied into each segment with \b memcpy
+ *           before the remaining primes up to sqrt(N) are crossed off. The primes left in a
+ *           segment are counted 64 bits at a time with a population count instruction.
+ *
+ *           \par Miller-Rabin test:
+ *           Instead of counting primes up to N, each process tests N / Q random odd 64-bit numbers
+ *           with the Miller-Rabin test. The seven witnesses found by Jim Sinclair make the test
+ *           deterministic for all 64-bit numbers. Arithmetic modulo n is done in Montgomery form,
+ *           which replaces division by multiplication, and numbers are tested in batches, one
+ *           array element per number, so that the multiplications of different numbers can
+ *           overlap. The engine is checked by counting the primes up to 100,000 and testing known
+ *           strong pseudoprimes.
+ *
+ *           \par Verification:
+ *           The total count is checked by the master. If N is a power of ten, the count must equal
+ *           the known value of the prime-counting function pi(N); otherwise, it must lie between
+ *           the bounds proven by Dusart. Counts below 599 are checked directly. The time spent
+ *           verifying is displayed separately.
+ *
+ *           \par References:
+ *           \arg <A HREF="http://www.troubleshooters.com/codecorn/primenumbers/primenumbers.htm">Fun With Prime Numbers</A>
+ *           \arg <A HREF="http://oeis.org/A006880">Number of primes less than 10^n</A>
+ *           \arg <A HREF="http://www.ams.org/journals/mcom/1985-44-170/S0025-5718-1985-0777285-5/">Computing pi(x): The Meissel-Lehmer Method</A>
+ *           \arg <A HREF="http://miller-rabin.appspot.com/">Deterministic variants of the Miller-Rabin primality test</A>
  *
  */
 
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <mpi.h>
 
@@ -33,9 +81,253 @@
 #define MASTER      0
 #define TRUE        1
 #define FALSE       0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
+/*! Test each number by dividing it by odd numbers */
+#define TRIAL_DIVISION             1
+/*! Count primes with the Lagarias-Miller-Odlyzko method */
+#define LAGARIAS_MILLER_ODLYZKO    2
+/*! Count primes with a bit-packed segmented sieve of Eratosthenes */
+#define SIEVE                      3
+/*! Test random 64-bit numbers with the Miller-Rabin test */
+#define MILLER_RABIN               4
+/*! Number of integers sieved at a time by the Lagarias-Miller-Odlyzko method */
+#define SEGMENT_SIZE           65536
+/*! Number of bytes in a segment of the bit-packed sieve. Each byte holds 16 numbers. */
+#ifndef SIEVE_SEGMENT_BYTES
+#define SIEVE_SEGMENT_BYTES    32768
+#endif
+/*! Number of bytes after which the multiples of 3, 5, 7, 11 and 13 repeat in the bit-packed sieve */
+#define PRESIEVE_BYTES         15015
+/*! Largest prime crossed off by the presieve pattern */
+#define LARGEST_PRESIEVE_PRIME    13
+/*! Number of primes up to \b LARGEST_PRESIEVE_PRIME */
+#define NUMBER_OF_PRESIEVE_PRIMES  6
+/*! Number of numbers tested together by the Miller-Rabin test */
+#ifndef MILLER_RABIN_BATCH
+#define MILLER_RABIN_BATCH         8
+#endif
+/*! Number of witnesses needed to test any 64-bit number */
+#define NUMBER_OF_WITNESSES        7
+/*! Highest number that the Miller-Rabin test counts primes up to when checking itself */
+#define MILLER_RABIN_CHECK    100000
+/*! Number of known primes and composites that the Miller-Rabin test is checked with */
+#define NUMBER_OF_KNOWN_NUMBERS    8
+/*! Number of entries in the table of pi(10^k) */
+#define NUMBER_OF_POWERS_OF_TEN  19
+
+/*! Number of primes less than or equal to 10^k, for k = 0 to 18 */
+static const long PRIMES_BELOW_POWER_OF_TEN[NUMBER_OF_POWERS_OF_TEN] = {
+    0L, 4L, 25L, 168L, 1229L, 9592L, 78498L, 664579L, 5761455L, 50847534L, 455052511L,
+    4118054813L, 37607912018L, 346065536839L, 3204941750802L, 29844570422669L,
+    279238341033925L, 2623557157654233L, 24739954287740860L
+};
+
+/*! Primes that are not counted by the bit-packed sieve */
+static const long PRESIEVE_PRIMES[NUMBER_OF_PRESIEVE_PRIMES] = { 2L, 3L, 5L, 7L, 11L, 13L };
+
+/*! Witnesses that make the Miller-Rabin test deterministic for n < 2^64 */
+static const uint64_t WITNESSES[NUMBER_OF_WITNESSES] = {
+    2ULL, 325ULL, 9375ULL, 28178ULL, 450775ULL, 9780504ULL, 1795265022ULL
+};
+
+/*! Strong pseudoprimes to small bases, which must be found composite, and large primes */
+static const uint64_t KNOWN_NUMBERS[NUMBER_OF_KNOWN_NUMBERS] = {
+    561ULL, 2047ULL, 3215031751ULL, 3825123056546413051ULL,
+    4294967291ULL, 2305843009213693951ULL, 18446744073709551557ULL, 18446744073709551533ULL
+};
+static const unsigned char KNOWN_PRIMALITY[NUMBER_OF_KNOWN_NUMBERS] = { 0, 0, 0, 0, 1, 1, 1, 1 };
+
+/*!
+ *
+ *  \par Description:
+ *  Checks a count of primes against the known value of pi(x) if x is a power of ten, or against the
+ *  bounds x / ln x * (1 + 1 / ln x) <= pi(x) <= x / ln x * (1 + 1.2762 / ln x) otherwise. Counts
+ *  below 599, where the lower bound does not hold, are checked by trial division.
+ *
+ *  \param maximum Highest number tested for primality
+ *  \param count Number of primes found
+ *  \param expected Set to the known value of pi(x), or -1 if only the bounds were checked
+ *
+ *  \return TRUE if the count is correct or within the bounds, FALSE otherwise
+ *
+ */
+int verify_prime_count(long maximum, long count, long* expected);
+
+/*!
+ *
+ *  \par Description:
+ *  Counts the primes less than or equal to x with the Lagarias-Miller-Odlyzko method. All processes
+ *  must call this function.
+ *
+ *  \param x Highest number to count primes up to
+ *  \param leaves Set to the number of special leaves computed by this process
+ *
+ *  \return pi(x). Only valid on the master.
+ *
+ */
+long count_primes_lmo(long x, long* leaves);
+
+/*!
+ *
+ *  \par Description:
+ *  Counts the primes in a range of odd numbers by dividing each number by odd divisors up to its
+ *  square root.
+ *
+ *  \param minimum Lowest number in range. Must be odd and at least 3.
+ *  \param maximum Highest number in range
+ *
+ *  \return Number of primes found
+ *
+ */
+long count_primes_trial_division(long minimum, long maximum);
+
+/*!
+ *
+ *  \par Description:
+ *  Finds the shortest, longest and mean runtimes of all processes.
+ *
+ *  \param runtimes Runtimes of all processes
+ *  \param count Number of processes
+ *  \param shortest Set to shortest runtime
+ *  \param longest Set to longest runtime
+ *  \param mean Set to mean runtime
+ *
+ */
+void runtime_spread(const double* runtimes, int count, double* shortest, double* longest, double* mean);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the largest integer r such that r^k <= x.
+ *
+ *  \param x Number to take root of
+ *  \param k Degree of root
+ *
+ *  \return Integer k-th root of \b x
+ *
+ */
+long integer_root(long x, int k);
+
+/*!
+ *
+ *  \par Description:
+ *  Finds all primes up to a limit with the sieve of Eratosthenes.
+ *
+ *  \param limit Highest number to sieve
+ *  \param primes Set to an array of the primes, starting at index 1. Must be freed by the caller.
+ *
+ *  \return Number of primes found
+ *
+ */
+long generate_primes(long limit, long** primes);
+
+/*!
+ *
+ *  \par Description:
+ *  Marks the primes in the range [low, high) with a segmented sieve of Eratosthenes.
+ *
+ *  \param sieve Set to 1 at index i if low + i is prime, or 0 otherwise
+ *  \param low Lowest number in range
+ *  \param high One past highest number in range. high - low must not exceed \b SEGMENT_SIZE.
+ *  \param primes Primes up to at least the square root of \b high, starting at index 1
+ *  \param number_of_primes Number of primes in \b primes
+ *
+ */
+void sieve_segment(unsigned char* sieve, long low, long high, const long* primes, long number_of_primes);
+
+/*!
+ *
+ *  \par Description:
+ *  Creates the bit-packed pattern of odd numbers that are not multiples of 3, 5, 7, 11 or 13. Bit
+ *  i of the pattern is set if 2i + 1 is not a multiple of any of those primes.
+ *
+ *  \param pattern Array of \b PRESIEVE_BYTES bytes
+ *
+ */
+void build_presieve_pattern(unsigned char* pattern);
+
+/*!
+ *
+ *  \par Description:
+ *  Counts the odd numbers in the range [low, high) that are not multiples of any odd prime up to
+ *  sqrt(high), other than those primes themselves, with a bit-packed segmented sieve. 1 is counted,
+ *  and the primes up to \b LARGEST_PRESIEVE_PRIME are not.
+ *
+ *  \param low Lowest number in range. Must be a multiple of 16.
+ *  \param high One past highest number in range
+ *  \param primes Primes up to at least the square root of \b high, starting at index 1
+ *  \param number_of_primes Number of primes in \b primes
+ *  \param pattern Pattern created by \b build_presieve_pattern
+ *  \param segment Array of \b SIEVE_SEGMENT_BYTES bytes, aligned to 8 bytes
+ *
+ *  \return Number of bits left set in the range
+ *
+ */
+long count_primes_sieve(long low, long high, const long* primes, long number_of_primes,
+                        const unsigned char* pattern, unsigned char* segment);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns a * b / 2^64 mod n, the product of two numbers in Montgomery form.
+ *
+ *  \param a First factor, less than \b n
+ *  \param b Second factor, less than \b n
+ *  \param n Odd modulus
+ *  \param inverse Inverse of \b n modulo 2^64
+ *
+ *  \return Product in Montgomery form
+ *
+ */
+uint64_t montgomery_multiply(uint64_t a, uint64_t b, uint64_t n, uint64_t inverse);
+
+/*!
+ *
+ *  \par Description:
+ *  Tests up to \b MILLER_RABIN_BATCH numbers for primality with the deterministic Miller-Rabin
+ *  test. The numbers are tested in lockstep so that their multiplications are independent.
+ *
+ *  \param numbers Numbers to test
+ *  \param count Number of numbers to test
+ *  \param is_prime Set to 1 for each number that is prime, or 0 otherwise
+ *
+ */
+void miller_rabin_batch(const uint64_t* numbers, int count, unsigned char* is_prime);
+
+/*!
+ *
+ *  \par Description:
+ *  Checks the Miller-Rabin test by counting the primes up to \b MILLER_RABIN_CHECK and testing
+ *  known primes and strong pseudoprimes.
+ *
+ *  \param expected Set to the known number of primes up to \b MILLER_RABIN_CHECK
+ *
+ *  \return TRUE if all numbers are classified correctly, FALSE otherwise
+ *
+ */
+int verify_miller_rabin(long* expected);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the next number from a SplitMix64 generator, which is used instead of \b rand because
+ *  its numbers are only 31 bits on some systems.
+ *
+ *  \param state State of generator
+ *
+ *  \return Random 64-bit number
+ *
+ */
+uint64_t next_random(uint64_t* state);
 
 /*!
  *  \param argv[1] Highest number to test for primality
+ *  \param argv[2] (Optional) 1 for trial division (default), 2 for Lagarias-Miller-Odlyzko, 3 for sieve or
+ *                 4 for Miller-Rabin, in which case argv[1] is the number of random numbers to test
+ *  \param argv[3] (Optional) Size of blocks assigned cyclically to processes. Trial division only.
  */
 int main(int argc, char** argv) {
 
@@ -76,26 +368,72 @@ int main(int argc, char** argv) {
     /* Used to count all prime numbers found between 0 and N */
     long total_number_of_primes = 0;
 
-    /* Used to test if current number is prime */
-    unsigned char is_prime;
+    /* Known value of pi(MAXIMUM), or -1 if only bounds were checked */
+    long expected;
+    /* Whether the total count passed verification */
+    int verified = TRUE;
+    /* Time it took to verify the total count */
+    double verification_time;
+
+    /* Method used to count primes */
+    unsigned short METHOD = TRIAL_DIVISION;
+    /* Number of primes counted by the Lagarias-Miller-Odlyzko method. Only valid on the master. */
+    long lmo_count = 0;
+    /* Primes up to the square root of N, starting at index 1, used by the sieve */
+    long* sieving_primes = NULL;
+    /* Number of primes in \b sieving_primes */
+    long number_of_sieving_primes;
+    /* Number of 128-number words that the sieve is divided into */
+    long words;
+    /* Multiples of the smallest primes, copied into every segment of the sieve */
+    unsigned char* pattern = NULL;
+    /* Segment of the sieve. Each bit is an odd number. */
+    uint64_t* segment = NULL;
+    /* Random numbers tested together by the Miller-Rabin test */
+    uint64_t candidates[MILLER_RABIN_BATCH];
+    /* Results of the Miller-Rabin test */
+    unsigned char primality[MILLER_RABIN_BATCH];
+    /* State of random number generator */
+    uint64_t random_state;
+    /* Number of primality tests per second for all processes */
+    double test_rate = 0.0;
+    /* Largest runtime of all processes */
+    double longest_runtime = 0.0;
+
+    /* Size of blocks assigned cyclically to processes, or 0 to only use contiguous ranges */
+    long BLOCK_SIZE = 0;
+    /* Current block assigned to this process */
+    long block;
+    /* Number of primes found by all processes with contiguous ranges. Only valid on the master. */
+    long contiguous_count = 0;
+    /* Number of primes found by this process with its contiguous range */
+    long contiguous_primes = 0;
+    /* Runtime of this process with its contiguous range */
+    double contiguous_runtime = 0.0;
+    /* Runtimes of all processes with contiguous ranges */
+    double* contiguous_runtimes = NULL;
+    /* Shortest, longest and mean runtimes of all processes, for contiguous ranges and cyclic blocks */
+    double shortest[2], longest[2], mean[2];
 
     /* Used to start timing program execution */
     time_t program_start;
     /* Used to end timing program execution */
     time_t program_end;
     /* Used to start timing search for prime numbers for one process */
-    time_t start;
+    double start;
     /* Used to end timing search for prime numbers for one process */
-    time_t end;
+    double end;
 
     /* Used in MPI_Recv */
     MPI_Status status;
 
     /***************************************************************************************************/
 
-    if (argc != 2) {
+    if (argc < 2 || argc > 4) {
        printf("Usage: ./prime ");
-       printf("[highest number to test for primality]\n");
+       printf("[highest number to test for primality] ");
+       printf("[(optional) 1 = trial division, 2 = Lagarias-Miller-Odlyzko, 3 = sieve, 4 = Miller-Rabin] ");
+       printf("[(optional) size of blocks assigned cyclically to processes]\n");
        printf("Please try again.\n");
        exit(1);
     }
@@ -105,6 +443,16 @@ int main(int argc, char** argv) {
        exit(1);
     }
 
+    if (argc > 2 && ((METHOD = atoi(argv[2])) < TRIAL_DIVISION || METHOD > MILLER_RABIN)) {
+       printf("Error: Invalid argument for method of counting primes. Please try again.\n");
+       exit(1);
+    }
+
+    if (argc > 3 && ((BLOCK_SIZE = atol(argv[3])) <= 0 || METHOD != TRIAL_DIVISION)) {
+       printf("Error: Invalid argument for block size, which is only used by trial division. Please try again.\n");
+       exit(1);
+    }
+
     /***************************************************************************************************/
 
     error_code = MPI_Init(&argc, &argv);
@@ -143,43 +491,129 @@ int main(int argc, char** argv) {
     ** Divide number of iterations into ranges for each process and then start finding prime numbers   **
     ****************************************************************************************************/
     program_start = time(NULL);
-    range_size = MAXIMUM / NUMBER_OF_PROCESSES;
-    remainder = MAXIMUM % NUMBER_OF_PROCESSES;
 
-    if (PROCESS_ID == MASTER) {
-       total_number_of_primes = 1;
-       minimum = 3;
-       maximum = range_size;
+    if (METHOD == LAGARIAS_MILLER_ODLYZKO) {
+       start = MPI_Wtime();
+       lmo_count = count_primes_lmo(MAXIMUM, &total_number_of_primes);
+       end = MPI_Wtime();
     }
-    else {
-       minimum = range_size * PROCESS_ID + 1;
-       if (minimum % 2 == 0) {
-          minimum++;
+    else if (METHOD == SIEVE) {
+       pattern = (unsigned char*) calloc(PRESIEVE_BYTES, sizeof(unsigned char));
+       segment = (uint64_t*) calloc(SIEVE_SEGMENT_BYTES / sizeof(uint64_t), sizeof(uint64_t));
+
+       if (pattern == NULL || segment == NULL) {
+          printf("Memory allocation failure for sieve arrays!");
+          printf("Unable to allocate memory on process %d.\n", PROCESS_ID);
+          printf("Aborting...\n");
+          MPI_Abort(MPI_COMM_WORLD, 1);
+       }
+
+       start = MPI_Wtime();
+       build_presieve_pattern(pattern);
+       number_of_sieving_primes = generate_primes(integer_root(MAXIMUM, 2), &sieving_primes);
+
+       /***** Ranges start at multiples of 128 so that every process counts whole 64-bit words *****/
+       words = MAXIMUM / 128 + 1;
+       minimum = 128 * (words * PROCESS_ID / NUMBER_OF_PROCESSES);
+       maximum = 128 * (words * (PROCESS_ID + 1) / NUMBER_OF_PROCESSES);
+       if (maximum > MAXIMUM + 1) {
+          maximum = MAXIMUM + 1;
        }
-       maximum = range_size * (PROCESS_ID + 1);
+
+       total_number_of_primes = count_primes_sieve(minimum, maximum, sieving_primes, number_of_sieving_primes,
+                                                    pattern, (unsigned char*) segment);
+
+       /***** 1 is not prime, but 2 and the primes in the pattern are *****/
+       if (PROCESS_ID == MASTER) {
+          total_number_of_primes -= 1;
+          for (source = 0; source < NUMBER_OF_PRESIEVE_PRIMES && PRESIEVE_PRIMES[source] <= MAXIMUM; source++) {
+              total_number_of_primes++;
+          }
+       }
+       end = MPI_Wtime();
+
+       free(sieving_primes);
+       free(segment);
+       free(pattern);
+    }
+    else if (METHOD == MILLER_RABIN) {
+       range_size = MAXIMUM / NUMBER_OF_PROCESSES;
        if (PROCESS_ID == NUMBER_OF_PROCESSES - 1) {
-          maximum += remainder;
+          range_size += MAXIMUM % NUMBER_OF_PROCESSES;
+       }
+       random_state = (uint64_t) time(NULL) * 0x9e3779b97f4a7c15ULL + (uint64_t) PROCESS_ID;
+
+       start = MPI_Wtime();
+       for (minimum = 0; minimum < range_size; minimum += MILLER_RABIN_BATCH) {
+           maximum = (range_size - minimum < MILLER_RABIN_BATCH) ? range_size - minimum : MILLER_RABIN_BATCH;
+           for (divisor = 0; divisor < maximum; divisor++) {
+               candidates[divisor] = next_random(&random_state) | 1;
+           }
+           miller_rabin_batch(candidates, (int) maximum, primality);
+           for (divisor = 0; divisor < maximum; divisor++) {
+               total_number_of_primes += primality[divisor];
+           }
        }
+       end = MPI_Wtime();
     }
+    else {
+       range_size = MAXIMUM / NUMBER_OF_PROCESSES;
+       remainder = MAXIMUM % NUMBER_OF_PROCESSES;
 
-    /* TODO: Algorithm is inefficient and needs improvement. Runtime is O(n^2). */
-    start = time(NULL);
-    while (minimum <= maximum) {
-          for (divisor = 3, is_prime = TRUE; divisor * divisor <= minimum && is_prime == TRUE; divisor += 2) {
-              if (minimum % divisor == 0) {
-                 is_prime = FALSE;
-              }
+       if (PROCESS_ID == MASTER) {
+          total_number_of_primes = (MAXIMUM >= 2) ? 1 : 0;
+          minimum = 3;
+          maximum = range_size;
+       }
+       else {
+          minimum = range_size * PROCESS_ID + 1;
+          if (minimum % 2 == 0) {
+             minimum++;
           }
-
-          if (is_prime) {
-             total_number_of_primes++;
+          /***** Range may start at 1 if there are more processes than numbers *****/
+          if (minimum < 3) {
+             minimum = 3;
           }
+          maximum = range_size * (PROCESS_ID + 1);
+          if (PROCESS_ID == NUMBER_OF_PROCESSES - 1) {
+             maximum += remainder;
+          }
+       }
+
+       start = MPI_Wtime();
+       total_number_of_primes += count_primes_trial_division(minimum, maximum);
+       end = MPI_Wtime();
+
+       /****************************************************************************************************
+       ** Test the same numbers again, assigning blocks to processes in turn                              **
+       ****************************************************************************************************/
+       if (BLOCK_SIZE > 0) {
+          contiguous_primes = total_number_of_primes;
+          contiguous_runtime = end - start;
+          total_number_of_primes = (PROCESS_ID == MASTER && MAXIMUM >= 2) ? 1 : 0;
 
-          minimum += 2;
+          MPI_Barrier(MPI_COMM_WORLD);
+
+          start = MPI_Wtime();
+          for (block = PROCESS_ID; block < (MAXIMUM + BLOCK_SIZE - 1) / BLOCK_SIZE; block += NUMBER_OF_PROCESSES) {
+              minimum = block * BLOCK_SIZE + 1;
+              if (minimum % 2 == 0) {
+                 minimum++;
+              }
+              if (minimum < 3) {
+                 minimum = 3;
+              }
+              maximum = (block + 1) * BLOCK_SIZE;
+              if (maximum > MAXIMUM) {
+                 maximum = MAXIMUM;
+              }
+              total_number_of_primes += count_primes_trial_division(minimum, maximum);
+          }
+          end = MPI_Wtime();
+       }
     }
-    end = time(NULL);
 
-    runtime = difftime(end, start);
+    runtime = end - start;
 
     /****************************************************************************************************
     ** Send runtimes and number of primes found to Master                                              **
@@ -197,6 +631,20 @@ int main(int argc, char** argv) {
        MPI_Send(&runtime, 1, MPI_DOUBLE, MASTER, RUNTIME_TAG, MPI_COMM_WORLD);
     }
 
+    if (BLOCK_SIZE > 0) {
+       if (PROCESS_ID == MASTER) {
+          contiguous_runtimes = (double*) calloc(NUMBER_OF_PROCESSES, sizeof(double));
+          if (contiguous_runtimes == NULL) {
+             printf("Memory allocation failure for contiguous_runtimes array!");
+             printf("Unable to allocate memory on process %d.\n", PROCESS_ID);
+             printf("Aborting...\n");
+             MPI_Abort(MPI_COMM_WORLD, 1);
+          }
+       }
+       MPI_Gather(&contiguous_runtime, 1, MPI_DOUBLE, contiguous_runtimes, 1, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+       MPI_Reduce(&contiguous_primes, &contiguous_count, 1, MPI_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
+    }
+
     MPI_Barrier(MPI_COMM_WORLD);
     program_end = time(NULL);
 
@@ -205,31 +653,723 @@ int main(int argc, char** argv) {
     ****************************************************************************************************/
     if (PROCESS_ID == MASTER) {
        printf("\n");
-       printf("This program found prime numbers up to %lu.\nThe results are displayed below.\n", MAXIMUM);
+       if (METHOD == MILLER_RABIN) {
+          printf("This program tested %lu random 64-bit numbers for primality.\nThe results are displayed below.\n", MAXIMUM);
+       }
+       else {
+          printf("This program found prime numbers up to %lu.\nThe results are displayed below.\n", MAXIMUM);
+       }
        printf("\n");
-       printf("Process          Total found          Runtime (seconds)\n");
-       printf("-------          -----------          -----------------\n\n");
+       if (METHOD == LAGARIAS_MILLER_ODLYZKO) {
+          printf("Process       Special leaves          Runtime (seconds)\n");
+          printf("-------       --------------          -----------------\n\n");
+       }
+       else {
+          printf("Process          Total found          Runtime (seconds)\n");
+          printf("-------          -----------          -----------------\n\n");
+       }
        total_number_of_primes = 0;
        for (source = 0; source < NUMBER_OF_PROCESSES; source++) {
-           printf("%7d          %11lu          %17.2f\n", source, number_of_primes[source], runtimes[source]);
+           printf("%7d       %14lu          %17.4f\n", source, number_of_primes[source], runtimes[source]);
            total_number_of_primes += number_of_primes[source];
+           if (runtimes[source] > longest_runtime) {
+              longest_runtime = runtimes[source];
+           }
+       }
+       if (METHOD == LAGARIAS_MILLER_ODLYZKO) {
+          total_number_of_primes = lmo_count;
        }
        printf("\n");
        printf("======================================================================\n");
        printf("== Summary                                                          ==\n");
        printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
        printf("Total number of processes:           %10d\n\n", NUMBER_OF_PROCESSES);
+       printf("Method used for counting primes: ");
+       switch (METHOD) {
+              case TRIAL_DIVISION:         printf("      Trial division\n\n"); break;
+              case LAGARIAS_MILLER_ODLYZKO: printf("             LMO\n\n"); break;
+              case SIEVE:                  printf("               Sieve\n\n"); break;
+              case MILLER_RABIN:           printf("        Miller-Rabin\n\n"); break;
+       }
        printf("Prime numbers found: %26lu\n\n", total_number_of_primes);
+       if (METHOD == MILLER_RABIN) {
+          for (source = 0; source < NUMBER_OF_PROCESSES; source++) {
+              if (runtimes[source] > 0.0) {
+                 test_rate += (MAXIMUM / NUMBER_OF_PROCESSES +
+                               (source == NUMBER_OF_PROCESSES - 1 ? MAXIMUM % NUMBER_OF_PROCESSES : 0)) / runtimes[source];
+              }
+          }
+          printf("Tests per second per process:       %14.4e\n", test_rate / NUMBER_OF_PROCESSES);
+          printf("Tests per second, all processes:    %14.4e\n\n", longest_runtime > 0.0 ? MAXIMUM / longest_runtime : 0.0);
+       }
        printf("Total runtime:                          %10.2f seconds\n\n", difftime(program_end, program_start));
+
+       if (BLOCK_SIZE > 0) {
+          runtime_spread(contiguous_runtimes, NUMBER_OF_PROCESSES, &shortest[0], &longest[0], &mean[0]);
+          runtime_spread(runtimes, NUMBER_OF_PROCESSES, &shortest[1], &longest[1], &mean[1]);
+          printf("======================================================================\n");
+          printf("== Load balance                                                     ==\n");
+          printf("======================================================================\n\n");
+          printf("Block size:                          %10lu\n\n", BLOCK_SIZE);
+          printf("                                 Contiguous        Cyclic\n");
+          printf("                                 ----------        ------\n");
+          printf("Shortest runtime (seconds): %15.4f %13.4f\n", shortest[0], shortest[1]);
+          printf("Longest runtime (seconds):  %15.4f %13.4f\n", longest[0], longest[1]);
+          printf("Spread (seconds):           %15.4f %13.4f\n", longest[0] - shortest[0], longest[1] - shortest[1]);
+          printf("Longest / mean runtime:     %15.4f %13.4f\n\n",
+                 mean[0] > 0.0 ? longest[0] / mean[0] : 1.0, mean[1] > 0.0 ? longest[1] / mean[1] : 1.0);
+       }
+
+       verification_time = MPI_Wtime();
+       if (METHOD == MILLER_RABIN) {
+          verified = verify_miller_rabin(&expected);
+       }
+       else {
+          verified = verify_prime_count(MAXIMUM, total_number_of_primes, &expected);
+          /***** Both divisions must find the same primes *****/
+          if (BLOCK_SIZE > 0 && contiguous_count != total_number_of_primes) {
+             verified = FALSE;
+          }
+       }
+       verification_time = MPI_Wtime() - verification_time;
+
+       printf("Verification: %33s\n", verified ? "PASSED" : "FAILED");
+       if (METHOD == MILLER_RABIN) {
+          printf("   Known number of primes up to %d: %8lu\n", MILLER_RABIN_CHECK, expected);
+          printf("   Known primes and pseudoprimes: %14d\n", NUMBER_OF_KNOWN_NUMBERS);
+       }
+       else if (expected >= 0) {
+          printf("   Known number of primes: %20lu\n", expected);
+       }
+       else {
+          printf("   Checked against:               Dusart bounds\n");
+       }
+       printf("   Verification time:                %12.6f seconds\n\n", verification_time);
     }
 
     /***************************************************************************************************/
 
+    free(contiguous_runtimes);
     free(number_of_primes);
     free(runtimes);
 
     MPI_Finalize();
 
-    return 0;
+    /***** Nonzero exit status lets scripts catch wrong counts *****/
+    return verified ? 0 : 1;
+
+}
+
+int verify_prime_count(long maximum, long count, long* expected) {
+
+    int k;
+    long power_of_ten;
+    double logarithm;
+
+    *expected = -1;
+    for (k = 0, power_of_ten = 1; k < NUMBER_OF_POWERS_OF_TEN; k++, power_of_ten *= 10) {
+        if (power_of_ten == maximum) {
+           *expected = PRIMES_BELOW_POWER_OF_TEN[k];
+           return count == *expected;
+        }
+        if (power_of_ten > maximum / 10) {
+           break;
+        }
+    }
+
+    /***** Lower bound only holds for x >= 599, so count small ranges directly *****/
+    if (maximum < 599) {
+       long number, divisor;
+       *expected = 0;
+       for (number = 2; number <= maximum; number++) {
+           for (divisor = 2; divisor * divisor <= number && number % divisor != 0; divisor++);
+           if (divisor * divisor > number) {
+              (*expected)++;
+           }
+       }
+       return count == *expected;
+    }
+
+    logarithm = log((double) maximum);
+    return count >= (long) floor(maximum / logarithm * (1.0 + 1.0 / logarithm)) &&
+           count <= (long) ceil(maximum / logarithm * (1.0 + 1.2762 / logarithm));
+
+}
+
+long count_primes_trial_division(long minimum, long maximum) {
+
+     long divisor, count = 0;
+     unsigned char is_prime;
+
+     /* TODO: Algorithm is inefficient and needs improvement. Runtime is O(n^2). */
+     while (minimum <= maximum) {
+           for (divisor = 3, is_prime = TRUE; divisor * divisor <= minimum && is_prime == TRUE; divisor += 2) {
+               if (minimum % divisor == 0) {
+                  is_prime = FALSE;
+               }
+           }
+
+           if (is_prime) {
+              count++;
+           }
+
+           minimum += 2;
+     }
+
+     return count;
+
+}
+
+void runtime_spread(const double* runtimes, int count, double* shortest, double* longest, double* mean) {
+
+     int i;
+
+     *shortest = *longest = *mean = runtimes[0];
+     for (i = 1; i < count; i++) {
+         *shortest = (runtimes[i] < *shortest) ? runtimes[i] : *shortest;
+         *longest = (runtimes[i] > *longest) ? runtimes[i] : *longest;
+         *mean += runtimes[i];
+     }
+     *mean /= count;
+
+}
+
+long count_primes_lmo(long x, long* leaves) {
+
+     int number_of_processes, process_id;
+
+     long i, b, m, j;
+     long y;              /* primes up to y are sieved out by phi */
+     long pi_y;           /* number of primes up to y */
+     long sqrt_x;
+     long limit;          /* sieved numbers are less than limit = x / y + 1 */
+     long lo, hi;         /* range of sieved numbers for this process */
+     long low, high;      /* current segment */
+     long prime, min_m, max_m, index, count, segment_count;
+     long p_low, p_high;  /* range of primes p in (y, sqrt(x)] with x / p in [lo, hi) */
+     long number_of_p2_primes = 0, capacity = 0, next;
+
+     /* Partial sums reduced to master: S1, S2, sum of pi(x / p) and number of primes p for P2 */
+     long sums[4] = {0L, 0L, 0L, 0L};
+     long totals[4] = {0L, 0L, 0L, 0L};
+     long sieve_primes = 0, primes_before = 0;
+
+     long* primes = NULL;
+     long* phi = NULL;     /* numbers left in [lo, low) after sieving out first b - 1 primes */
+     long* signs = NULL;   /* sum of mu(m) over special leaves of prime b */
+     long* before = NULL;  /* numbers left in [1, lo) after sieving out first b - 1 primes */
+     long* p2_primes = NULL;
+
+     int* lpf = NULL;      /* least prime factor */
+     int* tree = NULL;     /* binary indexed tree of numbers left in segment */
+     signed char* mu = NULL;
+     unsigned char* sieve = NULL;
+
+     MPI_Comm_size(MPI_COMM_WORLD, &number_of_processes);
+     MPI_Comm_rank(MPI_COMM_WORLD, &process_id);
+
+     /***** Larger y means fewer numbers to sieve but more special leaves; alpha = ln(x) / 8 balances them *****/
+     sqrt_x = integer_root(x, 2);
+     y = (long) ((log((double) x) > 8.0 ? log((double) x) / 8.0 : 1.0) * integer_root(x, 3));
+     if (y > sqrt_x) {
+        y = sqrt_x;
+     }
+     limit = x / y + 1;
+
+     pi_y = generate_primes(y, &primes);
+
+     phi = (long*) calloc(pi_y + 1, sizeof(long));
+     signs = (long*) calloc(pi_y + 1, sizeof(long));
+     before = (long*) calloc(pi_y + 1, sizeof(long));
+     lpf = (int*) calloc(y + 1, sizeof(int));
+     mu = (signed char*) calloc(y + 1, sizeof(signed char));
+     tree = (int*) calloc(SEGMENT_SIZE, sizeof(int));
+     sieve = (unsigned char*) calloc(SEGMENT_SIZE, sizeof(unsigned char));
+
+     if (primes == NULL || phi == NULL || signs == NULL || before == NULL || lpf == NULL || mu == NULL ||
+         tree == NULL || sieve == NULL) {
+        printf("Memory allocation failure for Lagarias-Miller-Odlyzko arrays! ");
+        printf("Unable to allocate memory on process %d.\nAborting...\n", process_id);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+     }
+
+     /****************************************************************************************************
+     ** Least prime factors and Moebius function up to y                                                **
+     ****************************************************************************************************/
+     for (i = 2; i <= y; i++) {
+         if (lpf[i] == 0) {
+            for (j = i; j <= y; j += i) {
+                if (lpf[j] == 0) {
+                   lpf[j] = (int) i;
+                }
+            }
+         }
+     }
+     lpf[1] = INT_MAX;
+     mu[1] = 1;
+     for (i = 2; i <= y; i++) {
+         m = i / lpf[i];
+         mu[i] = (m % lpf[i] == 0) ? 0 : -mu[m];
+     }
+
+     /****************************************************************************************************
+     ** Ordinary leaves: S1 = Sum[ mu(n) * floor(x / n) ] for n <= y                                    **
+     ****************************************************************************************************/
+     if (process_id == MASTER) {
+        for (i = 1; i <= y; i++) {
+            sums[0] += mu[i] * (x / i);
+        }
+     }
+
+     lo = 1 + (limit - 1) / number_of_processes * process_id + ((limit - 1) % number_of_processes < process_id ?
+          (limit - 1) % number_of_processes : process_id);
+     hi = lo + (limit - 1) / number_of_processes + (process_id < (limit - 1) % number_of_processes);
+
+     /****************************************************************************************************
+     ** Special leaves: S2 = -Sum[ mu(m) * phi(x / (p_b * m), b - 1) ] for y / p_b < m <= y and         **
+     ** lpf(m) > p_b                                                                                    **
+     ****************************************************************************************************/
+     *leaves = 0;
+     for (low = lo; low < hi; low += SEGMENT_SIZE) {
+         high = (low + SEGMENT_SIZE < hi) ? low + SEGMENT_SIZE : hi;
+
+         for (i = 0; i < high - low; i++) {
+             tree[i] = 1;
+         }
+         for (i = 0; i < high - low; i++) {
+             sieve[i] = 1;
+             j = i | (i + 1);
+             if (j < high - low) {
+                tree[j] += tree[i];
+             }
+         }
+         segment_count = high - low;
+
+         for (b = 1; b < pi_y; b++) {
+             prime = primes[b];
+             min_m = (x / (prime * high) > y / prime) ? x / (prime * high) : y / prime;
+             max_m = (x / (prime * low) < y) ? x / (prime * low) : y;
+
+             /***** No more leaves in this segment or in any later one for larger primes *****/
+             if (prime >= max_m) {
+                break;
+             }
+
+             for (m = max_m; m > min_m; m--) {
+                 if (mu[m] != 0 && prime < lpf[m]) {
+                    for (count = 0, index = x / (prime * m) - low; index >= 0; index = (index & (index + 1)) - 1) {
+                        count += tree[index];
+                    }
+                    sums[1] -= mu[m] * (phi[b] + count);
+                    signs[b] += mu[m];
+                    (*leaves)++;
+                 }
+             }
+
+             phi[b] += segment_count;
+
+             /***** Cross off multiples of prime, updating the tree *****/
+             for (i = ((low + prime - 1) / prime) * prime - low; i < high - low; i += prime) {
+                 if (sieve[i]) {
+                    sieve[i] = 0;
+                    segment_count--;
+                    for (index = i; index < high - low; index |= index + 1) {
+                        tree[index]--;
+                    }
+                 }
+             }
+         }
+     }
+
+     /***** Add counts of numbers below this range *****/
+     MPI_Exscan(phi, before, pi_y + 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+     if (process_id != MASTER) {
+        for (b = 1; b < pi_y; b++) {
+            sums[1] -= signs[b] * before[b];
+        }
+     }
+
+     /****************************************************************************************************
+     ** P2 = Sum[ pi(x / p) - pi(p) + 1 ] for primes y < p <= sqrt(x), with x / p in [lo, hi)           **
+     ****************************************************************************************************/
+     p_low = ((x / hi > y) ? x / hi : y) + 1;
+     p_high = (x / lo < sqrt_x) ? x / lo : sqrt_x;
+     for (low = p_low; low <= p_high; low += SEGMENT_SIZE) {
+         high = (low + SEGMENT_SIZE <= p_high + 1) ? low + SEGMENT_SIZE : p_high + 1;
+         sieve_segment(sieve, low, high, primes, pi_y);
+         for (i = 0; i < high - low; i++) {
+             if (sieve[i]) {
+                if (number_of_p2_primes == capacity) {
+                   capacity = (capacity == 0) ? 1024 : 2 * capacity;
+                   p2_primes = (long*) realloc(p2_primes, capacity * sizeof(long));
+                   if (p2_primes == NULL) {
+                      printf("Memory allocation failure for P2 primes array! ");
+                      printf("Unable to allocate memory on process %d.\nAborting...\n", process_id);
+                      MPI_Abort(MPI_COMM_WORLD, 1);
+                   }
+                }
+                p2_primes[number_of_p2_primes++] = low + i;
+            }
+         }
+     }
+
+     /***** Largest p gives smallest x / p, so walk primes backwards while sieving [lo, hi) forwards *****/
+     next = number_of_p2_primes - 1;
+     for (low = lo; low < hi; low += SEGMENT_SIZE) {
+         high = (low + SEGMENT_SIZE < hi) ? low + SEGMENT_SIZE : hi;
+         sieve_segment(sieve, low, high, primes, pi_y);
+         for (i = 0; i < high - low; i++) {
+             sieve_primes += sieve[i];
+             while (next >= 0 && x / p2_primes[next] == low + i) {
+                   sums[2] += sieve_primes;
+                   next--;
+             }
+         }
+     }
+     sums[3] = number_of_p2_primes;
+
+     MPI_Exscan(&sieve_primes, &primes_before, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+     if (process_id != MASTER) {
+        sums[2] += number_of_p2_primes * primes_before;
+     }
+
+     MPI_Reduce(sums, totals, 4, MPI_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
+
+     free(p2_primes);
+     free(sieve);
+     free(tree);
+     free(mu);
+     free(lpf);
+     free(before);
+     free(signs);
+     free(phi);
+     free(primes);
+
+     /***** pi(x) = S1 + S2 + a - 1 - P2, where Sum[ pi(p) - 1 ] = Sum[ b - 1 ] for b = a + 1 to a + count *****/
+     return totals[0] + totals[1] + pi_y - 1 -
+            (totals[2] - ((pi_y + totals[3]) * (pi_y + totals[3] - 1) - pi_y * (pi_y - 1)) / 2);
+
+}
+
+long integer_root(long x, int k) {
+
+     long root = (long) pow((double) x, 1.0 / k);
+     long power;
+     int i;
+
+     /***** Correct rounding errors from pow *****/
+     for (;;) {
+         for (i = 0, power = 1; i < k && power <= x / (root + 1); i++) {
+             power *= root + 1;
+         }
+         if (i < k) {
+            break;
+         }
+         root++;
+     }
+     for (;;) {
+         for (i = 0, power = 1; i < k && power <= x / root; i++) {
+             power *= root;
+         }
+         if (i == k) {
+            break;
+         }
+         root--;
+     }
+
+     return root;
+
+}
+
+long generate_primes(long limit, long** primes) {
+
+     long i, j, count = 0;
+     unsigned char* composite = (unsigned char*) calloc(limit + 1, sizeof(unsigned char));
+
+     *primes = NULL;
+     if (composite == NULL) {
+        return 0;
+     }
+
+     for (i = 2; i <= limit; i++) {
+         if (!composite[i]) {
+            count++;
+            for (j = i * i; j <= limit; j += i) {
+                composite[j] = 1;
+            }
+         }
+     }
+
+     *primes = (long*) calloc(count + 1, sizeof(long));
+     if (*primes == NULL) {
+        free(composite);
+        return 0;
+     }
+
+     for (i = 2, count = 0; i <= limit; i++) {
+         if (!composite[i]) {
+            (*primes)[++count] = i;
+         }
+     }
+
+     free(composite);
+
+     return count;
+
+}
+
+void sieve_segment(unsigned char* sieve, long low, long high, const long* primes, long number_of_primes) {
+
+     long i, b, prime;
+
+     for (i = 0; i < high - low; i++) {
+         sieve[i] = (low + i >= 2);
+     }
+
+     for (b = 1; b <= number_of_primes && primes[b] * primes[b] < high; b++) {
+         prime = primes[b];
+         i = (low + prime - 1) / prime * prime;
+         if (i < prime * prime) {
+            i = prime * prime;
+         }
+         for (i -= low; i < high - low; i += prime) {
+             sieve[i] = 0;
+         }
+     }
+
+}
+
+void build_presieve_pattern(unsigned char* pattern) {
+
+     long i;
+
+     memset(pattern, 0, PRESIEVE_BYTES);
+     for (i = 0; i < 8 * PRESIEVE_BYTES; i++) {
+         if ((2 * i + 1) % 3 != 0 && (2 * i + 1) % 5 != 0 && (2 * i + 1) % 7 != 0 &&
+             (2 * i + 1) % 11 != 0 && (2 * i + 1) % 13 != 0) {
+            pattern[i >> 3] |= (unsigned char) (1 << (i & 7));
+         }
+     }
+
+}
+
+long count_primes_sieve(long low, long high, const long* primes, long number_of_primes,
+                        const unsigned char* pattern, unsigned char* segment) {
+
+     long b, i, prime, multiple, bits, bytes, offset, copied, count = 0;
+     long segment_low, segment_high;
+     uint64_t word;
+
+     for (segment_low = low; segment_low < high; segment_low += 16 * SIEVE_SEGMENT_BYTES) {
+         segment_high = (segment_low + 16 * SIEVE_SEGMENT_BYTES < high) ? segment_low + 16 * SIEVE_SEGMENT_BYTES : high;
+
+         /***** Bit i is the number segment_low + 2i + 1 *****/
+         bits = (segment_high - segment_low) / 2;
+         bytes = (bits + 7) / 8;
+
+         /***** Copy multiples of 3, 5, 7, 11 and 13 from the pattern *****/
+         offset = (segment_low / 16) % PRESIEVE_BYTES;
+         for (copied = 0; copied < bytes; copied += i, offset = 0) {
+             i = (bytes - copied < PRESIEVE_BYTES - offset) ? bytes - copied : PRESIEVE_BYTES - offset;
+             memcpy(segment + copied, pattern + offset, i);
+         }
+
+         /***** Cross off odd multiples of the remaining primes, starting at their squares *****/
+         for (b = 1; b <= number_of_primes && primes[b] * primes[b] < segment_high; b++) {
+             prime = primes[b];
+             if (prime <= LARGEST_PRESIEVE_PRIME) {
+                continue;
+             }
+             multiple = (segment_low + prime - 1) / prime * prime;
+             if (multiple < prime * prime) {
+                multiple = prime * prime;
+             }
+             if (multiple % 2 == 0) {
+                multiple += prime;
+             }
+             for (i = (multiple - segment_low) / 2; i < bits; i += prime) {
+                 segment[i >> 3] &= (unsigned char) ~(1 << (i & 7));
+             }
+         }
+
+         /***** Clear bits past the end of the range and pad to a whole word *****/
+         if (bits & 7) {
+            segment[bytes - 1] &= (unsigned char) ((1 << (bits & 7)) - 1);
+         }
+         for (i = bytes; i % sizeof(uint64_t) != 0; i++) {
+             segment[i] = 0;
+         }
+
+         for (i = 0; i < bytes; i += sizeof(uint64_t)) {
+             memcpy(&word, segment + i, sizeof(uint64_t));
+             count += __builtin_popcountll(word);
+         }
+     }
+
+     return count;
+
+}
+
+uint64_t montgomery_multiply(uint64_t a, uint64_t b, uint64_t n, uint64_t inverse) {
+
+     unsigned __int128 product = (unsigned __int128) a * b;
+     /* m * n has the same low 64 bits as the product, so subtracting it leaves a multiple of 2^64 */
+     uint64_t m = (uint64_t) product * inverse;
+     uint64_t high = (uint64_t) (product >> 64);
+     uint64_t mn_high = (uint64_t) (((unsigned __int128) m * n) >> 64);
+
+     return (high >= mn_high) ? high - mn_high : high - mn_high + n;
+
+}
+
+void miller_rabin_batch(const uint64_t* numbers, int count, unsigned char* is_prime) {
+
+     int lane, witness, bit, bits, round, rounds;
+
+     /***** One array element per number so that each loop over lanes has independent multiplications *****/
+     uint64_t n[MILLER_RABIN_BATCH];
+     uint64_t inverse[MILLER_RABIN_BATCH];    /* n^-1 mod 2^64 */
+     uint64_t one[MILLER_RABIN_BATCH];        /* 1 in Montgomery form, 2^64 mod n */
+     uint64_t minus_one[MILLER_RABIN_BATCH];  /* n - 1 in Montgomery form */
+     uint64_t square[MILLER_RABIN_BATCH];     /* 2^128 mod n, used to convert to Montgomery form */
+     uint64_t d[MILLER_RABIN_BATCH];          /* n - 1 = d * 2^s with d odd */
+     uint64_t x[MILLER_RABIN_BATCH];
+     uint64_t power[MILLER_RABIN_BATCH];
+     uint64_t largest_d, product, a;
+
+     int s[MILLER_RABIN_BATCH];
+     unsigned char tested[MILLER_RABIN_BATCH];   /* whether number is odd and greater than 1 */
+     unsigned char pending[MILLER_RABIN_BATCH];  /* whether witness has not yet been passed */
+
+     for (lane = 0; lane < MILLER_RABIN_BATCH; lane++) {
+         n[lane] = (lane < count) ? numbers[lane] : 3;
+         tested[lane] = (lane < count) && n[lane] > 2 && (n[lane] & 1);
+         if (!tested[lane]) {
+            if (lane < count) {
+               is_prime[lane] = (n[lane] == 2);
+            }
+            n[lane] = 3;
+         }
+         else {
+            is_prime[lane] = 1;
+         }
+
+         /***** Newton's method doubles the correct bits of the inverse: 3, 6, 12, 24, 48, 96 *****/
+         inverse[lane] = n[lane];
+         for (bit = 0; bit < 5; bit++) {
+             inverse[lane] *= 2 - n[lane] * inverse[lane];
+         }
+         one[lane] = (0 - n[lane]) % n[lane];
+         minus_one[lane] = n[lane] - one[lane];
+         square[lane] = (uint64_t) ((unsigned __int128) one[lane] * one[lane] % n[lane]);
+         d[lane] = n[lane] - 1;
+         s[lane] = __builtin_ctzll(d[lane]);
+         d[lane] >>= s[lane];
+     }
+
+     largest_d = 0;
+     rounds = 0;
+     for (lane = 0; lane < MILLER_RABIN_BATCH; lane++) {
+         largest_d |= d[lane];
+         rounds = (s[lane] > rounds) ? s[lane] : rounds;
+     }
+     bits = 64 - __builtin_clzll(largest_d);
+
+     for (witness = 0; witness < NUMBER_OF_WITNESSES; witness++) {
+
+         for (lane = 0; lane < MILLER_RABIN_BATCH; lane++) {
+             a = WITNESSES[witness] % n[lane];
+             /***** A witness that is a multiple of n says nothing about n *****/
+             pending[lane] = tested[lane] && is_prime[lane] && a != 0;
+             power[lane] = montgomery_multiply(a, square[lane], n[lane], inverse[lane]);
+             x[lane] = one[lane];
+         }
+
+         /***** x = a^d mod n, multiplying every lane even when its bit is 0 so that the loop has no branches *****/
+         for (bit = 0; bit < bits; bit++) {
+             for (lane = 0; lane < MILLER_RABIN_BATCH; lane++) {
+                 product = montgomery_multiply(x[lane], power[lane], n[lane], inverse[lane]);
+                 x[lane] = ((d[lane] >> bit) & 1) ? product : x[lane];
+                 power[lane] = montgomery_multiply(power[lane], power[lane], n[lane], inverse[lane]);
+             }
+         }
+
+         for (lane = 0; lane < MILLER_RABIN_BATCH; lane++) {
+             if (x[lane] == one[lane] || x[lane] == minus_one[lane]) {
+                pending[lane] = 0;
+             }
+         }
+
+         /***** n passes if a^(d * 2^r) = -1 mod n for some r < s *****/
+         for (round = 1; round < rounds; round++) {
+             for (lane = 0; lane < MILLER_RABIN_BATCH; lane++) {
+                 x[lane] = montgomery_multiply(x[lane], x[lane], n[lane], inverse[lane]);
+                 if (round < s[lane] && x[lane] == minus_one[lane]) {
+                    pending[lane] = 0;
+                 }
+             }
+         }
+
+         /***** Most numbers fail the first witness, so stop once every number is composite *****/
+         for (lane = 0, bit = 0; lane < MILLER_RABIN_BATCH; lane++) {
+             if (pending[lane]) {
+                is_prime[lane] = 0;
+             }
+             bit |= tested[lane] && is_prime[lane];
+         }
+         if (!bit) {
+            break;
+         }
+     }
+
+}
+
+int verify_miller_rabin(long* expected) {
+
+     uint64_t numbers[MILLER_RABIN_BATCH];
+     unsigned char is_prime[MILLER_RABIN_BATCH];
+     long count = 0;
+     int i, lane, batch;
+
+     *expected = PRIMES_BELOW_POWER_OF_TEN[5];
+
+     for (i = 0; i <= MILLER_RABIN_CHECK; i += MILLER_RABIN_BATCH) {
+         batch = (MILLER_RABIN_CHECK + 1 - i < MILLER_RABIN_BATCH) ? MILLER_RABIN_CHECK + 1 - i : MILLER_RABIN_BATCH;
+         for (lane = 0; lane < batch; lane++) {
+             numbers[lane] = (uint64_t) (i + lane);
+         }
+         miller_rabin_batch(numbers, batch, is_prime);
+         for (lane = 0; lane < batch; lane++) {
+             count += is_prime[lane];
+         }
+     }
+
+     if (count != *expected) {
+        return FALSE;
+     }
+
+     for (i = 0; i < NUMBER_OF_KNOWN_NUMBERS; i += MILLER_RABIN_BATCH) {
+         batch = (NUMBER_OF_KNOWN_NUMBERS - i < MILLER_RABIN_BATCH) ? NUMBER_OF_KNOWN_NUMBERS - i : MILLER_RABIN_BATCH;
+         miller_rabin_batch(&KNOWN_NUMBERS[i], batch, is_prime);
+         for (lane = 0; lane < batch; lane++) {
+             if (is_prime[lane] != KNOWN_PRIMALITY[i + lane]) {
+                return FALSE;
+             }
+         }
+     }
+
+     return TRUE;
+
+}
+
+uint64_t next_random(uint64_t* state) {
+
+     uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+     z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+     z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+     return z ^ (z >> 31);
 
 }
\ No newline at end of file
@@ -0,0 +1,661 @@
+/*!
+ *
+ *  \file    scan.c
+ *  \brief   Benchmarks prefix sums and reductions on threads, SIMD units and processes
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this program works:
+ *           Each process allocates two arrays of N 64-bit integers with \b page_alloc, so the
+ *           PAGES environment variable selects the pages, and each of its T threads first touches
+ *           its own part of them. The program then runs every kernel R times and keeps the shortest
+ *           time:
+ *           \arg STREAM Copy: every thread copies its part of the input to the output. Like the
+ *                STREAM benchmark, it counts 16 bytes per element, and it is the ceiling for the
+ *                other kernels.
+ *           \arg reduce: sums the input on one thread and on all threads. Every thread sums its
+ *                part with a multiversioned kernel, and the first thread adds up the partial sums.
+ *           \arg scan: computes the inclusive prefix sums of the input into the output on one
+ *                thread, and on all threads in two passes: every thread sums its part, adds up the
+ *                sums of the parts before it, and then scans its part starting from that offset.
+ *                The second pass is run with a scalar loop and, on CPUs with AVX-512, with a
+ *                kernel that scans eight elements at a time in a vector register.
+ *           \arg MPI_Allreduce, MPI_Scan and MPI_Exscan: the arrays of all processes are one
+ *                distributed array. Each process reduces its part on all threads, and combines its
+ *                sum with those of the other processes with MPI_Allreduce, or finds the sum of the
+ *                processes before it with MPI_Scan or MPI_Exscan and scans its part starting from
+ *                that offset.
+ *
+ *           The processes run every kernel at the same time. The program displays the GB/s of all
+ *           processes for each kernel, counting only the bytes that a kernel must read and write
+ *           (8 per element for a reduction and 16 for a scan), and the percentage of STREAM Copy
+ *           that it reaches. The distributed kernels are timed on the slowest process. Every sum
+ *           and every prefix sum is checked, and the program exits with status 1 if one is wrong.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+#include <pthread.h>
+#include "dispatch.h"
+#include "pagealloc.h"
+
+/*! Master process. Usually process 0. */
+#define MASTER                     0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS                "unknown"
+#endif
+/*! Size of a cache line. Data written by different threads is kept on different lines. */
+#define CACHE_LINE_SIZE            64
+
+/*! Copy on all threads, the ceiling for the other kernels */
+#define COPY_KERNEL                0
+/*! Reduction on one thread */
+#define REDUCE_SERIAL              1
+/*! Reduction on all threads */
+#define REDUCE_THREADED            2
+/*! Scan on one thread */
+#define SCAN_SERIAL                3
+/*! Two-pass scan on all threads with a scalar second pass */
+#define SCAN_THREADED              4
+/*! Two-pass scan on all threads with a SIMD second pass */
+#define SCAN_SIMD                  5
+/*! Reduction of the distributed array with MPI_Allreduce */
+#define MPI_REDUCE_KERNEL          6
+/*! Scan of the distributed array with MPI_Scan */
+#define MPI_SCAN_KERNEL            7
+/*! Scan of the distributed array with MPI_Exscan */
+#define MPI_EXSCAN_KERNEL          8
+/*! Number of kernels */
+#define NUMBER_OF_KERNELS          9
+/*! Kernels from this one on work on the distributed array */
+#define FIRST_DISTRIBUTED_KERNEL   MPI_REDUCE_KERNEL
+
+/*! Names of the kernels, in the order of their numbers */
+static const char* const KERNEL_NAMES[] = {
+    "STREAM Copy", "reduce, 1 thread", "reduce", "scan, 1 thread", "scan, two-pass scalar",
+    "scan, two-pass SIMD", "MPI_Allreduce", "MPI_Scan", "MPI_Exscan"
+};
+/*! Bytes that each kernel must read and write per element */
+static const int KERNEL_BYTES[] = { 16, 8, 8, 16, 16, 16, 8, 16, 16 };
+
+/*! Scans elements starting from an offset, and returns the last prefix sum */
+typedef long (*scan_function)(const long* input, long* output, size_t length, long offset);
+
+/*!
+ *  \brief Arrays and results shared by the threads of a process
+ */
+typedef struct scan_context {
+    long* input;
+    long* output;
+    size_t length;
+    /* Index of the first element of this process in the distributed array */
+    size_t first_index;
+    int threads;
+    int repetitions;
+    /* Second pass of the SIMD scan */
+    scan_function simd_scan;
+    pthread_barrier_t barrier;
+    /* Sum of each thread's part, each on its own cache line */
+    long* partial_sums;
+    /* Sum of the elements of the processes before this one */
+    long process_offset;
+    /* Sum that a reduction computed */
+    long total;
+    /* Shortest time of each kernel, and wrong sums and prefix sums */
+    double best[NUMBER_OF_KERNELS];
+    _Atomic long errors;
+} scan_context;
+
+/*!
+ *  \brief Arguments for a thread
+ */
+typedef struct scan_test_a {
+    scan_context* context;
+    /* Number of this thread, from 0 */
+    int thread;
+} scan_test_a;
+
+/***************************************************************************************************/
+
+/*!
+ *
+ *  \par Description:
+ *  Runs every kernel on one thread. Thread 0 is the main thread, which times the kernels and makes
+ *  the MPI calls; the threads wait for each other before and after every kernel.
+ *
+ *  \param scan_test_args Struct that contains the context and the number of the thread
+ *
+ *  \return NULL
+ *
+ */
+void* scan_test(void* scan_test_args);
+
+/*!
+ *
+ *  \par Description:
+ *  Runs one kernel on one thread.
+ *
+ *  \param context Arrays of this process
+ *  \param kernel Kernel to run
+ *  \param thread Number of the thread
+ *  \param first First element of the thread's part
+ *  \param last One past the last element of the thread's part
+ *
+ */
+void run_kernel(scan_context* context, int kernel, int thread, size_t first, size_t last);
+
+/*!
+ *
+ *  \par Description:
+ *  Checks the sum of a reduction, or the prefix sums in a thread's part of the output.
+ *
+ *  \param context Arrays of this process
+ *  \param kernel Kernel that was run last
+ *  \param thread Number of the thread
+ *  \param first First element of the thread's part
+ *  \param last One past the last element of the thread's part
+ *
+ *  \return Number of wrong sums
+ *
+ */
+long verify_kernel(scan_context* context, int kernel, int thread, size_t first, size_t last);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the sum of the elements of the distributed array with indices from 0 up to and
+ *  including the given index. Element i is i % 7 + 1.
+ *
+ *  \param index Index in the distributed array, or -1 for an empty sum
+ *
+ *  \return Prefix sum
+ *
+ */
+long expected_prefix(long index);
+
+/*!
+ *
+ *  \par Description:
+ *  Copies elements.
+ *
+ */
+KERNEL_CLONES void copy_words(const long* input, long* output, size_t length);
+
+/*!
+ *
+ *  \par Description:
+ *  Sums elements.
+ *
+ *  \return Sum
+ *
+ */
+KERNEL_CLONES long reduce_words(const long* input, size_t length);
+
+/*!
+ *
+ *  \par Description:
+ *  Computes the inclusive prefix sums of elements, one element at a time.
+ *
+ *  \param input Elements
+ *  \param output Prefix sums
+ *  \param length Number of elements
+ *  \param offset Sum of the elements before the first one
+ *
+ *  \return Last prefix sum, or offset if there are no elements
+ *
+ */
+long scan_words(const long* input, long* output, size_t length, long offset);
+
+#ifdef DISPATCH
+/*!
+ *
+ *  \par Description:
+ *  Computes the inclusive prefix sums of elements eight at a time. Shifting a vector by one, two
+ *  and four elements and adding it to itself gives the prefix sums within the vector, and the
+ *  last sum is broadcast to every element and carried to the next vector.
+ *
+ */
+TARGET("avx512f") long scan_words_avx512(const long* input, long* output, size_t length, long offset);
+#endif
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the time from a monotonic clock.
+ *
+ *  \return Time in seconds
+ *
+ */
+double seconds(void);
+
+/*!
+ *  \param argv[1] Number of threads per process
+ *  \param argv[2] Number of elements per process
+ *  \param argv[3] Number of times to run each kernel
+ */
+int main(int argc, char** argv) {
+
+    /* Context shared by the threads of this process */
+    scan_context context;
+    /* Arguments of the threads */
+    scan_test_a* args = NULL;
+    pthread_t* threads = NULL;
+    /* GB/s of each kernel on this process, and their sums over all processes */
+    double rates[NUMBER_OF_KERNELS];
+    double all_rates[NUMBER_OF_KERNELS];
+    /* Shortest time of each kernel on the slowest process */
+    double slowest[NUMBER_OF_KERNELS];
+    /* Wrong sums and prefix sums on all processes */
+    long all_errors = 0;
+    long errors;
+
+    /* Used for error handling */
+    int error_code;
+    /* Current kernel and thread */
+    int kernel, i;
+    /* Number of threads per process */
+    int NUMBER_OF_PTHREADS;
+    /* Total number of processes used in this program */
+    int NUMBER_OF_PROCESSES;
+    /* Current process */
+    int PROCESS_ID;
+
+    /* Number of elements per process */
+    long ELEMENTS;
+    /* Bytes that a kernel moves on all processes */
+    double bytes;
+
+    /* Used to time program execution */
+    double program_start;
+
+    /***************************************************************************************************/
+
+    if (argc != 4) {
+       printf("Usage: ./scan ");
+       printf("[number of threads] [number of elements per process] [number of times to run each kernel]\n");
+       printf("Please try again.\n");
+       exit(1);
+    }
+
+    if ((NUMBER_OF_PTHREADS = atoi(argv[1])) <= 0) {
+       printf("Error: Invalid argument for number of threads. Please try again.\n");
+       exit(1);
+    }
+
+    if ((ELEMENTS = atol(argv[2])) < NUMBER_OF_PTHREADS) {
+       printf("Error: Number of elements must be at least the number of threads. Please try again.\n");
+       exit(1);
+    }
+
+    memset(&context, 0, sizeof(scan_context));
+
+    if ((context.repetitions = atoi(argv[3])) <= 0) {
+       printf("Error: Invalid argument for number of times to run each kernel. Please try again.\n");
+       exit(1);
+    }
+
+    /***************************************************************************************************/
+
+    error_code = MPI_Init(&argc, &argv);
+    error_code = MPI_Comm_size(MPI_COMM_WORLD, &NUMBER_OF_PROCESSES);
+    error_code = MPI_Comm_rank(MPI_COMM_WORLD, &PROCESS_ID);
+
+    if (error_code != 0) {
+       printf("Error encountered while initializing MPI and obtaining task information.\n");
+       MPI_Finalize();
+       exit(1);
+    }
+
+    context.length = ELEMENTS;
+    context.first_index = (size_t) PROCESS_ID * ELEMENTS;
+    context.threads = NUMBER_OF_PTHREADS;
+    context.input = (long*) page_alloc(ELEMENTS, sizeof(long));
+    context.output = (long*) page_alloc(ELEMENTS, sizeof(long));
+    context.partial_sums = (long*) aligned_alloc(CACHE_LINE_SIZE, NUMBER_OF_PTHREADS * CACHE_LINE_SIZE);
+    args = (scan_test_a*) calloc(NUMBER_OF_PTHREADS, sizeof(scan_test_a));
+    threads = (pthread_t*) calloc(NUMBER_OF_PTHREADS, sizeof(pthread_t));
+
+    if (context.input == NULL || context.output == NULL || context.partial_sums == NULL || args == NULL ||
+        threads == NULL) {
+       printf("Memory allocation failed for arrays! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Finalize();
+       exit(1);
+    }
+
+    context.simd_scan = scan_words;
+    #ifdef DISPATCH
+        if (CPU_SUPPORTS("avx512f")) {
+           context.simd_scan = scan_words_avx512;
+        }
+    #endif
+
+    /****************************************************************************************************
+    ** Run every kernel on all threads of every process                                                **
+    ****************************************************************************************************/
+    program_start = seconds();
+
+    if (PROCESS_ID == MASTER) {
+       printf("\nRunning scan and reduce kernels on %ld elements with %d threads on each of the %d processes... ",
+              ELEMENTS, NUMBER_OF_PTHREADS, NUMBER_OF_PROCESSES);
+       fflush(stdout);
+    }
+
+    pthread_barrier_init(&context.barrier, NULL, NUMBER_OF_PTHREADS);
+
+    for (i = 0; i < NUMBER_OF_PTHREADS; i++) {
+        args[i].context = &context;
+        args[i].thread = i;
+        if (i > 0 && pthread_create(&threads[i], NULL, scan_test, &args[i]) != 0) {
+           printf("Error encountered while creating pthread.\n");
+           MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    /***** The main thread is thread 0, so that only it makes MPI calls *****/
+    scan_test(&args[0]);
+
+    for (i = 1; i < NUMBER_OF_PTHREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (kernel = 0; kernel < NUMBER_OF_KERNELS; kernel++) {
+        rates[kernel] = (double) KERNEL_BYTES[kernel] * ELEMENTS / context.best[kernel] / 1.0e9;
+    }
+
+    errors = atomic_load(&context.errors);
+    MPI_Reduce(rates, all_rates, NUMBER_OF_KERNELS, MPI_DOUBLE, MPI_SUM, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(context.best, slowest, NUMBER_OF_KERNELS, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+    MPI_Allreduce(&errors, &all_errors, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Print results                                                                                   **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       printf("Success!\n\n");
+       printf("======================================================================\n");
+       printf("== Scan and reduce results                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Each process holds %ld 64-bit integers (%.2f GB per array) on\n", ELEMENTS, 8.0 * ELEMENTS / 1.0e9);
+       printf("%s pages. Times are the shortest of %d runs on the slowest\n", page_backend_name(), context.repetitions);
+       printf("process. GB/s counts the bytes that a kernel must read and write\n");
+       printf("on all processes; the two-pass scans read the input twice.\n\n");
+       printf("Kernel                   Threads   Bytes/element      Seconds         GB/s   Copy\n");
+       printf("----------------------   -------   -------------   ----------   ----------   ----\n");
+       for (kernel = 0; kernel < NUMBER_OF_KERNELS; kernel++) {
+           if (kernel >= FIRST_DISTRIBUTED_KERNEL) {
+              /***** The distributed array is done when the slowest process is done *****/
+              bytes = (double) KERNEL_BYTES[kernel] * ELEMENTS * NUMBER_OF_PROCESSES;
+              all_rates[kernel] = bytes / slowest[kernel] / 1.0e9;
+           }
+           printf("%-22s   %7d   %13d   %10.4f   %10.2f   %3.0f%%\n", KERNEL_NAMES[kernel],
+                  (kernel == REDUCE_SERIAL || kernel == SCAN_SERIAL) ? 1 : NUMBER_OF_PTHREADS, KERNEL_BYTES[kernel],
+                  slowest[kernel], all_rates[kernel], 100.0 * all_rates[kernel] / all_rates[COPY_KERNEL]);
+       }
+       printf("\n");
+
+       printf("======================================================================\n");
+       printf("== Summary                                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
+       printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
+       printf("Number of threads per process:               %10d\n", NUMBER_OF_PTHREADS);
+       printf("Pages (PAGES=4k, thp, 2m or 1g):             %10s\n\n", page_backend_name());
+       printf("Wrong sums and prefix sums:                  %10ld\n\n", all_errors);
+       printf("Total runtime:                               %10.2f seconds\n\n", seconds() - program_start);
+    }
+
+    /***************************************************************************************************/
+
+    {
+       const char* kernels[2] = { "copy and reduce", "scan, two-pass SIMD" };
+       const char* variants[2] = { clone_variant(), (context.simd_scan == scan_words) ? "scalar" : "AVX-512" };
+       report_kernel_variants(2, kernels, variants);
+    }
+
+    pthread_barrier_destroy(&context.barrier);
+    free(threads);
+    free(args);
+    free(context.partial_sums);
+    page_free(context.output, ELEMENTS, sizeof(long));
+    page_free(context.input, ELEMENTS, sizeof(long));
+
+    MPI_Finalize();
+
+    return (all_errors == 0) ? 0 : 1;
+
+}
+
+void* scan_test(void* scan_test_args) {
+
+    scan_context* context = ((scan_test_a*) scan_test_args)->context;
+    int thread = ((scan_test_a*) scan_test_args)->thread;
+    size_t first = context->length * thread / context->threads;
+    size_t last = context->length * (thread + 1) / context->threads;
+    size_t i;
+    double start = 0.0, time;
+    int kernel, repetition;
+
+    /***** Each thread touches its own part first, so that its pages are on its NUMA node *****/
+    for (i = first; i < last; i++) {
+        context->input[i] = (long) ((context->first_index + i) % 7 + 1);
+        context->output[i] = 0;
+    }
+
+    for (kernel = 0; kernel < NUMBER_OF_KERNELS; kernel++) {
+        for (repetition = 0; repetition < context->repetitions; repetition++) {
+            /***** Processes start every kernel together, since they share memory bandwidth *****/
+            if (thread == 0) {
+               MPI_Barrier(MPI_COMM_WORLD);
+            }
+            pthread_barrier_wait(&context->barrier);
+            if (thread == 0) {
+               start = seconds();
+            }
+
+            run_kernel(context, kernel, thread, first, last);
+
+            pthread_barrier_wait(&context->barrier);
+            if (thread == 0) {
+               time = seconds() - start;
+               if (repetition == 0 || time < context->best[kernel]) {
+                  context->best[kernel] = time;
+               }
+            }
+        }
+
+        /***** Every thread checks its part of the output of the last run *****/
+        atomic_fetch_add(&context->errors, verify_kernel(context, kernel, thread, first, last));
+        pthread_barrier_wait(&context->barrier);
+    }
+
+    return NULL;
+
+}
+
+void run_kernel(scan_context* context, int kernel, int thread, size_t first, size_t last) {
+
+    long* partial_sums = context->partial_sums;
+    long offset = 0;
+    int i;
+
+    /***** Thread t keeps its sum in word 8t, on its own cache line *****/
+    const int stride = CACHE_LINE_SIZE / sizeof(long);
+
+    if (kernel == COPY_KERNEL) {
+       copy_words(context->input + first, context->output + first, last - first);
+    }
+    else if (kernel == REDUCE_SERIAL) {
+       if (thread == 0) {
+          context->total = reduce_words(context->input, context->length);
+       }
+    }
+    else if (kernel == SCAN_SERIAL) {
+       if (thread == 0) {
+          scan_words(context->input, context->output, context->length, 0);
+       }
+    }
+    else {
+       /***** First pass: every thread sums its part *****/
+       partial_sums[thread * stride] = reduce_words(context->input + first, last - first);
+       pthread_barrier_wait(&context->barrier);
+
+       if (thread == 0) {
+          context->total = 0;
+          for (i = 0; i < context->threads; i++) {
+              context->total += partial_sums[i * stride];
+          }
+          context->process_offset = 0;
+          if (kernel == MPI_REDUCE_KERNEL) {
+             MPI_Allreduce(MPI_IN_PLACE, &context->total, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+          }
+          else if (kernel == MPI_SCAN_KERNEL) {
+             MPI_Scan(&context->total, &context->process_offset, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+             context->process_offset -= context->total;
+          }
+          else if (kernel == MPI_EXSCAN_KERNEL) {
+             MPI_Exscan(&context->total, &context->process_offset, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+             /***** The result of MPI_Exscan is undefined on the first process *****/
+             if (context->first_index == 0) {
+                context->process_offset = 0;
+             }
+          }
+       }
+
+       if (kernel == REDUCE_THREADED || kernel == MPI_REDUCE_KERNEL) {
+          return;
+       }
+
+       /***** Second pass: every thread scans its part starting from the sum of the parts before it *****/
+       pthread_barrier_wait(&context->barrier);
+       offset = context->process_offset;
+       for (i = 0; i < thread; i++) {
+           offset += partial_sums[i * stride];
+       }
+       if (kernel == SCAN_THREADED) {
+          scan_words(context->input + first, context->output + first, last - first, offset);
+       }
+       else {
+          context->simd_scan(context->input + first, context->output + first, last - first, offset);
+       }
+    }
+
+}
+
+long verify_kernel(scan_context* context, int kernel, int thread, size_t first, size_t last) {
+
+    long errors = 0;
+    long expected;
+    size_t i;
+
+    if (kernel == COPY_KERNEL) {
+       for (i = first; i < last; i++) {
+           errors += (context->output[i] != context->input[i]);
+       }
+    }
+    else if (kernel == REDUCE_SERIAL || kernel == REDUCE_THREADED) {
+       if (thread == 0) {
+          errors += (context->total != expected_prefix((long) (context->first_index + context->length) - 1) -
+                                      expected_prefix((long) context->first_index - 1));
+       }
+    }
+    else if (kernel == MPI_REDUCE_KERNEL) {
+       if (thread == 0) {
+          int processes;
+          MPI_Comm_size(MPI_COMM_WORLD, &processes);
+          errors += (context->total != expected_prefix((long) (processes * context->length) - 1));
+       }
+    }
+    else {
+       /***** The local scans start from 0 and the distributed ones from the start of the array *****/
+       expected = (kernel >= FIRST_DISTRIBUTED_KERNEL) ? expected_prefix((long) (context->first_index + first) - 1)
+                                                       : expected_prefix((long) (context->first_index + first) - 1) -
+                                                         expected_prefix((long) context->first_index - 1);
+       for (i = first; i < last; i++) {
+           expected += context->input[i];
+           errors += (context->output[i] != expected);
+       }
+    }
+
+    return errors;
+
+}
+
+long expected_prefix(long index) {
+    long count = index + 1;
+    long remainder = count % 7;
+    /***** Every 7 elements add up to 1 + 2 + ... + 7 = 28 *****/
+    return count / 7 * 28 + remainder * (remainder + 1) / 2;
+}
+
+KERNEL_CLONES void copy_words(const long* input, long* output, size_t length) {
+    size_t i;
+    for (i = 0; i < length; i++) {
+        output[i] = input[i];
+    }
+}
+
+KERNEL_CLONES long reduce_words(const long* input, size_t length) {
+    long sum = 0;
+    size_t i;
+    for (i = 0; i < length; i++) {
+        sum += input[i];
+    }
+    return sum;
+}
+
+long scan_words(const long* input, long* output, size_t length, long offset) {
+    size_t i;
+    for (i = 0; i < length; i++) {
+        offset += input[i];
+        output[i] = offset;
+    }
+    return offset;
+}
+
+#ifdef DISPATCH
+TARGET("avx512f") long scan_words_avx512(const long* input, long* output, size_t length, long offset) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i last = _mm512_set1_epi64(7);
+    __m512i carry = _mm512_set1_epi64(offset);
+    __m512i sums;
+    size_t i;
+
+    for (i = 0; i + 8 <= length; i += 8) {
+        sums = _mm512_loadu_si512((const void*) (input + i));
+        /***** alignr with zero shifts the elements up by 1, 2 and 4 places *****/
+        sums = _mm512_add_epi64(sums, _mm512_alignr_epi64(sums, zero, 7));
+        sums = _mm512_add_epi64(sums, _mm512_alignr_epi64(sums, zero, 6));
+        sums = _mm512_add_epi64(sums, _mm512_alignr_epi64(sums, zero, 4));
+        sums = _mm512_add_epi64(sums, carry);
+        _mm512_storeu_si512((void*) (output + i), sums);
+        carry = _mm512_permutexvar_epi64(last, sums);
+    }
+
+    if (i > 0) {
+       offset = output[i - 1];
+    }
+    for (; i < length; i++) {
+        offset += input[i];
+        output[i] = offset;
+    }
+    return offset;
+}
+#endif
+
+double seconds(void) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec + now.tv_nsec / 1.0e9;
+}
@@ -33,6 +33,10 @@
 #define MASTER      0
 #define TRUE        1
 #define FALSE       0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
 
 /*!
  *
@@ -129,9 +133,9 @@ int main(int argc, char** argv) {
     int ROW_TAG = 1;
 
     /* Used to start timing shearsort algorithm */
-    time_t start;
+    double start;
     /* Used to end timing shearsort algorithm */
-    time_t end;
+    double end;
 
     /* Derived datatype for sending a column in a matrix to a process */
     MPI_Datatype column_type;
@@ -219,7 +223,7 @@ int main(int argc, char** argv) {
        printf("Sorting matrix...\n");
        printf("\n");
 
-       start = time(NULL);
+       start = MPI_Wtime();
 
        for (program_counter = 0; program_counter < (int) ceil(log((double) DIMENSION) / log(2.0)); program_counter++) {
            printf("   Pass %d of %d...\n\n", program_counter + 1, (int) ceil((log((double) DIMENSION) / log(2.0))));
@@ -306,7 +310,7 @@ int main(int argc, char** argv) {
           exit(1);
        }
 
-       end = time(NULL);
+       end = MPI_Wtime();
     }
     /****************************************************************************************************
     ** WORKERS                                                                                         **
@@ -381,10 +385,11 @@ int main(int argc, char** argv) {
        printf("======================================================================\n");
        printf("== Summary                                                          ==\n");
        printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
        printf("Total number of processes:    %10d\n\n", NUMBER_OF_PROCESSES);
        printf("Dimension of square matrix:   %10d\n",  DIMENSION);
        printf("Number of elements in matrix: %10d\n\n", DIMENSION * DIMENSION);
-       printf("Total runtime:                   %10.2f seconds\n\n", difftime(end, start));
+       printf("Total runtime:                   %10.4f seconds\n\n", end - start);
     }
 
     MPI_Finalize();
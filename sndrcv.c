@@ -40,6 +40,10 @@
 
 /*! Master process. Usually process 0. */
 #define MASTER      0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
 
 /*!
  *
@@ -230,6 +234,7 @@ int main(int argc, char** argv) {
        printf("======================================================================\n");
        printf("== Summary                                                          ==\n");
        printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
        printf("Total number of processes:                    %10d\n\n", NUMBER_OF_PROCESSES);
        printf("Array size:                                   %10d\n\n",  SIZE);
        printf("Average time to send array from head to tail:    %10.2f seconds\n\n", runtime / (double) NUMBER_OF_RUNS);
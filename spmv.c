@@ -0,0 +1,936 @@
+/*!
+ *
+ *  \file    spmv.c
+ *  \brief   Benchmarks distributed sparse matrix-vector multiplication
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this program works:
+ *           Given a matrix type and size, each of the Q processes generates a contiguous block of
+ *           about N / Q rows of a sparse N x N matrix. The matrix is either the 7-point stencil of
+ *           the Poisson equation on an n x n x n grid or a random matrix whose row lengths follow a
+ *           power law. Each process then works out which elements of the vector x it needs from
+ *           other processes and builds a neighbourhood communicator with only those processes.
+ *           The program repeats y = A * x M times, exchanging the needed elements of x with
+ *           \b MPI_Neighbor_alltoallv before each multiplication. The matrix is stored first in
+ *           compressed sparse row (CSR) format and then in SELL-C-sigma format, which sorts rows
+ *           by length within windows of sigma rows and stores chunks of C rows column by column
+ *           so that the inner loop runs across C rows at once and vectorizes. Finally, the
+ *           runtime of each format, the effective memory bandwidth and the floating-point
+ *           throughput are displayed.
+ *
+ *           \par Reference:
+ *           <A HREF="https://arxiv.org/abs/1307.6209">A unified sparse matrix data format for efficient general sparse matrix-vector multiply on modern processors with wide SIMD units</A>
+ *
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <mpi.h>
+
+/*! Master process. Usually process 0. */
+#define MASTER                     0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS                "unknown"
+#endif
+/*! 7-point stencil of the Poisson equation on a 3-dimensional grid */
+#define POISSON                    1
+/*! Random matrix whose row lengths follow a power law */
+#define POWER_LAW                  2
+
+/*! Number of rows in a SELL-C-sigma chunk. Can be overridden at compile time. */
+#ifndef CHUNK_HEIGHT
+#define CHUNK_HEIGHT               8
+#endif
+/*! Default number of rows that are sorted by length together in SELL-C-sigma format */
+#define DEFAULT_SORTING_SCOPE    256
+
+/*! Exponent of the power law that row lengths of the random matrix follow */
+#define POWER_LAW_EXPONENT       2.5
+/*! Shortest row in the random matrix, not counting the diagonal */
+#define MINIMUM_ROW_LENGTH         4
+/*! Longest row in the random matrix */
+#define MAXIMUM_ROW_LENGTH      4096
+
+/*!
+ *  \brief Rows of a sparse matrix in compressed sparse row format
+ */
+typedef struct csr_matrix {
+    /* Number of rows owned by this process */
+    int rows;
+    /* Number of nonzero elements in all rows */
+    long nonzeros;
+    /* Position of the first element of each row, plus one past the last row */
+    long* row_pointers;
+    /* Global column of each element. Freed after building the halo. */
+    long* global_columns;
+    /* Local column of each element, where elements received from other processes follow local ones */
+    int* columns;
+    double* values;
+} csr_matrix;
+
+/*!
+ *  \brief Rows of a sparse matrix in SELL-C-sigma format
+ */
+typedef struct sell_matrix {
+    /* Number of rows owned by this process */
+    int rows;
+    /* Number of chunks of \b CHUNK_HEIGHT rows */
+    int chunks;
+    /* Number of elements stored, including padding */
+    long stored;
+    /* Length of the longest row in each chunk */
+    int* chunk_lengths;
+    /* Position of the first element of each chunk */
+    long* chunk_pointers;
+    /* Original row that is stored at each position */
+    int* permutation;
+    int* columns;
+    double* values;
+} sell_matrix;
+
+/*!
+ *  \brief Elements of x that are exchanged with neighbouring processes before each multiplication
+ */
+typedef struct halo {
+    /* Communicator that only connects processes that exchange elements of x */
+    MPI_Comm neighbours;
+    /* Number of elements received from other processes and stored after the local elements */
+    int size;
+    /* Number of elements sent to other processes */
+    int send_size;
+    int number_of_sources;
+    int number_of_destinations;
+    int* send_counts;
+    int* send_displacements;
+    /* Local elements of x to send, in the order they are sent */
+    int* send_indices;
+    double* send_buffer;
+    int* receive_counts;
+    int* receive_displacements;
+} halo;
+
+/***************************************************************************************************/
+
+/*!
+ *
+ *  \par Description:
+ *  Generates a random number from a seed without keeping state, so that every row of the random
+ *  matrix is the same no matter how many processes there are.
+ *
+ *  \param state Seed, which is advanced to the next state
+ *
+ *  \return Random 64-bit number
+ *
+ */
+uint64_t next_random(uint64_t* state);
+
+/*!
+ *
+ *  \par Description:
+ *  Finds the process that owns a row.
+ *
+ *  \param row Global row number
+ *  \param total_rows Number of rows in the matrix
+ *  \param number_of_processes Number of processes that the rows are divided among
+ *
+ *  \return ID of the process that owns \b row
+ *
+ */
+int owner_of(long row, long total_rows, int number_of_processes);
+
+/*!
+ *
+ *  \par Description:
+ *  Generates the rows of a matrix that belong to one process, with global column indices.
+ *
+ *  \param matrix Empty matrix
+ *  \param type 1 for Poisson or 2 for power law
+ *  \param dimension Number of grid points in each dimension (Poisson) or number of rows (power law)
+ *  \param first_row Global number of first row
+ *  \param rows Number of rows to generate
+ *
+ *  \return 0 if successful or -1 if memory allocation failed
+ *
+ */
+int generate_matrix(csr_matrix* matrix, int type, long dimension, long first_row, int rows);
+
+/*!
+ *
+ *  \par Description:
+ *  Finds the elements of x that are owned by other processes, tells the owners which elements
+ *  to send, creates a neighbourhood communicator and changes global column indices into
+ *  local ones, where the elements received from other processes follow the local elements.
+ *
+ *  \param matrix Matrix with global column indices
+ *  \param exchange Empty halo
+ *  \param first_row Global number of first row of this process
+ *  \param total_rows Number of rows in the matrix
+ *
+ *  \return 0 if successful or -1 if memory allocation failed
+ *
+ */
+int build_halo(csr_matrix* matrix, halo* exchange, long first_row, long total_rows);
+
+/*!
+ *
+ *  \par Description:
+ *  Sends and receives the elements of x that are needed by other processes.
+ *
+ *  \param exchange Halo built by \b build_halo
+ *  \param x Vector with room for the received elements after the local elements
+ *  \param rows Number of local elements of x
+ *
+ */
+void exchange_halo(halo* exchange, double* x, int rows);
+
+/*!
+ *
+ *  \par Description:
+ *  Converts a matrix from CSR format to SELL-C-sigma format.
+ *
+ *  \param csr Matrix with local column indices
+ *  \param sell Empty matrix
+ *  \param sorting_scope Number of rows that are sorted by length together
+ *
+ *  \return 0 if successful or -1 if memory allocation failed
+ *
+ */
+int convert_to_sell(const csr_matrix* csr, sell_matrix* sell, int sorting_scope);
+
+/*!
+ *
+ *  \par Description:
+ *  Multiplies a matrix in CSR format by a vector, i.e. y = A * x.
+ *
+ */
+void spmv_csr(const csr_matrix* matrix, const double* x, double* y);
+
+/*!
+ *
+ *  \par Description:
+ *  Multiplies a matrix in SELL-C-sigma format by a vector, i.e. y = A * x.
+ *
+ */
+void spmv_sell(const sell_matrix* matrix, const double* x, double* y);
+
+/*!
+ *
+ *  \par Description:
+ *  Compares the lengths of two rows for sorting them in descending order.
+ *
+ */
+int compare_lengths(const void* first, const void* second);
+
+/*!
+ *
+ *  \par Description:
+ *  Compares two column indices for sorting them in ascending order.
+ *
+ */
+int compare_columns(const void* first, const void* second);
+
+/*!
+ *  \param argv[1] 1 for 3-dimensional Poisson stencil or 2 for random power-law matrix
+ *  \param argv[2] Number of grid points in each dimension (Poisson) or number of rows (power law)
+ *  \param argv[3] Number of times to multiply matrix by vector
+ *  \param argv[4] (Optional) Number of rows sorted by length together in SELL-C-sigma format
+ */
+int main(int argc, char** argv) {
+
+    /* Matrix in CSR format */
+    csr_matrix csr;
+    /* Matrix in SELL-C-sigma format */
+    sell_matrix sell;
+    /* Elements of x exchanged with other processes */
+    halo exchange;
+
+    /* Bytes that have to be moved to or from memory in one multiplication, over all processes */
+    double bytes_moved;
+    /* Largest difference between CSR and SELL-C-sigma results */
+    double difference = 0.0;
+    /* Largest difference on any process */
+    double max_difference;
+    /* Used to time one format */
+    double start;
+    /* Time spent exchanging the halo and multiplying with each format */
+    double runtimes[2] = {0.0, 0.0};
+    /* Time spent exchanging the halo with each format */
+    double halo_times[2] = {0.0, 0.0};
+    /* Longest times on any process */
+    double max_runtimes[2];
+    double max_halo_times[2];
+
+    /* Vector x, followed by elements received from other processes */
+    double* x = NULL;
+    /* Result of CSR multiplication */
+    double* y_csr = NULL;
+    /* Result of SELL-C-sigma multiplication */
+    double* y_sell = NULL;
+
+    /* Used for error handling */
+    int error_code;
+    /* Current format */
+    int format;
+    int i; /* loop counter */
+    /* Number of times to multiply matrix by vector */
+    int ITERATIONS;
+    /* Either 1 for Poisson or 2 for power law */
+    int MATRIX_TYPE;
+    /* Smallest and largest numbers of neighbours of any process */
+    int min_neighbours, max_neighbours;
+    /* Total number of processes used in this program */
+    int NUMBER_OF_PROCESSES;
+    /* Current process */
+    int PROCESS_ID;
+    /* Number of rows owned by this process */
+    int rows;
+    /* Number of rows sorted by length together in SELL-C-sigma format */
+    int SORTING_SCOPE = DEFAULT_SORTING_SCOPE;
+
+    /* Number of grid points in each dimension (Poisson) or number of rows (power law) */
+    long DIMENSION;
+    /* Global number of first row owned by this process */
+    long first_row;
+    /* Number of rows in matrix */
+    long TOTAL_ROWS;
+    /* Smallest, largest and total numbers of nonzero elements on any process */
+    long min_nonzeros, max_nonzeros, total_nonzeros;
+    /* Total numbers of elements stored in SELL-C-sigma format and received in halos */
+    long total_stored, total_halo;
+    long value; /* used for reductions */
+
+    /***************************************************************************************************/
+
+    if (argc != 4 && argc != 5) {
+       printf("Usage: ./spmv ");
+       printf("[1 = 3D Poisson, 2 = random power law] [grid points per dimension or number of rows] ");
+       printf("[number of iterations] [optional: SELL-C-sigma sorting scope]\nPlease try again.\n");
+       exit(1);
+    }
+
+    if ((MATRIX_TYPE = atoi(argv[1])) != POISSON && MATRIX_TYPE != POWER_LAW) {
+       printf("Error: Invalid argument for type of matrix. Please try again.\n");
+       exit(1);
+    }
+
+    if ((DIMENSION = atol(argv[2])) <= 0) {
+       printf("Error: Invalid argument for size of matrix. Please try again.\n");
+       exit(1);
+    }
+
+    if ((ITERATIONS = atoi(argv[3])) <= 0) {
+       printf("Error: Invalid argument for number of iterations. Please try again.\n");
+       exit(1);
+    }
+
+    if (argc == 5 && ((SORTING_SCOPE = atoi(argv[4])) <= 0 || SORTING_SCOPE % CHUNK_HEIGHT != 0)) {
+       printf("Error: Sorting scope must be a positive multiple of %d. Please try again.\n", CHUNK_HEIGHT);
+       exit(1);
+    }
+
+    TOTAL_ROWS = (MATRIX_TYPE == POISSON) ? DIMENSION * DIMENSION * DIMENSION : DIMENSION;
+
+    /***************************************************************************************************/
+
+    error_code = MPI_Init(&argc, &argv);
+    error_code = MPI_Comm_size(MPI_COMM_WORLD, &NUMBER_OF_PROCESSES);
+    error_code = MPI_Comm_rank(MPI_COMM_WORLD, &PROCESS_ID);
+
+    if (error_code != 0) {
+       printf("Error encountered while initializing MPI and obtaining task information.\n");
+       MPI_Finalize();
+       exit(1);
+    }
+
+    if (TOTAL_ROWS < NUMBER_OF_PROCESSES) {
+       if (PROCESS_ID == MASTER) {
+          printf("Number of rows = %ld\tNumber of processes = %d\n", TOTAL_ROWS, NUMBER_OF_PROCESSES);
+          printf("Matrix must have at least one row per process. Please try again.\n");
+       }
+       MPI_Finalize();
+       exit(1);
+    }
+
+    /****************************************************************************************************
+    ** Generate rows, build halo and convert to SELL-C-sigma format                                    **
+    ****************************************************************************************************/
+    rows = (int) (TOTAL_ROWS / NUMBER_OF_PROCESSES + (PROCESS_ID < TOTAL_ROWS % NUMBER_OF_PROCESSES));
+    first_row = (TOTAL_ROWS / NUMBER_OF_PROCESSES) * PROCESS_ID +
+                ((PROCESS_ID < TOTAL_ROWS % NUMBER_OF_PROCESSES) ? PROCESS_ID : TOTAL_ROWS % NUMBER_OF_PROCESSES);
+
+    if (PROCESS_ID == MASTER) {
+       printf("\nGenerating matrix and building halo... ");
+    }
+
+    if (generate_matrix(&csr, MATRIX_TYPE, DIMENSION, first_row, rows) != 0 ||
+        build_halo(&csr, &exchange, first_row, TOTAL_ROWS) != 0 ||
+        convert_to_sell(&csr, &sell, SORTING_SCOPE) != 0) {
+       printf("Memory allocation failed for matrix! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    x = (double*) calloc(rows + exchange.size, sizeof(double));
+    y_csr = (double*) calloc(rows, sizeof(double));
+    y_sell = (double*) calloc(rows, sizeof(double));
+
+    if (x == NULL || y_csr == NULL || y_sell == NULL) {
+       printf("Memory allocation failed for vectors! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (i = 0; i < rows; i++) {
+        x[i] = 1.0 + (double) ((first_row + i) % 7) / 7.0;
+    }
+
+    if (PROCESS_ID == MASTER) {
+       printf("Done!\n");
+    }
+
+    /****************************************************************************************************
+    ** Multiply matrix by vector with each format                                                      **
+    ****************************************************************************************************/
+    for (format = 0; format < 2; format++) {
+
+        if (PROCESS_ID == MASTER) {
+           printf("\nMultiplying matrix by vector %d times in %s format... ", ITERATIONS, (format == 0) ? "CSR" : "SELL-C-sigma");
+        }
+
+        /***** One untimed multiplication to warm up caches *****/
+        exchange_halo(&exchange, x, rows);
+        if (format == 0) {
+           spmv_csr(&csr, x, y_csr);
+        }
+        else {
+           spmv_sell(&sell, x, y_sell);
+        }
+
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        for (i = 0; i < ITERATIONS; i++) {
+            start = MPI_Wtime();
+            exchange_halo(&exchange, x, rows);
+            halo_times[format] += MPI_Wtime() - start;
+
+            if (format == 0) {
+               spmv_csr(&csr, x, y_csr);
+            }
+            else {
+               spmv_sell(&sell, x, y_sell);
+            }
+            runtimes[format] += MPI_Wtime() - start;
+        }
+
+        if (PROCESS_ID == MASTER) {
+           printf("Done!\n");
+        }
+    }
+
+    for (i = 0; i < rows; i++) {
+        if (fabs(y_csr[i] - y_sell[i]) > difference) {
+           difference = fabs(y_csr[i] - y_sell[i]);
+        }
+    }
+
+    /****************************************************************************************************
+    ** Collect results on Master                                                                       **
+    ****************************************************************************************************/
+    MPI_Reduce(runtimes, max_runtimes, 2, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(halo_times, max_halo_times, 2, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(&difference, &max_difference, 1, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(&csr.nonzeros, &min_nonzeros, 1, MPI_LONG, MPI_MIN, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(&csr.nonzeros, &max_nonzeros, 1, MPI_LONG, MPI_MAX, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(&csr.nonzeros, &total_nonzeros, 1, MPI_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(&sell.stored, &total_stored, 1, MPI_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
+    value = exchange.size;
+    MPI_Reduce(&value, &total_halo, 1, MPI_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(&exchange.number_of_sources, &min_neighbours, 1, MPI_INT, MPI_MIN, MASTER, MPI_COMM_WORLD);
+    MPI_Reduce(&exchange.number_of_sources, &max_neighbours, 1, MPI_INT, MPI_MAX, MASTER, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Print results                                                                                   **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       /***** Values, column indices and row pointers are read once; x is read and y is written once *****/
+       bytes_moved = (double) total_nonzeros * (sizeof(double) + sizeof(int)) +
+                     (double) TOTAL_ROWS * (sizeof(int) + 2 * sizeof(double));
+
+       printf("\n");
+       printf("======================================================================\n");
+       printf("== Runtimes (seconds per multiplication)                            ==\n");
+       printf("======================================================================\n\n");
+       printf("Format              Total     Halo exchange       GB/s     GFLOP/s\n");
+       printf("------------   ----------     -------------   --------   ---------\n");
+       for (format = 0; format < 2; format++) {
+           printf("%-12s   %10.6f     %13.6f   %8.2f   %9.2f\n", (format == 0) ? "CSR" : "SELL-C-sigma",
+                  max_runtimes[format] / ITERATIONS, max_halo_times[format] / ITERATIONS,
+                  bytes_moved * ITERATIONS / max_runtimes[format] / 1.0e9,
+                  2.0 * total_nonzeros * ITERATIONS / max_runtimes[format] / 1.0e9);
+       }
+       printf("\n");
+       printf("======================================================================\n");
+       printf("== Summary                                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
+       printf("Total number of processes:                  %10d\n\n", NUMBER_OF_PROCESSES);
+       printf("Matrix:                    %27s\n", (MATRIX_TYPE == POISSON) ? "3D Poisson (7-point)" : "Random power law");
+       printf("   Number of rows:                          %10ld\n", TOTAL_ROWS);
+       printf("   Number of nonzero elements:              %10ld\n", total_nonzeros);
+       printf("   Nonzero elements per process (min/max):  %10ld / %ld\n", min_nonzeros, max_nonzeros);
+       printf("   Neighbours per process (min/max):        %10d / %d\n", min_neighbours, max_neighbours);
+       printf("   Halo elements received per iteration:    %10ld\n\n", total_halo);
+       printf("SELL-C-sigma\n");
+       printf("   Chunk height (C):                        %10d\n", CHUNK_HEIGHT);
+       printf("   Sorting scope (sigma):                   %10d\n", SORTING_SCOPE);
+       printf("   Fraction of stored elements that are nonzero: %10.3f\n\n", (double) total_nonzeros / total_stored);
+       printf("Largest difference between CSR and SELL-C-sigma results: %.4e\n\n", max_difference);
+    }
+
+    /***************************************************************************************************/
+
+    free(y_sell);
+    free(y_csr);
+    free(x);
+    free(sell.values);
+    free(sell.columns);
+    free(sell.permutation);
+    free(sell.chunk_pointers);
+    free(sell.chunk_lengths);
+    free(exchange.receive_displacements);
+    free(exchange.receive_counts);
+    free(exchange.send_buffer);
+    free(exchange.send_indices);
+    free(exchange.send_displacements);
+    free(exchange.send_counts);
+    free(csr.values);
+    free(csr.columns);
+    free(csr.row_pointers);
+
+    MPI_Comm_free(&exchange.neighbours);
+    MPI_Finalize();
+
+    return 0;
+
+}
+
+uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+int owner_of(long row, long total_rows, int number_of_processes) {
+    long base = total_rows / number_of_processes;
+    long remainder = total_rows % number_of_processes;
+
+    if (row < remainder * (base + 1)) {
+       return (int) (row / (base + 1));
+    }
+    return (int) (remainder + (row - remainder * (base + 1)) / base);
+}
+
+int generate_matrix(csr_matrix* matrix, int type, long dimension, long first_row, int rows) {
+
+    int i, j;
+    int length;
+    long capacity;
+    long position = 0;
+    long row;
+
+    matrix->rows = rows;
+    matrix->row_pointers = (long*) calloc(rows + 1, sizeof(long));
+
+    if (type == POISSON) {
+       capacity = 7L * rows;
+    }
+    else {
+       capacity = (long) (MINIMUM_ROW_LENGTH + 2) * rows;
+    }
+
+    matrix->global_columns = (long*) calloc(capacity, sizeof(long));
+    matrix->values = (double*) calloc(capacity, sizeof(double));
+
+    if (matrix->row_pointers == NULL || matrix->global_columns == NULL || matrix->values == NULL) {
+       return -1;
+    }
+
+    for (i = 0; i < rows; i++) {
+        row = first_row + i;
+        matrix->row_pointers[i] = position;
+
+        /****************************************************************************************************
+        ** 3D Poisson: 6 on the diagonal and -1 for each of the (up to) six neighbours on the grid         **
+        ****************************************************************************************************/
+        if (type == POISSON) {
+           long x = row % dimension;
+           long y = (row / dimension) % dimension;
+           long z = row / (dimension * dimension);
+
+           /***** Neighbours are added in ascending order of column *****/
+           if (z > 0)             { matrix->global_columns[position] = row - dimension * dimension; matrix->values[position++] = -1.0; }
+           if (y > 0)             { matrix->global_columns[position] = row - dimension;             matrix->values[position++] = -1.0; }
+           if (x > 0)             { matrix->global_columns[position] = row - 1;                     matrix->values[position++] = -1.0; }
+           matrix->global_columns[position] = row; matrix->values[position++] = 6.0;
+           if (x < dimension - 1) { matrix->global_columns[position] = row + 1;                     matrix->values[position++] = -1.0; }
+           if (y < dimension - 1) { matrix->global_columns[position] = row + dimension;             matrix->values[position++] = -1.0; }
+           if (z < dimension - 1) { matrix->global_columns[position] = row + dimension * dimension; matrix->values[position++] = -1.0; }
+        }
+        /****************************************************************************************************
+        ** Power law: row length is MINIMUM_ROW_LENGTH / u^(1 / (POWER_LAW_EXPONENT - 1)) for a random u   **
+        ****************************************************************************************************/
+        else {
+           uint64_t state = (uint64_t) row * 0x2545F4914F6CDD1DULL + 1;
+           double u = ((next_random(&state) >> 11) + 1.0) / 9007199254740992.0;
+
+           length = (int) (MINIMUM_ROW_LENGTH / pow(u, 1.0 / (POWER_LAW_EXPONENT - 1.0)));
+           if (length > MAXIMUM_ROW_LENGTH - 1) {
+              length = MAXIMUM_ROW_LENGTH - 1;
+           }
+           if (length > dimension - 1) {
+              length = (int) (dimension - 1);
+           }
+
+           if (position + length + 1 > capacity) {
+              capacity = 2 * capacity + length + 1;
+              matrix->global_columns = (long*) realloc(matrix->global_columns, capacity * sizeof(long));
+              matrix->values = (double*) realloc(matrix->values, capacity * sizeof(double));
+              if (matrix->global_columns == NULL || matrix->values == NULL) {
+                 return -1;
+              }
+           }
+
+           matrix->global_columns[position] = row;
+           matrix->values[position] = (double) length + 1.0;
+           for (j = 1; j <= length; j++) {
+               matrix->global_columns[position + j] = (long) (next_random(&state) % (uint64_t) dimension);
+               matrix->values[position + j] = -((next_random(&state) >> 11) / 9007199254740992.0);
+           }
+
+           /***** Sorted columns make accesses to x more regular; values are random, so they need not follow *****/
+           qsort(&matrix->global_columns[position], length + 1, sizeof(long), compare_columns);
+           position += length + 1;
+        }
+    }
+
+    matrix->row_pointers[rows] = position;
+    matrix->nonzeros = position;
+
+    return 0;
+
+}
+
+int build_halo(csr_matrix* matrix, halo* exchange, long first_row, long total_rows) {
+
+    int i, j;
+    int number_of_processes;
+    int unique;  /* number of distinct remote columns */
+
+    long k;
+    long last_row = first_row + matrix->rows;
+    long remote = 0;
+
+    /* Distinct remote columns in ascending order, which also groups them by owner */
+    long* needed = NULL;
+    /* Remote columns that other processes need from this process */
+    long* requested = NULL;
+
+    /* Number of elements needed from and requested by every process */
+    int* needed_counts = NULL;
+    int* needed_displacements = NULL;
+    int* requested_counts = NULL;
+    int* requested_displacements = NULL;
+    int* sources = NULL;
+    int* destinations = NULL;
+    /* Weight of every edge of the neighbourhood graph */
+    int* weights = NULL;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &number_of_processes);
+
+    for (k = 0; k < matrix->nonzeros; k++) {
+        if (matrix->global_columns[k] < first_row || matrix->global_columns[k] >= last_row) {
+           remote++;
+        }
+    }
+
+    needed = (long*) calloc(remote + 1, sizeof(long));
+    needed_counts = (int*) calloc(number_of_processes, sizeof(int));
+    needed_displacements = (int*) calloc(number_of_processes, sizeof(int));
+    requested_counts = (int*) calloc(number_of_processes, sizeof(int));
+    requested_displacements = (int*) calloc(number_of_processes, sizeof(int));
+    sources = (int*) calloc(number_of_processes, sizeof(int));
+    destinations = (int*) calloc(number_of_processes, sizeof(int));
+    weights = (int*) calloc(number_of_processes, sizeof(int));
+
+    if (needed == NULL || needed_counts == NULL || needed_displacements == NULL || requested_counts == NULL ||
+        requested_displacements == NULL || sources == NULL || destinations == NULL || weights == NULL) {
+       return -1;
+    }
+
+    for (i = 0; i < number_of_processes; i++) {
+        weights[i] = 1;
+    }
+
+    for (k = 0, remote = 0; k < matrix->nonzeros; k++) {
+        if (matrix->global_columns[k] < first_row || matrix->global_columns[k] >= last_row) {
+           needed[remote++] = matrix->global_columns[k];
+        }
+    }
+
+    qsort(needed, remote, sizeof(long), compare_columns);
+
+    for (k = 0, unique = 0; k < remote; k++) {
+        if (unique == 0 || needed[unique - 1] != needed[k]) {
+           needed[unique++] = needed[k];
+           needed_counts[owner_of(needed[k], total_rows, number_of_processes)]++;
+        }
+    }
+
+    /****************************************************************************************************
+    ** Tell every process how many and which of its elements this process needs                        **
+    ****************************************************************************************************/
+    MPI_Alltoall(needed_counts, 1, MPI_INT, requested_counts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    exchange->number_of_sources = 0;
+    exchange->number_of_destinations = 0;
+    for (i = 0, j = 0, k = 0; i < number_of_processes; i++) {
+        needed_displacements[i] = j;
+        requested_displacements[i] = (int) k;
+        j += needed_counts[i];
+        k += requested_counts[i];
+        if (needed_counts[i] > 0) {
+           sources[exchange->number_of_sources++] = i;
+        }
+        if (requested_counts[i] > 0) {
+           destinations[exchange->number_of_destinations++] = i;
+        }
+    }
+
+    requested = (long*) calloc(k + 1, sizeof(long));
+
+    if (requested == NULL) {
+       return -1;
+    }
+
+    MPI_Alltoallv(needed, needed_counts, needed_displacements, MPI_LONG,
+                  requested, requested_counts, requested_displacements, MPI_LONG, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Keep only the neighbours, in the same order as in the neighbourhood communicator                **
+    ****************************************************************************************************/
+    exchange->size = unique;
+    exchange->send_size = (int) k;
+    exchange->send_counts = (int*) calloc(exchange->number_of_destinations + 1, sizeof(int));
+    exchange->send_displacements = (int*) calloc(exchange->number_of_destinations + 1, sizeof(int));
+    exchange->send_indices = (int*) calloc(k + 1, sizeof(int));
+    exchange->send_buffer = (double*) calloc(k + 1, sizeof(double));
+    exchange->receive_counts = (int*) calloc(exchange->number_of_sources + 1, sizeof(int));
+    exchange->receive_displacements = (int*) calloc(exchange->number_of_sources + 1, sizeof(int));
+
+    if (exchange->send_counts == NULL || exchange->send_displacements == NULL || exchange->send_indices == NULL ||
+        exchange->send_buffer == NULL || exchange->receive_counts == NULL || exchange->receive_displacements == NULL) {
+       return -1;
+    }
+
+    for (i = 0; i < exchange->number_of_destinations; i++) {
+        exchange->send_counts[i] = requested_counts[destinations[i]];
+        exchange->send_displacements[i] = requested_displacements[destinations[i]];
+    }
+
+    for (i = 0; i < k; i++) {
+        exchange->send_indices[i] = (int) (requested[i] - first_row);
+    }
+
+    for (i = 0; i < exchange->number_of_sources; i++) {
+        exchange->receive_counts[i] = needed_counts[sources[i]];
+        exchange->receive_displacements[i] = needed_displacements[sources[i]];
+    }
+
+    /***** Every edge has the same weight. MPI_UNWEIGHTED is a one-element sentinel that GCC warns about. *****/
+    MPI_Dist_graph_create_adjacent(MPI_COMM_WORLD, exchange->number_of_sources, sources, weights,
+                                   exchange->number_of_destinations, destinations, weights,
+                                   MPI_INFO_NULL, 0, &exchange->neighbours);
+
+    /****************************************************************************************************
+    ** Local columns come first, then remote columns in the order they are received                    **
+    ****************************************************************************************************/
+    matrix->columns = (int*) calloc(matrix->nonzeros + 1, sizeof(int));
+
+    if (matrix->columns == NULL) {
+       return -1;
+    }
+
+    for (k = 0; k < matrix->nonzeros; k++) {
+        if (matrix->global_columns[k] >= first_row && matrix->global_columns[k] < last_row) {
+           matrix->columns[k] = (int) (matrix->global_columns[k] - first_row);
+        }
+        else {
+           long* found = (long*) bsearch(&matrix->global_columns[k], needed, unique, sizeof(long), compare_columns);
+           matrix->columns[k] = (int) (matrix->rows + (found - needed));
+        }
+    }
+
+    free(matrix->global_columns);
+    matrix->global_columns = NULL;
+
+    free(weights);
+    free(destinations);
+    free(sources);
+    free(requested_displacements);
+    free(requested_counts);
+    free(needed_displacements);
+    free(needed_counts);
+    free(requested);
+    free(needed);
+
+    return 0;
+
+}
+
+void exchange_halo(halo* exchange, double* x, int rows) {
+    int i;
+
+    for (i = 0; i < exchange->send_size; i++) {
+        exchange->send_buffer[i] = x[exchange->send_indices[i]];
+    }
+
+    MPI_Neighbor_alltoallv(exchange->send_buffer, exchange->send_counts, exchange->send_displacements, MPI_DOUBLE,
+                           x + rows, exchange->receive_counts, exchange->receive_displacements, MPI_DOUBLE,
+                           exchange->neighbours);
+}
+
+int convert_to_sell(const csr_matrix* csr, sell_matrix* sell, int sorting_scope) {
+
+    int c, i, j, r;
+    int length;
+    int row;
+    long k;
+
+    /* Pairs of (row length, row) for sorting */
+    int* lengths = (int*) calloc(2 * (csr->rows + 1), sizeof(int));
+
+    sell->rows = csr->rows;
+    sell->chunks = (csr->rows + CHUNK_HEIGHT - 1) / CHUNK_HEIGHT;
+    sell->chunk_lengths = (int*) calloc(sell->chunks + 1, sizeof(int));
+    sell->chunk_pointers = (long*) calloc(sell->chunks + 1, sizeof(long));
+    sell->permutation = (int*) calloc((long) sell->chunks * CHUNK_HEIGHT + 1, sizeof(int));
+
+    if (lengths == NULL || sell->chunk_lengths == NULL || sell->chunk_pointers == NULL || sell->permutation == NULL) {
+       return -1;
+    }
+
+    /****************************************************************************************************
+    ** Sort rows by length in descending order within each window of sorting_scope rows               **
+    ****************************************************************************************************/
+    for (i = 0; i < csr->rows; i++) {
+        lengths[2 * i] = (int) (csr->row_pointers[i + 1] - csr->row_pointers[i]);
+        lengths[2 * i + 1] = i;
+    }
+
+    for (i = 0; i < csr->rows; i += sorting_scope) {
+        qsort(&lengths[2 * i], (csr->rows - i < sorting_scope) ? csr->rows - i : sorting_scope, 2 * sizeof(int), compare_lengths);
+    }
+
+    for (i = 0; i < sell->chunks * CHUNK_HEIGHT; i++) {
+        sell->permutation[i] = (i < csr->rows) ? lengths[2 * i + 1] : -1;
+    }
+
+    /****************************************************************************************************
+    ** Each chunk is as long as its longest row; shorter rows are padded with zeros                    **
+    ****************************************************************************************************/
+    for (c = 0, k = 0; c < sell->chunks; c++) {
+        sell->chunk_pointers[c] = k;
+        sell->chunk_lengths[c] = 0;
+        for (r = 0; r < CHUNK_HEIGHT; r++) {
+            i = c * CHUNK_HEIGHT + r;
+            if (i < csr->rows && lengths[2 * i] > sell->chunk_lengths[c]) {
+               sell->chunk_lengths[c] = lengths[2 * i];
+            }
+        }
+        k += (long) sell->chunk_lengths[c] * CHUNK_HEIGHT;
+    }
+    sell->chunk_pointers[sell->chunks] = k;
+    sell->stored = k;
+
+    sell->columns = (int*) calloc(k + 1, sizeof(int));
+    sell->values = (double*) calloc(k + 1, sizeof(double));
+
+    if (sell->columns == NULL || sell->values == NULL) {
+       return -1;
+    }
+
+    /***** Element j of row r in chunk c is stored at chunk_pointers[c] + j * CHUNK_HEIGHT + r *****/
+    for (c = 0; c < sell->chunks; c++) {
+        for (r = 0; r < CHUNK_HEIGHT; r++) {
+            row = sell->permutation[c * CHUNK_HEIGHT + r];
+            length = (row >= 0) ? (int) (csr->row_pointers[row + 1] - csr->row_pointers[row]) : 0;
+            for (j = 0; j < length; j++) {
+                k = sell->chunk_pointers[c] + (long) j * CHUNK_HEIGHT + r;
+                sell->columns[k] = csr->columns[csr->row_pointers[row] + j];
+                sell->values[k] = csr->values[csr->row_pointers[row] + j];
+            }
+        }
+    }
+
+    free(lengths);
+
+    return 0;
+
+}
+
+void spmv_csr(const csr_matrix* matrix, const double* x, double* y) {
+    int i;
+    long k;
+    double sum;
+
+    for (i = 0; i < matrix->rows; i++) {
+        sum = 0.0;
+        for (k = matrix->row_pointers[i]; k < matrix->row_pointers[i + 1]; k++) {
+            sum += matrix->values[k] * x[matrix->columns[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+void spmv_sell(const sell_matrix* matrix, const double* x, double* y) {
+    int c, j, r;
+    double sums[CHUNK_HEIGHT];
+
+    for (c = 0; c < matrix->chunks; c++) {
+        const int* columns = matrix->columns + matrix->chunk_pointers[c];
+        const double* values = matrix->values + matrix->chunk_pointers[c];
+
+        for (r = 0; r < CHUNK_HEIGHT; r++) {
+            sums[r] = 0.0;
+        }
+
+        /***** The inner loop runs across CHUNK_HEIGHT rows and is vectorized by the compiler *****/
+        for (j = 0; j < matrix->chunk_lengths[c]; j++) {
+            for (r = 0; r < CHUNK_HEIGHT; r++) {
+                sums[r] += values[j * CHUNK_HEIGHT + r] * x[columns[j * CHUNK_HEIGHT + r]];
+            }
+        }
+
+        for (r = 0; r < CHUNK_HEIGHT && c * CHUNK_HEIGHT + r < matrix->rows; r++) {
+            y[matrix->permutation[c * CHUNK_HEIGHT + r]] = sums[r];
+        }
+    }
+}
+
+int compare_lengths(const void* first, const void* second) {
+    return ((const int*) second)[0] - ((const int*) first)[0];
+}
+
+int compare_columns(const void* first, const void* second) {
+    long a = *(const long*) first;
+    long b = *(const long*) second;
+    return (a > b) - (a < b);
+}
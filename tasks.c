@@ -0,0 +1,901 @@
+/*!
+ *
+ *  \file    tasks.c
+ *  \brief   Benchmarks a work-stealing task scheduler with recursive workloads
+ *
+ *  \author  BJ Peter DeLaCruz
+ *
+ *  \version 1.0
+ *
+ *  \details \par How this program works:
+ *           Each process runs three recursive workloads with 1, 2, 4, ... up to N worker threads:
+ *           \arg fib: computes the Fibonacci number F(M) by spawning F(n - 1) and computing
+ *                F(n - 2) itself, down to n = \b FIB_CUTOFF, below which it recurses serially.
+ *           \arg quicksort: sorts an array of S random keys by partitioning it, spawning the left
+ *                part and sorting the right part itself, down to \b SORT_CUTOFF keys.
+ *           \arg UTS: counts the nodes of an unbalanced tree (Unbalanced Tree Search, binomial
+ *                variant). The root has R children, and every other node has \b UTS_BRANCHES
+ *                children with probability \b UTS_PROBABILITY and none otherwise, decided by a hash
+ *                of the node, so the tree is the same on every run but its subtrees differ wildly
+ *                in size. Every node is a task.
+ *
+ *           \par Scheduler:
+ *           Every worker has a Chase-Lev deque of tasks. A worker pushes the tasks that it spawns
+ *           onto the bottom of its own deque and pops them from the bottom, without atomic
+ *           read-modify-write instructions unless the deque is almost empty. A worker without
+ *           tasks steals the oldest task from the top of the deque of a random worker with a
+ *           compare-and-swap. A worker that waits for a spawned task that was stolen steals other
+ *           tasks meanwhile. Tasks live on the stack of the task that spawned them until it has
+ *           waited for them, so running a task allocates no memory.
+ *
+ *           The program displays the tasks per second of all workers and processes, the steals,
+ *           and the parallel efficiency of each number of workers compared to one worker. Each
+ *           result is checked against a serial computation or against the run with one worker, and
+ *           the program exits with status 1 if one is wrong.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+#include <pthread.h>
+
+/*! Master process. Usually process 0. */
+#define MASTER                     0
+/*! Compiler flags that this program was built with. Set by the makefile. */
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS                "unknown"
+#endif
+/*! Size of a cache line. Data written by different threads is kept on different lines. */
+#define CACHE_LINE_SIZE            64
+
+/*! Fork-join Fibonacci */
+#define FIB_WORKLOAD               0
+/*! Parallel quicksort */
+#define SORT_WORKLOAD              1
+/*! Unbalanced tree search */
+#define UTS_WORKLOAD               2
+/*! Number of workloads */
+#define NUMBER_OF_WORKLOADS        3
+
+/*! Tasks that a deque holds. Must be a power of two. A task that does not fit is run at once. */
+#define DEQUE_CAPACITY          4096
+/*! Failed steals of an idle worker before it yields the CPU */
+#define STEALS_BEFORE_YIELD       64
+/*! Stack size of a worker. Waiting workers run stolen tasks on top of their own. */
+#define WORKER_STACK_SIZE          (64UL << 20)
+
+/*! Fibonacci numbers below this are computed serially */
+#define FIB_CUTOFF                12
+/*! Arrays shorter than this are sorted serially */
+#define SORT_CUTOFF             4096
+/*! Children of a node of the unbalanced tree that has any */
+#define UTS_BRANCHES               8
+/*! Probability that a node of the unbalanced tree has children. A tree has about R / (1 - 0.992)
+    nodes. */
+#define UTS_PROBABILITY        0.124
+
+/*! Results of each run: tasks per second, seconds, tasks, steals, failed steals */
+#define RESULTS                    5
+
+/*! Names of the workloads, in the order of their numbers */
+static const char* const WORKLOAD_NAMES[] = { "fib", "quicksort", "UTS" };
+
+struct worker;
+
+/*!
+ *  \brief Task that a worker runs. Lives on the stack of the task that spawned it.
+ */
+typedef struct task {
+    /* Function that runs the task */
+    void (*run)(struct task* task, struct worker* worker);
+    /* Set when the task has finished */
+    _Atomic int done;
+    /* Input: Fibonacci number, range of keys, or node of the tree and whether it is the root */
+    long first;
+    long second;
+    void* data;
+    /* Output: Fibonacci number or number of nodes */
+    long result;
+} task;
+
+/*!
+ *  \brief Chase-Lev deque of tasks. The owner works at the bottom and thieves at the top.
+ */
+typedef struct deque {
+    _Atomic long top __attribute__((aligned(CACHE_LINE_SIZE)));
+    _Atomic long bottom __attribute__((aligned(CACHE_LINE_SIZE)));
+    _Atomic(task*) tasks[DEQUE_CAPACITY] __attribute__((aligned(CACHE_LINE_SIZE)));
+} deque;
+
+/*!
+ *  \brief Worker thread and its statistics
+ */
+typedef struct worker {
+    deque tasks;
+    /* All workers of the run */
+    struct worker* workers;
+    int index;
+    int count;
+    /* Root task, run by worker 0 */
+    task* root;
+    /* Set by worker 0 when the root task has finished */
+    _Atomic int* finished;
+    pthread_barrier_t* barrier;
+    uint64_t random;
+    /* Output: times when the root task started and finished, tasks run, steals, failed steals */
+    double start;
+    double end;
+    long executed;
+    long steals;
+    long failed_steals;
+} __attribute__((aligned(CACHE_LINE_SIZE))) worker;
+
+/***************************************************************************************************/
+
+/*!
+ *
+ *  \par Description:
+ *  Runs one workload with a number of workers, and measures the tasks per second from the time
+ *  the root task starts until it finishes.
+ *
+ *  \param workload \b FIB_WORKLOAD, \b SORT_WORKLOAD or \b UTS_WORKLOAD
+ *  \param threads Number of workers
+ *  \param size F(size), number of keys, or children of the root
+ *  \param results Tasks per second, seconds, tasks, steals and failed steals
+ *
+ *  \return Result of the root task: F(size), 0 if the keys are sorted and -1 if not, or number of
+ *          nodes. -2 if memory allocation failed.
+ *
+ */
+long run_workload(int workload, int threads, long size, double* results);
+
+/*!
+ *
+ *  \par Description:
+ *  Waits for the other workers, runs the root task on worker 0, and steals tasks on the others
+ *  until it has finished.
+ *
+ *  \param worker_args Worker of the calling thread
+ *
+ *  \return NULL
+ *
+ */
+void* worker_loop(void* worker_args);
+
+/*!
+ *
+ *  \par Description:
+ *  Pushes a task onto the deque of a worker, or runs it at once if the deque is full.
+ *
+ */
+void spawn(worker* self, task* child);
+
+/*!
+ *
+ *  \par Description:
+ *  Waits until a spawned task has finished. Runs the task if it is still on the deque, and steals
+ *  other tasks if it was stolen.
+ *
+ */
+void sync_task(worker* self, task* child);
+
+/*!
+ *
+ *  \par Description:
+ *  Runs a task on a worker and marks it as finished.
+ *
+ */
+void execute(worker* self, task* current);
+
+/*!
+ *
+ *  \par Description:
+ *  Tries to steal a task from a random other worker.
+ *
+ *  \return Stolen task, or NULL
+ *
+ */
+task* steal_random(worker* self);
+
+/*!
+ *
+ *  \par Description:
+ *  Pushes a task onto the bottom of a deque. Called only by the owner.
+ *
+ *  \return 0 if successful or -1 if the deque is full
+ *
+ */
+int deque_push(deque* tasks, task* pushed);
+
+/*!
+ *
+ *  \par Description:
+ *  Pops the newest task from the bottom of a deque. Called only by the owner.
+ *
+ *  \return Task, or NULL if the deque is empty or a thief took the last task
+ *
+ */
+task* deque_pop(deque* tasks);
+
+/*!
+ *
+ *  \par Description:
+ *  Steals the oldest task from the top of a deque. May be called by any worker.
+ *
+ *  \return Task, or NULL if the deque is empty or another thief won
+ *
+ */
+task* deque_steal(deque* tasks);
+
+/*!
+ *
+ *  \par Description:
+ *  Computes F(first) into result, spawning F(first - 1).
+ *
+ */
+void fib_task(task* current, worker* self);
+
+/*!
+ *
+ *  \par Description:
+ *  Sorts the keys in data from first up to second, spawning the sort of the left part.
+ *
+ */
+void sort_task(task* current, worker* self);
+
+/*!
+ *
+ *  \par Description:
+ *  Counts the nodes in the subtree of node first into result, spawning a task for every child.
+ *  second is the number of children of the root, or 0 if the node is not the root.
+ *
+ */
+void uts_task(task* current, worker* self);
+
+/*!
+ *
+ *  \par Description:
+ *  Computes a Fibonacci number serially.
+ *
+ */
+long fib_serial(long n);
+
+/*!
+ *
+ *  \par Description:
+ *  Partitions keys around the median of the first, middle and last keys.
+ *
+ *  \param keys Array of keys
+ *  \param low First key
+ *  \param high One past the last key
+ *
+ *  \return Index such that keys before it are at most the pivot and keys from it on are at least
+ *          the pivot
+ *
+ */
+long partition(uint32_t* keys, long low, long high);
+
+/*!
+ *
+ *  \par Description:
+ *  Sorts keys serially.
+ *
+ */
+void sort_serial(uint32_t* keys, long low, long high);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the number of children of a node of the unbalanced tree that is not the root.
+ *
+ */
+int uts_children(uint64_t node);
+
+/*!
+ *
+ *  \par Description:
+ *  Mixes the bits of a number (SplitMix64 finalizer).
+ *
+ */
+uint64_t mix(uint64_t value);
+
+/*!
+ *
+ *  \par Description:
+ *  Returns the time from a monotonic clock.
+ *
+ *  \return Time in seconds
+ *
+ */
+double seconds(void);
+
+/*!
+ *  \param argv[1] Largest number of worker threads
+ *  \param argv[2] Fibonacci number to compute
+ *  \param argv[3] Number of keys to sort
+ *  \param argv[4] Number of children of the root of the unbalanced tree
+ */
+int main(int argc, char** argv) {
+
+    /* Results of all runs of this process, and their sums over all processes */
+    double* results = NULL;
+    double* all_results = NULL;
+    /* Results of one run */
+    double* run;
+    /* Result of the root task of one run, and of the run with one worker */
+    long answer, expected[NUMBER_OF_WORKLOADS];
+    /* Wrong results on this process, and on all processes */
+    int errors = 0;
+    int all_errors = 0;
+
+    /* Used for error handling */
+    int error_code;
+    /* Current workload and number of workers */
+    int workload, threads, thread_index;
+    /* Number of numbers of workers, i.e. 1, 2, 4, ... up to NUMBER_OF_PTHREADS */
+    int NUMBER_OF_THREAD_COUNTS = 0;
+    /* Largest number of workers */
+    int NUMBER_OF_PTHREADS;
+    /* Total number of processes used in this program */
+    int NUMBER_OF_PROCESSES;
+    /* Current process */
+    int PROCESS_ID;
+
+    /* Size of each workload */
+    long SIZES[NUMBER_OF_WORKLOADS];
+
+    /* Used to time program execution */
+    double program_start;
+
+    /***************************************************************************************************/
+
+    if (argc != 5) {
+       printf("Usage: ./tasks ");
+       printf("[largest number of threads] [Fibonacci number] [number of keys to sort] ");
+       printf("[children of the root of the tree]\n");
+       printf("Please try again.\n");
+       exit(1);
+    }
+
+    if ((NUMBER_OF_PTHREADS = atoi(argv[1])) <= 0) {
+       printf("Error: Invalid argument for number of threads. Please try again.\n");
+       exit(1);
+    }
+
+    if ((SIZES[FIB_WORKLOAD] = atol(argv[2])) <= 0 || SIZES[FIB_WORKLOAD] > 90) {
+       printf("Error: Fibonacci number must be between 1 and 90. Please try again.\n");
+       exit(1);
+    }
+
+    if ((SIZES[SORT_WORKLOAD] = atol(argv[3])) <= 0) {
+       printf("Error: Invalid argument for number of keys. Please try again.\n");
+       exit(1);
+    }
+
+    if ((SIZES[UTS_WORKLOAD] = atol(argv[4])) <= 0) {
+       printf("Error: Invalid argument for children of the root. Please try again.\n");
+       exit(1);
+    }
+
+    for (threads = 1; threads < NUMBER_OF_PTHREADS; threads *= 2) {
+        NUMBER_OF_THREAD_COUNTS++;
+    }
+    NUMBER_OF_THREAD_COUNTS++;
+
+    /***************************************************************************************************/
+
+    error_code = MPI_Init(&argc, &argv);
+    error_code = MPI_Comm_size(MPI_COMM_WORLD, &NUMBER_OF_PROCESSES);
+    error_code = MPI_Comm_rank(MPI_COMM_WORLD, &PROCESS_ID);
+
+    if (error_code != 0) {
+       printf("Error encountered while initializing MPI and obtaining task information.\n");
+       MPI_Finalize();
+       exit(1);
+    }
+
+    results = (double*) calloc(NUMBER_OF_WORKLOADS * NUMBER_OF_THREAD_COUNTS * RESULTS, sizeof(double));
+    all_results = (double*) calloc(NUMBER_OF_WORKLOADS * NUMBER_OF_THREAD_COUNTS * RESULTS, sizeof(double));
+
+    if (results == NULL || all_results == NULL) {
+       printf("Memory allocation failed for results array! ");
+       printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+       MPI_Finalize();
+       exit(1);
+    }
+
+    /****************************************************************************************************
+    ** Run every workload with every number of workers                                                 **
+    ****************************************************************************************************/
+    program_start = seconds();
+
+    if (PROCESS_ID == MASTER) {
+       printf("\nRunning task workloads with up to %d workers on each of the %d processes... ",
+              NUMBER_OF_PTHREADS, NUMBER_OF_PROCESSES);
+       fflush(stdout);
+    }
+
+    expected[FIB_WORKLOAD] = fib_serial(SIZES[FIB_WORKLOAD]);
+    expected[SORT_WORKLOAD] = 0;
+
+    for (workload = 0; workload < NUMBER_OF_WORKLOADS; workload++) {
+        for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+            run = &results[(workload * NUMBER_OF_THREAD_COUNTS + thread_index) * RESULTS];
+            answer = run_workload(workload, (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS,
+                                  SIZES[workload], run);
+            if (answer == -2) {
+               printf("Memory allocation failed for %s workload! ", WORKLOAD_NAMES[workload]);
+               printf("Unable to allocate memory on process %d.\nAborting program...\n", PROCESS_ID);
+               MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            /***** The tree has no closed form, so every run must count as many nodes as one worker *****/
+            if (workload == UTS_WORKLOAD && thread_index == 0) {
+               expected[UTS_WORKLOAD] = answer;
+            }
+            errors += (answer != expected[workload]);
+        }
+    }
+
+    MPI_Reduce(results, all_results, NUMBER_OF_WORKLOADS * NUMBER_OF_THREAD_COUNTS * RESULTS, MPI_DOUBLE, MPI_SUM,
+               MASTER, MPI_COMM_WORLD);
+    MPI_Allreduce(&errors, &all_errors, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    /****************************************************************************************************
+    ** Print results                                                                                   **
+    ****************************************************************************************************/
+    if (PROCESS_ID == MASTER) {
+       printf("Success!\n\n");
+       printf("======================================================================\n");
+       printf("== Task scheduler results                                           ==\n");
+       printf("======================================================================\n\n");
+       printf("Each worker has a Chase-Lev deque and steals from random workers\n");
+       printf("when it runs out of tasks. Mtasks/s and steals count all workers and\n");
+       printf("processes. Seconds is the mean over all %d processes. Efficiency\n", NUMBER_OF_PROCESSES);
+       printf("is the rate per worker divided by the rate of one worker.\n\n");
+       for (workload = 0; workload < NUMBER_OF_WORKLOADS; workload++) {
+           if (workload == FIB_WORKLOAD) {
+              printf("fib: F(%ld), serial below F(%d)\n\n", SIZES[workload], FIB_CUTOFF);
+           }
+           else if (workload == SORT_WORKLOAD) {
+              printf("quicksort: %ld random 32-bit keys, serial below %d keys\n\n", SIZES[workload], SORT_CUTOFF);
+           }
+           else {
+              printf("UTS: root with %ld children, %ld nodes\n\n", SIZES[workload], expected[UTS_WORKLOAD]);
+           }
+           printf("Workers      Seconds     Mtasks/s          Tasks         Steals   Failed steals   Efficiency\n");
+           printf("-------   ----------   ----------   ------------   ------------   -------------   ----------\n");
+           for (thread_index = 0, threads = 1; thread_index < NUMBER_OF_THREAD_COUNTS; thread_index++, threads *= 2) {
+               run = &all_results[(workload * NUMBER_OF_THREAD_COUNTS + thread_index) * RESULTS];
+               threads = (threads < NUMBER_OF_PTHREADS) ? threads : NUMBER_OF_PTHREADS;
+               printf("%7d   %10.4f   %10.3f   %12.0f   %12.0f   %13.0f   %9.1f%%\n", threads,
+                      run[1] / NUMBER_OF_PROCESSES, run[0] / 1.0e6, run[2], run[3], run[4],
+                      100.0 * run[0] / threads / all_results[workload * NUMBER_OF_THREAD_COUNTS * RESULTS]);
+           }
+           printf("\n");
+       }
+
+       printf("======================================================================\n");
+       printf("== Summary                                                          ==\n");
+       printf("======================================================================\n\n");
+       printf("Build flags: %s\n\n", BUILD_FLAGS);
+       printf("Total number of processes:                   %10d\n", NUMBER_OF_PROCESSES);
+       printf("Largest number of workers per process:       %10d\n\n", NUMBER_OF_PTHREADS);
+       printf("Wrong results:                               %10d\n\n", all_errors);
+       printf("Total runtime:                               %10.2f seconds\n\n", seconds() - program_start);
+    }
+
+    /***************************************************************************************************/
+
+    free(all_results);
+    free(results);
+
+    MPI_Finalize();
+
+    return (all_errors == 0) ? 0 : 1;
+
+}
+
+long run_workload(int workload, int threads, long size, double* results) {
+
+    pthread_t worker_threads[threads];
+    pthread_attr_t attributes;
+    pthread_barrier_t barrier;
+    _Atomic int finished = 0;
+    uint32_t* keys = NULL;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    task root;
+    long i, answer;
+
+    worker* workers = (worker*) aligned_alloc(CACHE_LINE_SIZE, threads * sizeof(worker));
+
+    if (workload == SORT_WORKLOAD) {
+       keys = (uint32_t*) malloc(size * sizeof(uint32_t));
+    }
+
+    if (workers == NULL || (workload == SORT_WORKLOAD && keys == NULL)) {
+       free(keys);
+       free(workers);
+       return -2;
+    }
+
+    memset(workers, 0, threads * sizeof(worker));
+    memset(&root, 0, sizeof(task));
+
+    if (workload == FIB_WORKLOAD) {
+       root.run = fib_task;
+       root.first = size;
+    }
+    else if (workload == SORT_WORKLOAD) {
+       /***** Every run sorts the same keys, so that it spawns the same tasks *****/
+       for (i = 0; i < size; i++) {
+           state = mix(state + i);
+           keys[i] = (uint32_t) state;
+       }
+       root.run = sort_task;
+       root.first = 0;
+       root.second = size;
+       root.data = keys;
+    }
+    else {
+       root.run = uts_task;
+       root.first = 0;
+       root.second = size;
+    }
+
+    pthread_barrier_init(&barrier, NULL, threads);
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, WORKER_STACK_SIZE);
+
+    for (i = 0; i < threads; i++) {
+        workers[i].workers = workers;
+        workers[i].index = (int) i;
+        workers[i].count = threads;
+        workers[i].root = &root;
+        workers[i].finished = &finished;
+        workers[i].barrier = &barrier;
+        workers[i].random = mix(i + 1);
+        if (pthread_create(&worker_threads[i], &attributes, worker_loop, &workers[i]) != 0) {
+           printf("Error encountered while creating pthread.\n");
+           MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    for (i = 0; i < RESULTS; i++) {
+        results[i] = 0.0;
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(worker_threads[i], NULL);
+        results[2] += workers[i].executed;
+        results[3] += workers[i].steals;
+        results[4] += workers[i].failed_steals;
+    }
+    results[1] = workers[0].end - workers[0].start;
+    results[0] = results[2] / results[1];
+
+    answer = root.result;
+    if (workload == SORT_WORKLOAD) {
+       answer = 0;
+       for (i = 1; i < size; i++) {
+           if (keys[i - 1] > keys[i]) {
+              answer = -1;
+              break;
+           }
+       }
+    }
+
+    pthread_attr_destroy(&attributes);
+    pthread_barrier_destroy(&barrier);
+    free(keys);
+    free(workers);
+
+    return answer;
+
+}
+
+void* worker_loop(void* worker_args) {
+
+    worker* self = (worker*) worker_args;
+    task* stolen;
+    long failures = 0;
+
+    pthread_barrier_wait(self->barrier);
+
+    if (self->index == 0) {
+       self->start = seconds();
+       execute(self, self->root);
+       self->end = seconds();
+       atomic_store_explicit(self->finished, 1, memory_order_release);
+       return NULL;
+    }
+
+    while (atomic_load_explicit(self->finished, memory_order_acquire) == 0) {
+          if ((stolen = steal_random(self)) != NULL) {
+             execute(self, stolen);
+             failures = 0;
+          }
+          else if (++failures % STEALS_BEFORE_YIELD == 0) {
+             sched_yield();
+          }
+    }
+
+    return NULL;
+
+}
+
+void spawn(worker* self, task* child) {
+    atomic_store_explicit(&child->done, 0, memory_order_relaxed);
+    if (deque_push(&self->tasks, child) != 0) {
+       execute(self, child);
+    }
+}
+
+void sync_task(worker* self, task* child) {
+    task* next;
+    long failures = 0;
+
+    while (atomic_load_explicit(&child->done, memory_order_acquire) == 0) {
+          /***** Tasks spawned after the child have finished, so the bottom task is the child unless it was stolen *****/
+          if ((next = deque_pop(&self->tasks)) != NULL) {
+             execute(self, next);
+          }
+          else if ((next = steal_random(self)) != NULL) {
+             execute(self, next);
+             failures = 0;
+          }
+          else if (++failures % STEALS_BEFORE_YIELD == 0) {
+             sched_yield();
+          }
+    }
+}
+
+void execute(worker* self, task* current) {
+    current->run(current, self);
+    self->executed++;
+    atomic_store_explicit(&current->done, 1, memory_order_release);
+}
+
+task* steal_random(worker* self) {
+    int victim;
+    task* stolen;
+
+    if (self->count < 2) {
+       return NULL;
+    }
+    self->random ^= self->random << 13;
+    self->random ^= self->random >> 7;
+    self->random ^= self->random << 17;
+    victim = (int) (self->random % (self->count - 1));
+    victim += (victim >= self->index);
+
+    if ((stolen = deque_steal(&self->workers[victim].tasks)) != NULL) {
+       self->steals++;
+    }
+    else {
+       self->failed_steals++;
+    }
+    return stolen;
+}
+
+int deque_push(deque* tasks, task* pushed) {
+    long bottom = atomic_load_explicit(&tasks->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&tasks->top, memory_order_acquire);
+
+    if (bottom - top >= DEQUE_CAPACITY) {
+       return -1;
+    }
+    atomic_store_explicit(&tasks->tasks[bottom & (DEQUE_CAPACITY - 1)], pushed, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&tasks->bottom, bottom + 1, memory_order_relaxed);
+    return 0;
+}
+
+task* deque_pop(deque* tasks) {
+    long bottom = atomic_load_explicit(&tasks->bottom, memory_order_relaxed) - 1;
+    long top;
+    task* popped = NULL;
+
+    atomic_store_explicit(&tasks->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    top = atomic_load_explicit(&tasks->top, memory_order_relaxed);
+
+    if (top <= bottom) {
+       popped = atomic_load_explicit(&tasks->tasks[bottom & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+       if (top == bottom) {
+          /***** Last task: race thieves for it *****/
+          if (!atomic_compare_exchange_strong_explicit(&tasks->top, &top, top + 1, memory_order_seq_cst,
+                                                       memory_order_relaxed)) {
+             popped = NULL;
+          }
+          atomic_store_explicit(&tasks->bottom, bottom + 1, memory_order_relaxed);
+       }
+    }
+    else {
+       atomic_store_explicit(&tasks->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return popped;
+}
+
+task* deque_steal(deque* tasks) {
+    long top = atomic_load_explicit(&tasks->top, memory_order_acquire);
+    long bottom;
+    task* stolen;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    bottom = atomic_load_explicit(&tasks->bottom, memory_order_acquire);
+
+    if (top >= bottom) {
+       return NULL;
+    }
+    stolen = atomic_load_explicit(&tasks->tasks[top & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&tasks->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+       return NULL;
+    }
+    return stolen;
+}
+
+void fib_task(task* current, worker* self) {
+    task first, second;
+    long n = current->first;
+
+    if (n < FIB_CUTOFF) {
+       current->result = fib_serial(n);
+       return;
+    }
+
+    first.run = fib_task;
+    first.first = n - 1;
+    spawn(self, &first);
+
+    second.run = fib_task;
+    second.first = n - 2;
+    execute(self, &second);
+
+    sync_task(self, &first);
+    current->result = first.result + second.result;
+}
+
+void sort_task(task* current, worker* self) {
+    uint32_t* keys = (uint32_t*) current->data;
+    long low = current->first, high = current->second, middle;
+    task left, right;
+
+    if (high - low < SORT_CUTOFF) {
+       sort_serial(keys, low, high);
+       return;
+    }
+
+    middle = partition(keys, low, high);
+
+    left.run = sort_task;
+    left.first = low;
+    left.second = middle;
+    left.data = keys;
+    spawn(self, &left);
+
+    right.run = sort_task;
+    right.first = middle;
+    right.second = high;
+    right.data = keys;
+    execute(self, &right);
+
+    sync_task(self, &left);
+}
+
+void uts_task(task* current, worker* self) {
+    uint64_t node = (uint64_t) current->first;
+    int children = (current->second > 0) ? (int) current->second : uts_children(node);
+    task stack_tasks[UTS_BRANCHES];
+    task* child_tasks;
+    long nodes = 1;
+    int i;
+
+    if (children == 0) {
+       current->result = 1;
+       return;
+    }
+
+    /***** Only the root has more than UTS_BRANCHES children, so other nodes keep their children on the stack *****/
+    child_tasks = (children <= UTS_BRANCHES) ? stack_tasks : (task*) malloc(children * sizeof(task));
+    if (child_tasks == NULL) {
+       printf("Memory allocation failed for children of the root! Aborting program...\n");
+       MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (i = 0; i < children; i++) {
+        child_tasks[i].run = uts_task;
+        child_tasks[i].first = (long) (mix(node * UTS_BRANCHES + i + 1) >> 1);
+        child_tasks[i].second = 0;
+        spawn(self, &child_tasks[i]);
+    }
+    /***** Wait for the newest child first, which is still at the bottom of the deque unless stolen *****/
+    for (i = children - 1; i >= 0; i--) {
+        sync_task(self, &child_tasks[i]);
+        nodes += child_tasks[i].result;
+    }
+
+    if (child_tasks != stack_tasks) {
+       free(child_tasks);
+    }
+    current->result = nodes;
+}
+
+long fib_serial(long n) {
+    return (n < 2) ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+long partition(uint32_t* keys, long low, long high) {
+    long i = low - 1, j = high, middle = low + (high - low) / 2;
+    uint32_t a = keys[low], b = keys[middle], c = keys[high - 1], pivot, swap;
+
+    /***** Median of three *****/
+    pivot = (a < b) ? ((b < c) ? b : ((a < c) ? c : a)) : ((a < c) ? a : ((b < c) ? c : b));
+
+    for (;;) {
+        do {
+           i++;
+        } while (keys[i] < pivot);
+        do {
+           j--;
+        } while (keys[j] > pivot);
+        if (i >= j) {
+           return j + 1;
+        }
+        swap = keys[i];
+        keys[i] = keys[j];
+        keys[j] = swap;
+    }
+}
+
+void sort_serial(uint32_t* keys, long low, long high) {
+    long i, j, middle;
+    uint32_t key;
+
+    while (high - low > 16) {
+          middle = partition(keys, low, high);
+          /***** Recurse into the smaller part and loop on the larger one *****/
+          if (middle - low < high - middle) {
+             sort_serial(keys, low, middle);
+             low = middle;
+          }
+          else {
+             sort_serial(keys, middle, high);
+             high = middle;
+          }
+    }
+
+    for (i = low + 1; i < high; i++) {
+        key = keys[i];
+        for (j = i - 1; j >= low && keys[j] > key; j--) {
+            keys[j + 1] = keys[j];
+        }
+        keys[j + 1] = key;
+    }
+}
+
+int uts_children(uint64_t node) {
+    /***** The top 53 bits of the hash give a uniform number in [0, 1) *****/
+    double uniform = (mix(node) >> 11) * (1.0 / 9007199254740992.0);
+    return (uniform < UTS_PROBABILITY) ? UTS_BRANCHES : 0;
+}
+
+uint64_t mix(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+double seconds(void) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec + now.tv_nsec / 1.0e9;
+}